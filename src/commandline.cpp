@@ -1,15 +1,21 @@
 #include "commandline.h"
 #include "env.h"
+#include "envfs.h"
 #include "instancemanager.h"
 #include "loglist.h"
 #include "messagedialog.h"
 #include "multiprocess.h"
 #include "organizercore.h"
+#include "pluginarchives.h"
 #include "shared/appconfig.h"
+#include "shared/registermemory.h"
 #include "shared/util.h"
 #include <log.h>
 #include <report.h>
 
+#include <chrono>
+#include <format>
+
 #include <boost/optional/optional_io.hpp>
 
 using namespace Qt::StringLiterals;
@@ -119,6 +125,10 @@ CommandLine::CommandLine() : m_command(nullptr)
 
   add<RunCommand, ReloadPluginCommand, DownloadFileCommand, RefreshCommand,
       CrashDumpCommand, LaunchCommand>();
+
+#ifdef MO2_BENCHMARKS
+  add<RegisterMemoryCommand, WalkerBenchmarkCommand, PluginArchivesBenchmarkCommand>();
+#endif
 }
 
 std::optional<int> CommandLine::process(const nativeString& line)
@@ -985,4 +995,265 @@ std::optional<int> RefreshCommand::runPostOrganizer(OrganizerCore& core)
   return {};
 }
 
+#ifdef MO2_BENCHMARKS
+
+Command::Meta RegisterMemoryCommand::meta() const
+{
+  return {"register-memory",
+          "prints the memory used by a synthetic directory structure", "[options]",
+          ""};
+}
+
+po::options_description RegisterMemoryCommand::getVisibleOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("files,f", po::value<std::size_t>()->default_value(1000000),
+                  "number of files");
+
+  return d;
+}
+
+std::optional<int> RegisterMemoryCommand::runPostApplication(MOApplication&)
+{
+  env::Console console;
+
+  const auto files  = vm()["files"].as<std::size_t>();
+  const auto report = MOShared::RegisterMemoryReport::synthetic(files);
+
+  std::cout << report.toString().toStdString() << "\n";
+
+  return 0;
+}
+
+Command::Meta WalkerBenchmarkCommand::meta() const
+{
+  return {"walker-benchmark",
+          "walks a directory with the native and generic walkers and prints how "
+          "long each took",
+          "[options] PATH", ""};
+}
+
+po::options_description WalkerBenchmarkCommand::getVisibleOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("runs,r", po::value<int>()->default_value(5),
+                  "number of walks with each walker");
+
+  return d;
+}
+
+po::options_description WalkerBenchmarkCommand::getInternalOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("PATH", po::value<std::string>()->required(), "directory");
+
+  return d;
+}
+
+po::positional_options_description WalkerBenchmarkCommand::getPositional() const
+{
+  po::positional_options_description d;
+
+  d.add("PATH", 1);
+
+  return d;
+}
+
+std::optional<int> WalkerBenchmarkCommand::runPostApplication(MOApplication&)
+{
+  using Clock = std::chrono::steady_clock;
+
+  struct Counts
+  {
+    std::size_t dirs  = 0;
+    std::size_t files = 0;
+    uint64_t bytes    = 0;
+  };
+
+  env::Console console;
+
+  const QString path = QString::fromStdString(vm()["PATH"].as<std::string>());
+  const int runs     = std::max(vm()["runs"].as<int>(), 1);
+
+  auto onDir = [](void* cx, QStringView) {
+    ++static_cast<Counts*>(cx)->dirs;
+  };
+
+  auto onDirEnd = [](void*, QStringView) {};
+
+  auto onFile = [](void* cx, QStringView, QDateTime, uint64_t size) {
+    auto* c = static_cast<Counts*>(cx);
+    ++c->files;
+    c->bytes += size;
+  };
+
+  env::DirectoryWalker walker;
+
+  auto bench = [&](const char* name, auto&& walk) {
+    Counts counts;
+    Clock::duration best = Clock::duration::max(), total{};
+
+    for (int i = 0; i < runs; ++i) {
+      counts = {};
+
+      const auto start = Clock::now();
+      walk(&counts);
+      const auto d = Clock::now() - start;
+
+      best = std::min(best, d);
+      total += d;
+    }
+
+    auto ms = [](Clock::duration d) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+
+    std::cout << std::format("{:<8} {} dirs, {} files, {} bytes; best {}ms, "
+                             "average {}ms\n",
+                             name, counts.dirs, counts.files, counts.bytes, ms(best),
+                             ms(total / runs));
+  };
+
+  // the first walk with either of them warms up the os caches
+  bench("native", [&](Counts* c) {
+    walker.forEachEntry(path, c, onDir, onDirEnd, onFile);
+  });
+
+  bench("generic", [&](Counts* c) {
+    env::forEachEntryGeneric(path, c, onDir, onDirEnd, onFile);
+  });
+
+  bench("native", [&](Counts* c) {
+    walker.forEachEntry(path, c, onDir, onDirEnd, onFile);
+  });
+
+  return 0;
+}
+
+Command::Meta PluginArchivesBenchmarkCommand::meta() const
+{
+  return {"plugin-archives-benchmark",
+          "matches synthetic plugins with synthetic archives and prints how long "
+          "it took with and without the prefix index",
+          "[options]", ""};
+}
+
+po::options_description PluginArchivesBenchmarkCommand::getVisibleOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("plugins,p", po::value<int>()->default_value(5000),
+                  "number of plugins")(
+      "archives,a", po::value<int>()->default_value(5000), "number of archives")(
+      "runs,r", po::value<int>()->default_value(5), "number of runs of each method");
+
+  return d;
+}
+
+std::optional<int> PluginArchivesBenchmarkCommand::runPostApplication(MOApplication&)
+{
+  using Clock   = std::chrono::steady_clock;
+  using Matches = std::vector<std::set<QString>>;
+
+  env::Console console;
+
+  const int pluginCount  = std::max(vm()["plugins"].as<int>(), 1);
+  const int archiveCount = std::max(vm()["archives"].as<int>(), 0);
+  const int runs         = std::max(vm()["runs"].as<int>(), 1);
+
+  // plugin names without their extension, like the plugin list uses; each
+  // archive belongs to a plugin, with the casing and suffixes mods use
+  QStringList plugins, archives;
+
+  for (int i = 0; i < pluginCount; ++i) {
+    plugins.append(u"Synthetic Plugin %1"_s.arg(i));
+  }
+
+  for (int i = 0; i < archiveCount; ++i) {
+    const QString& plugin = plugins[i % pluginCount];
+
+    switch (i % 3) {
+    case 0:
+      archives.append(plugin + u".bsa"_s);
+      break;
+
+    case 1:
+      archives.append(plugin.toUpper() + u" - Textures.BA2"_s);
+      break;
+
+    default:
+      archives.append(plugin.toLower() + u" - meshes.ba2"_s);
+      break;
+    }
+  }
+
+  auto bench = [&](const char* name, auto&& match) {
+    Matches matches;
+    Clock::duration best = Clock::duration::max(), total{};
+
+    for (int i = 0; i < runs; ++i) {
+      const auto start = Clock::now();
+      matches          = match();
+      const auto d     = Clock::now() - start;
+
+      best = std::min(best, d);
+      total += d;
+    }
+
+    auto us = [](Clock::duration d) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    };
+
+    std::size_t found = 0;
+    for (const auto& m : matches) {
+      found += m.size();
+    }
+
+    std::cout << std::format("{:<8} {} plugins, {} archives, {} matches; best {}us, "
+                             "average {}us\n",
+                             name, plugins.size(), archives.size(), found, us(best),
+                             us(total / runs));
+
+    return matches;
+  };
+
+  const Matches naive = bench("naive", [&] {
+    Matches m(plugins.size());
+
+    for (qsizetype i = 0; i < plugins.size(); ++i) {
+      for (const auto& archive : archives) {
+        if (archive.startsWith(plugins[i], Qt::CaseInsensitive)) {
+          m[i].insert(archive);
+        }
+      }
+    }
+
+    return m;
+  });
+
+  // building the index is part of every refresh, so it's timed too
+  const Matches indexed = bench("indexed", [&] {
+    const ArchivePrefixIndex index(archives);
+    Matches m(plugins.size());
+
+    for (qsizetype i = 0; i < plugins.size(); ++i) {
+      m[i] = index.withPrefix(plugins[i]);
+    }
+
+    return m;
+  });
+
+  if (naive != indexed) {
+    std::cerr << "the index and the naive method found different archives\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif
+
 }  // namespace cl
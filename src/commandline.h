@@ -232,6 +232,48 @@ protected:
   std::optional<int> runPostOrganizer(OrganizerCore& core) override;
 };
 
+#ifdef MO2_BENCHMARKS
+
+// builds a synthetic directory structure and prints how much memory it uses,
+// compared with the previous layout of the structure
+//
+class RegisterMemoryCommand : public Command
+{
+protected:
+  Meta meta() const override;
+  po::options_description getVisibleOptions() const override;
+  std::optional<int> runPostApplication(MOApplication& a) override;
+};
+
+// walks a directory with the native walker and with the QDirIterator one it
+// replaced and prints how long each of them took
+//
+class WalkerBenchmarkCommand : public Command
+{
+protected:
+  Meta meta() const override;
+
+  po::options_description getVisibleOptions() const override;
+  po::options_description getInternalOptions() const override;
+  po::positional_options_description getPositional() const override;
+
+  std::optional<int> runPostApplication(MOApplication& a) override;
+};
+
+// matches synthetic plugins with synthetic archives the way the plugin list
+// used to, by comparing every archive with every plugin, and with the prefix
+// index, and prints how long each took
+//
+class PluginArchivesBenchmarkCommand : public Command
+{
+protected:
+  Meta meta() const override;
+  po::options_description getVisibleOptions() const override;
+  std::optional<int> runPostApplication(MOApplication& a) override;
+};
+
+#endif
+
 // parses the command line and runs any given command
 //
 // the command line used to support a few commands but with no real conventions;
@@ -0,0 +1,248 @@
+#include "directorycloner.h"
+#include "envfs.h"
+#include "taskscheduler.h"
+#include <QApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <log.h>
+#include <mutex>
+#include <utility.h>
+#include <vector>
+
+using namespace MOBase;
+using namespace MOShared;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+struct Item
+{
+  QString from;
+  QString to;
+  uint64_t size;
+};
+
+void collect(const env::Directory& d, const QString& from, const QString& to,
+             std::vector<QString>& dirs, std::vector<Item>& files)
+{
+  for (const auto& f : d.files) {
+    files.push_back({from + "/" + f.name, to + "/" + f.name, f.size});
+  }
+
+  for (const auto& sub : d.dirs) {
+    dirs.push_back(to + "/" + sub.name);
+    collect(sub, from + "/" + sub.name, to + "/" + sub.name, dirs, files);
+  }
+}
+
+// shared by the workers, the calling thread only reports progress
+//
+struct State
+{
+  const std::vector<Item>& files;
+  const bool merge;
+
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> done{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<bool> stop{false};
+
+  std::atomic<std::size_t> reflinked{0};
+  std::atomic<std::size_t> systemCopied{0};
+  std::atomic<std::size_t> copied{0};
+  std::atomic<std::size_t> skipped{0};
+
+  // guards the error and the number of workers, the condition is notified
+  // when a worker finishes
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::size_t running = 0;
+  QString error;
+
+  State(const std::vector<Item>& files, bool merge) : files(files), merge(merge) {}
+};
+
+void cloneFiles(State& s)
+{
+  while (!s.stop) {
+    const std::size_t i = s.next++;
+    if (i >= s.files.size()) {
+      break;
+    }
+
+    const auto& item = s.files[i];
+
+    if (s.merge && QFileInfo::exists(item.to)) {
+      ++s.skipped;
+    } else {
+      QString error;
+      const auto method = env::cloneFile(item.from, item.to, error);
+
+      if (!method) {
+        std::scoped_lock lock(s.mutex);
+
+        if (s.error.isEmpty()) {
+          s.error = QObject::tr("Failed to copy '%1' to '%2': %3")
+                        .arg(QDir::toNativeSeparators(item.from))
+                        .arg(QDir::toNativeSeparators(item.to))
+                        .arg(error);
+        }
+
+        s.stop = true;
+        break;
+      }
+
+      switch (*method) {
+      case env::CloneMethod::Reflink:
+        ++s.reflinked;
+        break;
+
+      case env::CloneMethod::SystemCopy:
+        ++s.systemCopied;
+        break;
+
+      case env::CloneMethod::Copy:
+        ++s.copied;
+        break;
+      }
+    }
+
+    s.bytes += item.size;
+    ++s.done;
+  }
+
+  std::scoped_lock lock(s.mutex);
+  --s.running;
+  s.finished.notify_all();
+}
+
+}  // namespace
+
+bool cloneDirectory(const QString& from, const QString& to, bool merge,
+                    const CloneProgressCallback& progress, QString& error)
+{
+  TimeThis tt("cloneDirectory()");
+
+  error.clear();
+
+  if (!QFileInfo(from).isDir()) {
+    error = QObject::tr("'%1' is not a directory").arg(QDir::toNativeSeparators(from));
+    return false;
+  }
+
+  if (!merge && QFileInfo::exists(to)) {
+    error = QObject::tr("'%1' already exists").arg(QDir::toNativeSeparators(to));
+    return false;
+  }
+
+  std::vector<QString> dirs;
+  std::vector<Item> files;
+
+  dirs.push_back(to);
+  collect(env::getFilesAndDirs(from), from, to, dirs, files);
+
+  // a partial copy is useless as a backup, but merging never removes anything
+  auto fail = [&] {
+    if (!merge) {
+      QDir(to).removeRecursively();
+    }
+
+    return false;
+  };
+
+  for (const auto& d : dirs) {
+    if (!QDir().mkpath(d)) {
+      error = QObject::tr("Failed to create '%1'").arg(QDir::toNativeSeparators(d));
+      return fail();
+    }
+  }
+
+  CloneProgress p;
+  p.totalFiles = files.size();
+
+  for (const auto& f : files) {
+    p.totalBytes += f.size;
+  }
+
+  State s(files, merge);
+
+  TaskGroup group;
+  const std::size_t n = std::min(files.size(), TaskScheduler::global().threadCount());
+
+  s.running = n;
+  for (std::size_t i = 0; i < n; ++i) {
+    group.run(QStringLiteral("cloneDirectory"), [&s] {
+      cloneFiles(s);
+    });
+  }
+
+  bool cancelled = false;
+
+  for (;;) {
+    {
+      std::unique_lock lock(s.mutex);
+      if (s.finished.wait_for(lock, 50ms, [&] {
+            return (s.running == 0);
+          })) {
+        break;
+      }
+    }
+
+    p.files = s.done;
+    p.bytes = s.bytes;
+
+    if (progress && !cancelled && !progress(p)) {
+      cancelled = true;
+      s.stop    = true;
+    }
+  }
+
+  group.wait();
+
+  if (!s.error.isEmpty()) {
+    error = s.error;
+    return fail();
+  }
+
+  if (cancelled) {
+    log::debug("cloning '{}' to '{}' was cancelled", from, to);
+    return fail();
+  }
+
+  log::debug("cloned {} files from '{}' to '{}': {} reflinked, {} copied by the "
+             "system, {} copied, {} already existed",
+             files.size(), from, to, s.reflinked.load(), s.systemCopied.load(),
+             s.copied.load(), s.skipped.load());
+
+  return true;
+}
+
+bool cloneDirectory(QWidget* parent, const QString& from, const QString& to,
+                    bool merge, QString& error)
+{
+  // the range is in thousandths so large mods don't overflow it
+  QProgressDialog dialog(parent);
+  dialog.setLabelText(QObject::tr("Copying '%1'").arg(QDir::toNativeSeparators(from)));
+  dialog.setMaximum(1000);
+  dialog.setMinimumDuration(500);
+  dialog.setWindowModality(Qt::WindowModal);
+
+  return cloneDirectory(
+      from, to, merge,
+      [&](const CloneProgress& p) {
+        if (p.totalBytes > 0) {
+          dialog.setValue(static_cast<int>(p.bytes * 1000 / p.totalBytes));
+        } else if (p.totalFiles > 0) {
+          dialog.setValue(static_cast<int>(p.files * 1000 / p.totalFiles));
+        }
+
+        QCoreApplication::processEvents();
+        return !dialog.wasCanceled();
+      },
+      error);
+}
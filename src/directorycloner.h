@@ -0,0 +1,50 @@
+#ifndef MODORGANIZER_DIRECTORYCLONER_INCLUDED
+#define MODORGANIZER_DIRECTORYCLONER_INCLUDED
+
+#include <QString>
+#include <cstdint>
+#include <functional>
+
+class QWidget;
+
+struct CloneProgress
+{
+  std::size_t files      = 0;
+  std::size_t totalFiles = 0;
+  uint64_t bytes         = 0;
+  uint64_t totalBytes    = 0;
+};
+
+// called periodically on the thread of cloneDirectory(), returning false
+// cancels the clone
+//
+using CloneProgressCallback = std::function<bool(const CloneProgress&)>;
+
+/**
+ * @brief copies a directory tree, sharing the data of the files with the copy
+ * when the filesystem can
+ *
+ * files are copied with env::cloneFile() on the worker threads, which uses
+ * reflinks on copy-on-write filesystems like btrfs or xfs, so the copy is
+ * nearly instant and takes no space until either side is modified; other
+ * filesystems get a regular copy
+ *
+ * files are never hardlinked, mods are modified in place by MO and by the
+ * programs running in the vfs, which would also modify the copy
+ *
+ * if `merge` is false, the destination must not exist and is removed if the
+ * clone fails or is cancelled; otherwise, files are added to the destination
+ * but existing files are left alone
+ *
+ * returns false on failure, with `error` set, or if the clone was cancelled,
+ * with `error` empty
+ **/
+bool cloneDirectory(const QString& from, const QString& to, bool merge,
+                    const CloneProgressCallback& progress, QString& error);
+
+// same as above, but shows a progress dialog if the clone takes a while
+//
+bool cloneDirectory(QWidget* parent, const QString& from, const QString& to,
+                    bool merge, QString& error);
+
+#endif  // MODORGANIZER_DIRECTORYCLONER_INCLUDED
@@ -18,6 +18,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "directoryrefresher.h"
+#include "shared/directorymerge.h"
 #include "shared/fileentry.h"
 #include "shared/filesorigin.h"
 
@@ -27,9 +28,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modinfo.h"
 #include "modinfodialogfwd.h"
 #include "organizercore.h"
+#include "pluginarchives.h"
 #include "report.h"
 #include "settings.h"
 #include "shared/util.h"
+#include "taskscheduler.h"
 #include "utility.h"
 
 #include <gameplugins.h>
@@ -44,6 +47,10 @@ using namespace MOBase;
 using namespace MOShared;
 using namespace Qt::StringLiterals;
 
+// past this many added or removed files, refreshing the whole structure is
+// about as fast as applying the changes
+static constexpr std::size_t MaxChangedFiles = 5000;
+
 #ifdef __unix__
 static constexpr auto statsFile = "/tmp/data.csv";
 #else
@@ -53,10 +60,11 @@ static constexpr auto statsFile = "c:\\tmp\\data.csv";
 DirectoryStats::DirectoryStats()
     : dirTimes(), fileTimes(), sortTimes(), subdirLookupTimes(), addDirectoryTimes(),
       filesLookupTimes(), addFileTimes(), addOriginToFileTimes(),
-      addFileToOriginTimes(), addFileToRegisterTimes(), originExists(0),
-      originCreate(0), originsNeededEnabled(0), subdirExists(0), subdirCreate(0),
-      fileExists(0), fileCreate(0), filesInsertedInRegister(0),
-      filesAssignedInRegister(0)
+      addFileToOriginTimes(), addFileToRegisterTimes(), mergeTimes(),
+      originExists(0), originCreate(0), originsNeededEnabled(0), subdirExists(0),
+      subdirCreate(0), fileExists(0), fileCreate(0), filesInsertedInRegister(0),
+      filesAssignedInRegister(0), filesMerged(0), filesMergedExisting(0),
+      mergeShards(0), sharedLocksAvoided(0)
 {}
 
 DirectoryStats& DirectoryStats::operator+=(const DirectoryStats& o)
@@ -73,6 +81,7 @@ DirectoryStats& DirectoryStats::operator+=(const DirectoryStats& o)
   addOriginToFileTimes += o.addOriginToFileTimes;
   addFileToOriginTimes += o.addFileToOriginTimes;
   addFileToRegisterTimes += o.addFileToRegisterTimes;
+  mergeTimes += o.mergeTimes;
 
   originExists += o.originExists;
   originCreate += o.originCreate;
@@ -86,6 +95,11 @@ DirectoryStats& DirectoryStats::operator+=(const DirectoryStats& o)
   filesInsertedInRegister += o.filesInsertedInRegister;
   filesAssignedInRegister += o.filesAssignedInRegister;
 
+  filesMerged += o.filesMerged;
+  filesMergedExisting += o.filesMergedExisting;
+  mergeShards += o.mergeShards;
+  sharedLocksAvoided += o.sharedLocksAvoided;
+
   return *this;
 }
 
@@ -101,6 +115,7 @@ QString DirectoryStats::csvHeader()
                     "addOriginToFileTimes",
                     "addFileToOriginTimes",
                     "addFileToRegisterTimes",
+                    "mergeTimes",
                     "originExists",
                     "originCreate",
                     "originsNeededEnabled",
@@ -109,7 +124,11 @@ QString DirectoryStats::csvHeader()
                     "fileExists",
                     "fileCreate",
                     "filesInsertedInRegister",
-                    "filesAssignedInRegister"};
+                    "filesAssignedInRegister",
+                    "filesMerged",
+                    "filesMergedExisting",
+                    "mergeShards",
+                    "sharedLocksAvoided"};
 
   return sl.join(",");
 }
@@ -130,7 +149,7 @@ QString DirectoryStats::toCsv() const
       << QString::number(s(filesLookupTimes)) << QString::number(s(addFileTimes))
       << QString::number(s(addOriginToFileTimes))
       << QString::number(s(addFileToOriginTimes))
-      << QString::number(s(addFileToRegisterTimes))
+      << QString::number(s(addFileToRegisterTimes)) << QString::number(s(mergeTimes))
 
       << QString::number(originExists) << QString::number(originCreate)
       << QString::number(originsNeededEnabled)
@@ -139,7 +158,10 @@ QString DirectoryStats::toCsv() const
 
       << QString::number(fileExists) << QString::number(fileCreate)
       << QString::number(filesInsertedInRegister)
-      << QString::number(filesAssignedInRegister);
+      << QString::number(filesAssignedInRegister)
+
+      << QString::number(filesMerged) << QString::number(filesMergedExisting)
+      << QString::number(mergeShards) << QString::number(sharedLocksAvoided);
 
   return oss.join(",");
 }
@@ -170,10 +192,292 @@ void dumpStats(std::vector<DirectoryStats>& stats)
   ++run;
 }
 
-DirectoryRefresher::DirectoryRefresher(OrganizerCore* core, std::size_t threadCount)
-    : m_Core(*core), m_threadCount(threadCount), m_lastFileCount(0)
+DirectoryRefresher::DirectoryRefresher(OrganizerCore* core)
+    : m_Core(*core), m_lastFileCount(0)
 {}
 
+QString DirectoryRefresher::snapshotPath()
+{
+  return Settings::instance().paths().cache() + "/directory.snapshot";
+}
+
+QString DirectoryRefresher::archiveIndexPath()
+{
+  return Settings::instance().paths().cache() + "/archives.index";
+}
+
+void DirectoryRefresher::loadCaches()
+{
+  std::call_once(m_CachesLoaded, [&] {
+    m_Snapshot.load(snapshotPath());
+    m_ArchiveIndex.load(archiveIndexPath());
+  });
+}
+
+std::shared_ptr<const env::Directory>
+DirectoryRefresher::listing(const QString& originName, const QString& directory)
+{
+  loadCaches();
+
+  return m_Snapshot.get(env::DirectoryWalker::forThisThread(), originName,
+                        QDir::toNativeSeparators(directory));
+}
+
+// whether an archive was added to or removed from the root of an origin, the
+// archives of a mod are only listed again by a refresh
+//
+static bool archivesChanged(const DirectorySnapshot::Changes& c)
+{
+  for (const auto& f : c.created.files) {
+    if (dataFileType(f.name) == DataFileType::Archive) {
+      return true;
+    }
+  }
+
+  for (const auto& path : c.deleted) {
+    if (!path.contains(u'/') && dataFileType(path) == DataFileType::Archive) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::optional<std::vector<DirectoryRefresher::OriginChanges>>
+DirectoryRefresher::changesSinceRefresh(
+    const std::vector<std::tuple<QString, QString, int>>& mods)
+{
+  TimeThis tt("DirectoryRefresher::changesSinceRefresh()");
+
+  struct Check
+  {
+    QString originName;
+    QString path;
+    int priority = 0;
+    bool isData  = false;
+
+    // listing the structure was built from
+    std::shared_ptr<const env::Directory> before;
+
+    std::optional<OriginChanges> changes;
+  };
+
+  loadCaches();
+
+  std::vector<Check> checks;
+
+  IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+
+  checks.push_back({u"data"_s,
+                    QDir::toNativeSeparators(game->dataDirectory().absolutePath()), 0,
+                    true});
+
+  for (auto directory : game->secondaryDataDirectories().toStdMap()) {
+    checks.push_back({directory.first,
+                      QDir::toNativeSeparators(directory.second.absolutePath()), 0,
+                      true});
+  }
+
+  for (const auto& e : entries(mods)) {
+    // files of foreign mods are in the data directory
+    if (e.stealFiles.isEmpty()) {
+      checks.push_back(
+          {e.modName, QDir::toNativeSeparators(e.absolutePath), e.priority + 1, false});
+    }
+  }
+
+  {
+    std::scoped_lock lock(m_ListingsMutex);
+
+    for (auto& c : checks) {
+      auto itor = m_Listings.find(c.originName);
+
+      if (itor == m_Listings.end()) {
+        log::debug("origin '{}' is not from a listing, needs a refresh", c.originName);
+        return {};
+      }
+
+      c.before = itor->second;
+    }
+  }
+
+  std::atomic<bool> failed = false;
+
+  // the snapshot returns the same listing as long as the directories of an
+  // origin haven't changed, so only the changed origins are walked
+  parallelMap(
+      checks.begin(), checks.end(),
+      [&](Check& c) {
+        try {
+          auto after = m_Snapshot.get(env::DirectoryWalker::forThisThread(),
+                                      c.originName, c.path);
+
+          if (after != c.before) {
+            c.changes = OriginChanges{c.originName, c.priority, after,
+                                      DirectorySnapshot::diff(*c.before, *after)};
+          }
+        } catch (const std::exception& ex) {
+          log::error("failed to list origin '{}': {}", c.originName, ex.what());
+          failed = true;
+        }
+      },
+      TaskScheduler::global().threadCount());
+
+  if (failed) {
+    return {};
+  }
+
+  std::vector<OriginChanges> changes;
+  std::size_t fileCount = 0;
+
+  for (auto& c : checks) {
+    if (!c.changes || c.changes->changes.empty()) {
+      continue;
+    }
+
+    const auto& d = c.changes->changes;
+
+    log::debug("origin '{}': {} files added, {} removed", c.originName,
+               d.createdCount, d.deleted.size());
+
+    if (c.isData) {
+      log::debug("data directory '{}' has changed, needs a refresh", c.originName);
+      return {};
+    }
+
+    if (archivesChanged(d)) {
+      log::debug("archives of '{}' have changed, needs a refresh", c.originName);
+      return {};
+    }
+
+    fileCount += d.createdCount + static_cast<std::size_t>(d.deleted.size());
+
+    if (fileCount > MaxChangedFiles) {
+      log::debug("more than {} files have changed, needs a refresh", MaxChangedFiles);
+      return {};
+    }
+
+    changes.push_back(std::move(*c.changes));
+  }
+
+  return changes;
+}
+
+bool DirectoryRefresher::applyChanges(DirectoryEntry* directoryStructure,
+                                      const std::vector<OriginChanges>& changes)
+{
+  TimeThis tt("DirectoryRefresher::applyChanges()");
+
+  struct Removal
+  {
+    FilesOrigin* origin;
+    FileEntryPtr file;
+  };
+
+  // everything is checked before touching the structure
+  std::vector<Removal> removals;
+
+  for (const auto& c : changes) {
+    if (!directoryStructure->originExists(c.originName)) {
+      log::debug("origin '{}' is not in the structure, needs a refresh", c.originName);
+      return false;
+    }
+
+    FilesOrigin& origin = directoryStructure->getOriginByName(c.originName);
+
+    for (const auto& path : c.changes.deleted) {
+      FileEntryPtr file = directoryStructure->searchFile(path);
+      if (!file) {
+        continue;
+      }
+
+      bool inOrigin = false;
+
+      const auto check = [&](OriginID id, bool fromArchive) {
+        if (id != origin.getID()) {
+          return true;
+        }
+
+        // a file that's both loose and in an archive of the same origin can't
+        // lose only one of them
+        if (fromArchive) {
+          log::debug("'{}' is also in an archive of '{}', needs a refresh", path,
+                     c.originName);
+          return false;
+        }
+
+        inOrigin = true;
+        return true;
+      };
+
+      if (!check(file->getOrigin(), file->getArchive().isValid())) {
+        return false;
+      }
+
+      for (const auto& alt : file->getAlternatives()) {
+        if (!check(alt.originID(), alt.isFromArchive())) {
+          return false;
+        }
+      }
+
+      if (inOrigin) {
+        removals.push_back({&origin, std::move(file)});
+      }
+    }
+  }
+
+  for (auto& r : removals) {
+    const FileIndex index = r.file->getIndex();
+
+    if (r.file->getAlternatives().empty()) {
+      // only in this origin, removes it from the origin and its directory too
+      directoryStructure->getFileRegister()->removeFile(index);
+    } else {
+      r.origin->removeFile(index);
+      r.file->removeOrigin(r.origin->getID());
+    }
+  }
+
+  // the merge needs the listings by ascending priority
+  std::vector<const OriginChanges*> sorted;
+  for (const auto& c : changes) {
+    sorted.push_back(&c);
+  }
+
+  std::ranges::stable_sort(sorted, {}, [](auto* c) {
+    return c->priority;
+  });
+
+  std::set<OriginID> origins;
+
+  {
+    DirectoryMerge merge(*directoryStructure);
+
+    for (const auto* c : sorted) {
+      FilesOrigin& origin = directoryStructure->getOriginByName(c->originName);
+      origins.insert(origin.getID());
+
+      if (c->changes.createdCount > 0) {
+        merge.add(origin, c->changes.created);
+      }
+    }
+
+    merge.run();
+  }
+
+  directoryStructure->getFileRegister()->sortOrigins(origins);
+  cleanStructure(directoryStructure);
+
+  for (const auto& c : changes) {
+    setListing(c.originName, c.listing);
+  }
+
+  log::debug("applied the changes of {} origins, removed {} files",
+             changes.size(), removals.size());
+
+  return true;
+}
+
 DirectoryEntry* DirectoryRefresher::stealDirectoryStructure()
 {
   QMutexLocker locker(&m_RefreshLock);
@@ -186,18 +490,39 @@ void DirectoryRefresher::setMods(
 {
   QMutexLocker locker(&m_RefreshLock);
 
-  m_Mods.clear();
+  m_Mods            = entries(mods);
+  m_EnabledArchives = managedArchives;
+}
+
+std::vector<DirectoryRefresher::EntryInfo> DirectoryRefresher::entries(
+    const std::vector<std::tuple<QString, QString, int>>& mods) const
+{
+  std::vector<EntryInfo> v;
+  v.reserve(mods.size());
+
   for (auto mod = mods.begin(); mod != mods.end(); ++mod) {
     QString name       = std::get<0>(*mod);
     ModInfo::Ptr info  = ModInfo::getByIndex(ModInfo::getIndex(name));
     QString path       = std::get<1>(*mod);
     QString modDataDir = m_Core.managedGame()->modDataDirectory();
     path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
-    m_Mods.push_back(
+    v.push_back(
         EntryInfo(name, path, info->stealFiles(), info->archives(), std::get<2>(*mod)));
   }
 
-  m_EnabledArchives = managedArchives;
+  return v;
+}
+
+void DirectoryRefresher::setListing(const QString& originName,
+                                    std::shared_ptr<const env::Directory> listing)
+{
+  std::scoped_lock lock(m_ListingsMutex);
+
+  if (listing) {
+    m_Listings.insert_or_assign(originName, std::move(listing));
+  } else {
+    m_Listings.erase(originName);
+  }
 }
 
 void DirectoryRefresher::cleanStructure(DirectoryEntry* structure)
@@ -228,7 +553,7 @@ void DirectoryRefresher::addModBSAToStructure(DirectoryEntry* root,
   DirectoryStats dummy;
 
   root->addFromAllBSAs(modName, QDir::toNativeSeparators(directory), priority, archives,
-                       m_EnabledArchives, loadOrder, dummy);
+                       m_EnabledArchives, loadOrder, dummy, &m_ArchiveIndex);
 }
 
 void DirectoryRefresher::stealModFilesIntoStructure(DirectoryEntry* directoryStructure,
@@ -278,6 +603,9 @@ void DirectoryRefresher::addModFilesToStructure(DirectoryEntry* directoryStructu
 {
   TimeThis tt("DirectoryRefresher::addModFilesToStructure()");
 
+  // the files are not added from a listing
+  setListing(modName, {});
+
   DirectoryStats dummy;
 
   if (stealFiles.length() > 0) {
@@ -296,6 +624,9 @@ void DirectoryRefresher::addModToStructure(DirectoryEntry* directoryStructure,
 {
   TimeThis tt("DirectoryRefresher::addModToStructure()");
 
+  // the files are not added from a listing
+  setListing(modName, {});
+
   DirectoryStats dummy;
 
   if (stealFiles.length() > 0) {
@@ -310,60 +641,55 @@ void DirectoryRefresher::addModToStructure(DirectoryEntry* directoryStructure,
   }
 }
 
-struct ModThread
+// a mod that's added by addMultipleModsFilesToStructure(): the listing of the
+// mod is loaded first, without touching the structure, and all the listings are
+// merged together afterwards; archives are added once the merge is done
+//
+struct ModTask
 {
-  GameFeatures* gameFeatures;
-  DirectoryRefreshProgress* progress = nullptr;
-  DirectoryEntry* ds                 = nullptr;
+  DirectoryRefresher* refresher   = nullptr;
+  DirectoryEntry* ds              = nullptr;
+  DirectorySnapshot* snapshot     = nullptr;
+  ArchiveIndexCache* archiveIndex = nullptr;
   QString modName;
   QString path;
   int prio = -1;
   QStringList archives;
-  std::set<QString> enabledArchives;
-  QStringList* loadOrder = nullptr;
-  DirectoryStats* stats  = nullptr;
-  env::DirectoryWalker walker;
-
-  std::condition_variable cv;
-  std::mutex mutex;
-  bool ready = false;
+  const std::set<QString>* enabledArchives = nullptr;
+  const QStringList* loadOrder             = nullptr;
+  DirectoryStats stats;
+  std::shared_ptr<const env::Directory> root;
 
-  void wakeup()
+  void list()
   {
-    {
-      std::scoped_lock lock(mutex);
-      ready = true;
-    }
-
-    cv.notify_one();
+    guarded([&] {
+      // the mod is only walked if it changed since the snapshot was taken; the
+      // sizes and times of files rewritten in place may be stale, see
+      // DirectorySnapshot
+      root = snapshot->get(env::DirectoryWalker::forThisThread(), modName, path);
+    });
   }
 
-  void run()
+  void addArchives()
   {
-    std::unique_lock lock(mutex);
-    cv.wait(lock, [&] {
-      return ready;
+    guarded([&] {
+      ds->addFromAllBSAs(modName, path, prio, archives, *enabledArchives, *loadOrder,
+                         stats, archiveIndex);
     });
+  }
 
-    SetThisThreadName(modName % " refresher");
-    ds->addFromOrigin(walker, modName, path, prio, *stats);
-
-    if (Settings::instance().archiveParsing()) {
-      ds->addFromAllBSAs(modName, path, prio, archives, enabledArchives, *loadOrder,
-                         *stats);
-    }
-
-    if (progress) {
-      progress->addDone();
+  template <class F>
+  void guarded(F&& f)
+  {
+    try {
+      f();
+    } catch (const std::exception& ex) {
+      emit refresher->error(DirectoryRefresher::tr("failed to read mod (%1): %2")
+                                .arg(modName, ex.what()));
     }
-
-    SetThisThreadName(QString::fromStdWString(L"idle refresher"));
-    ready = false;
   }
 };
 
-env::ThreadPool<ModThread> g_threads;
-
 void DirectoryRefresher::updateProgress(const DirectoryRefreshProgress* p)
 {
   // careful: called from multiple threads
@@ -374,14 +700,14 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
     MOShared::DirectoryEntry* directoryStructure, const std::vector<EntryInfo>& entries,
     DirectoryRefreshProgress* progress)
 {
-  std::vector<DirectoryStats> stats(entries.size());
+  std::vector<std::unique_ptr<ModTask>> tasks;
+  tasks.reserve(entries.size());
 
   if (progress) {
     progress->start(entries.size());
   }
 
-  log::debug("refresher: using {} threads", m_threadCount);
-  g_threads.setMax(m_threadCount);
+  log::debug("refresher: using {} threads", TaskScheduler::global().threadCount());
 
   QStringList loadOrder;
   if (Settings::instance().archiveParsing()) {
@@ -395,16 +721,18 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
     }
   }
 
-  for (std::size_t i = 0; i < entries.size(); ++i) {
-    const auto& e  = entries[i];
-    const int prio = e.priority + 1;
+  // setMods() may change the member while the tasks are running
+  const std::set<QString> enabledArchives = m_EnabledArchives;
 
-    if constexpr (DirectoryStats::EnableInstrumentation) {
-      stats[i].mod = entries[i].modName;
-    }
+  TaskGroup group;
+
+  // listings of the mods, loaded in parallel without touching the structure
+  for (const auto& e : entries) {
+    const int prio = e.priority + 1;
 
     try {
       if (e.stealFiles.length() > 0) {
+        setListing(e.modName, {});
         stealModFilesIntoStructure(directoryStructure, e.modName, prio, e.absolutePath,
                                    e.stealFiles);
 
@@ -412,42 +740,124 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
           progress->addDone();
         }
       } else {
-        auto& mt = g_threads.request();
-
-        mt.gameFeatures = &m_Core.gameFeatures();
-        mt.progress     = progress;
-        mt.ds           = directoryStructure;
-        mt.modName      = e.modName;
-        mt.path         = QDir::toNativeSeparators(e.absolutePath);
-        mt.prio         = prio;
-
-        mt.archives.clear();
-        for (auto&& a : e.archives) {
-          mt.archives.push_back(a);
-        }
+        auto& mt = *tasks.emplace_back(std::make_unique<ModTask>());
 
-        mt.enabledArchives.clear();
-        for (auto&& a : m_EnabledArchives) {
-          mt.enabledArchives.insert(a);
+        if constexpr (DirectoryStats::EnableInstrumentation) {
+          mt.stats.mod = e.modName;
         }
 
-        mt.loadOrder = &loadOrder;
-        mt.stats     = &stats[i];
-
-        mt.wakeup();
+        mt.refresher       = this;
+        mt.ds              = directoryStructure;
+        mt.snapshot        = &m_Snapshot;
+        mt.archiveIndex    = &m_ArchiveIndex;
+        mt.modName         = e.modName;
+        mt.path            = QDir::toNativeSeparators(e.absolutePath);
+        mt.prio            = prio;
+        mt.archives        = e.archives;
+        mt.enabledArchives = &enabledArchives;
+        mt.loadOrder       = &loadOrder;
+
+        group.run(e.modName, [&mt, progress] {
+          mt.list();
+
+          if (progress) {
+            progress->addDone();
+          }
+        });
       }
     } catch (const std::exception& ex) {
       emit error(tr("failed to read mod (%1): %2").arg(e.modName, ex.what()));
     }
   }
 
-  g_threads.waitForAll();
+  group.wait();
+  group.logTimings("refresher");
+
+  // the merge needs the listings by ascending priority
+  std::ranges::stable_sort(tasks, {}, [](auto&& mt) {
+    return mt->prio;
+  });
+
+  DirectoryStats mergeStats;
+
+  {
+    DirectoryMerge merge(*directoryStructure);
+
+    for (auto& mt : tasks) {
+      FilesOrigin& origin =
+          directoryStructure->createOrigin(mt->modName, mt->path, mt->prio, mt->stats);
+
+      // the listing failed, which has already been reported; the origin is
+      // kept so the mod still has one, but it has no loose files
+      if (!mt->root) {
+        log::warn("no listing for mod '{}', skipping its loose files", mt->modName);
+        continue;
+      }
+
+      merge.add(origin, *mt->root);
+    }
+
+    try {
+      merge.run();
+    } catch (const std::exception& ex) {
+      emit error(
+          tr("failed to add mods to the directory structure: %1").arg(ex.what()));
+    }
+
+    mergeStats = merge.stats();
+  }
+
+  for (auto& mt : tasks) {
+    if (mt->root) {
+      setListing(mt->modName, std::move(mt->root));
+    }
+  }
+
+  if (Settings::instance().archiveParsing()) {
+    for (auto& mt : tasks) {
+      group.run(mt->modName, [&mt] {
+        mt->addArchives();
+      });
+    }
+
+    group.wait();
+  }
 
   if constexpr (DirectoryStats::EnableInstrumentation) {
+    std::vector<DirectoryStats> stats;
+    stats.reserve(tasks.size() + 1);
+
+    for (auto& mt : tasks) {
+      stats.push_back(mt->stats);
+    }
+
+    mergeStats.mod = u"merge"_s;
+    stats.push_back(mergeStats);
+
     dumpStats(stats);
   }
 }
 
+void DirectoryRefresher::addOriginFromSnapshot(DirectoryEntry* directoryStructure,
+                                               const QString& originName,
+                                               const QString& directory, int priority)
+{
+  const auto root =
+      m_Snapshot.get(env::DirectoryWalker::forThisThread(), originName, directory);
+
+  DirectoryStats dummy;
+  FilesOrigin& origin =
+      directoryStructure->createOrigin(originName, directory, priority, dummy);
+
+  // listings from the snapshot are shared, they can't be consumed like the
+  // ones given to addFromList()
+  DirectoryMerge merge(*directoryStructure);
+  merge.add(origin, *root);
+  merge.run();
+
+  setListing(originName, root);
+}
+
 void DirectoryRefresher::refresh()
 {
   SetThisThreadName("DirectoryRefresher");
@@ -459,21 +869,29 @@ void DirectoryRefresher::refresh()
 
     m_Root.reset(new DirectoryEntry(u"data"_s, nullptr, 0));
 
+    loadCaches();
+
+    {
+      std::scoped_lock lock(m_ListingsMutex);
+      m_Listings.clear();
+    }
+
+    // listings recorded since the last refresh, by partial updates or by the
+    // file trees of the mods, are checked again before being used, but archives
+    // recorded by partial updates may be stale
+    m_ArchiveIndex.discardRecorded();
+
     IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
 
     QString dataDirectory =
         QDir::toNativeSeparators(game->dataDirectory().absolutePath());
 
-    {
-      DirectoryStats dummy;
-      m_Root->addFromOrigin(u"data"_s, dataDirectory, 0, dummy);
-    }
+    addOriginFromSnapshot(m_Root.get(), u"data"_s, dataDirectory, 0);
 
     for (auto directory : game->secondaryDataDirectories().toStdMap()) {
-      DirectoryStats dummy;
-      m_Root->addFromOrigin(directory.first,
+      addOriginFromSnapshot(m_Root.get(), directory.first,
                             QDir::toNativeSeparators(directory.second.absolutePath()),
-                            0, dummy);
+                            0);
     }
 
     std::ranges::sort(m_Mods, [](auto lhs, auto rhs) {
@@ -488,10 +906,27 @@ void DirectoryRefresher::refresh()
 
     m_lastFileCount = m_Root->getFileRegister()->highestCount();
     log::debug("refresher saw {} files", m_lastFileCount);
+
+    log::debug("refresher: {} archives from the cache, {} read",
+               m_ArchiveIndex.hits(), m_ArchiveIndex.misses());
+
+    m_Snapshot.commit();
+
+    // archives are only recorded when archive parsing is enabled, the cache is
+    // kept as it was otherwise
+    if (Settings::instance().archiveParsing()) {
+      m_ArchiveIndex.commit();
+    }
   }
 
   p->finish();
 
   emit progress(p);
   emit refreshed();
+
+  // the structure has already been handed over, this only delays the next
+  // refresh, which runs on this thread too
+  TimeThis ttSave("DirectoryRefresher::refresh() save caches");
+  m_Snapshot.save(snapshotPath());
+  m_ArchiveIndex.save(archiveIndexPath());
 }
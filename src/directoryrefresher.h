@@ -20,12 +20,18 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DIRECTORYREFRESHER_H
 #define DIRECTORYREFRESHER_H
 
+#include "directorysnapshot.h"
 #include "profile.h"
+#include "shared/archiveindex.h"
 #include "shared/directoryentry.h"
 #include "shared/fileregisterfwd.h"
 #include <QMutex>
 #include <QObject>
 #include <QStringList>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <tuple>
 #include <vector>
@@ -56,7 +62,21 @@ public:
     int priority;
   };
 
-  DirectoryRefresher(OrganizerCore* core, std::size_t threadCount);
+  // loose files added to or removed from an origin since the structure was
+  // built, see changesSinceRefresh()
+  //
+  struct OriginChanges
+  {
+    QString originName;
+    int priority;
+
+    // current listing of the origin
+    std::shared_ptr<const env::Directory> listing;
+
+    DirectorySnapshot::Changes changes;
+  };
+
+  DirectoryRefresher(OrganizerCore* core);
 
   /**
    * @brief retrieve the updated directory structure
@@ -134,6 +154,71 @@ public:
 
   void updateProgress(const DirectoryRefreshProgress* p);
 
+  /**
+   * @brief path of the file where the snapshot of the directory structure is
+   * saved between runs
+   */
+  static QString snapshotPath();
+
+  /**
+   * @brief path of the file where the index of every archive is cached between
+   * runs
+   */
+  static QString archiveIndexPath();
+
+  /**
+   * @brief changes every time the files of a mod may have been added, removed
+   * or renamed on disk, as seen by the refresher or by checkForChanges()
+   */
+  std::uint64_t listingChanges() const { return m_Snapshot.generation(); }
+
+  /**
+   * @brief checks whether files were added to, removed from or renamed in any
+   * directory of the last refresh since it was listed, in which case
+   * listingChanges() changes
+   *
+   * stats every directory of the last refresh, can be called from any thread
+   */
+  void checkForChanges() { m_Snapshot.checkCommitted(); }
+
+  /**
+   * @brief listing of the given directory, from the snapshot if it hasn't
+   * changed on disk; the directory is walked otherwise, and the refresher
+   * reuses that listing when it adds the same origin
+   *
+   * can be called from any thread
+   */
+  std::shared_ptr<const env::Directory> listing(const QString& originName,
+                                                const QString& directory);
+
+  /**
+   * @brief the loose files that were added to or removed from the given mods
+   * and the data directories since the structure was built
+   *
+   * the listing of an origin is compared with the one the structure was built
+   * from, which only requires walking the origins whose directories have
+   * changed on disk
+   *
+   * @param mods the active mods, as given to setMods()
+   * @return the origins that changed, or nothing if the changes can't be
+   * applied and the structure has to be refreshed instead, such as when an
+   * archive or a file in a data directory was added or removed, or when too
+   * many files have changed
+   */
+  std::optional<std::vector<OriginChanges>>
+  changesSinceRefresh(const std::vector<std::tuple<QString, QString, int>>& mods);
+
+  /**
+   * @brief applies the changes returned by changesSinceRefresh() to the
+   * structure
+   *
+   * @return false if nothing was changed because the structure has to be
+   * refreshed instead, such as when a removed file is also in an archive of
+   * the same mod
+   */
+  bool applyChanges(MOShared::DirectoryEntry* directoryStructure,
+                    const std::vector<OriginChanges>& changes);
+
 public slots:
 
   /**
@@ -154,13 +239,34 @@ private:
   std::set<QString> m_EnabledArchives;
   std::unique_ptr<MOShared::DirectoryEntry> m_Root;
   QMutex m_RefreshLock;
-  std::size_t m_threadCount;
   std::size_t m_lastFileCount;
+  DirectorySnapshot m_Snapshot;
+  MOShared::ArchiveIndexCache m_ArchiveIndex;
+  std::once_flag m_CachesLoaded;
+
+  // listings the current structure was built from, by origin name; origins
+  // that were added without a listing are not in there
+  std::map<QString, std::shared_ptr<const env::Directory>> m_Listings;
+  std::mutex m_ListingsMutex;
+
+  // loads the snapshot and the archive index the first time it's called
+  void loadCaches();
+
+  // the entries for the given mods, with the data directory of the mods
+  std::vector<EntryInfo>
+  entries(const std::vector<std::tuple<QString, QString, int>>& mods) const;
+
+  void setListing(const QString& originName,
+                  std::shared_ptr<const env::Directory> listing);
 
   void stealModFilesIntoStructure(MOShared::DirectoryEntry* directoryStructure,
                                   const QString& modName, int priority,
                                   const QString& directory,
                                   const QStringList& stealFiles);
+
+  void addOriginFromSnapshot(MOShared::DirectoryEntry* directoryStructure,
+                             const QString& originName, const QString& directory,
+                             int priority);
 };
 
 class DirectoryRefreshProgress : public QObject
@@ -0,0 +1,474 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "directorysnapshot.h"
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <log.h>
+#include <stack>
+
+using namespace MOBase;
+using namespace Qt::StringLiterals;
+
+namespace
+{
+
+// "MODS"
+constexpr quint32 Magic = 0x4D4F4453;
+
+qint64 directoryTime(const QString& path)
+{
+  const QFileInfo fi(path);
+
+  if (!fi.exists()) {
+    return -1;
+  }
+
+  return fi.lastModified().toMSecsSinceEpoch();
+}
+
+QString joinPath(const QString& parent, QStringView name)
+{
+  if (parent.isEmpty()) {
+    return name.toString();
+  }
+
+  return parent % "/"_L1 % name;
+}
+
+void writeDirectory(QDataStream& s, const env::Directory& d)
+{
+  s << d.name;
+
+  s << static_cast<quint32>(d.files.size());
+  for (const auto& f : d.files) {
+    s << f.name << static_cast<qint64>(f.lastModified.toMSecsSinceEpoch())
+      << static_cast<quint64>(f.size);
+  }
+
+  s << static_cast<quint32>(d.dirs.size());
+  for (const auto& sd : d.dirs) {
+    writeDirectory(s, sd);
+  }
+}
+
+void readDirectory(QDataStream& s, env::Directory& d)
+{
+  s >> d.name;
+  d.lcname = d.name.toLower();
+
+  quint32 fileCount = 0;
+  s >> fileCount;
+
+  if (s.status() != QDataStream::Ok) {
+    return;
+  }
+
+  d.files.reserve(fileCount);
+  for (quint32 i = 0; i < fileCount; ++i) {
+    QString name;
+    qint64 time  = 0;
+    quint64 size = 0;
+
+    s >> name >> time >> size;
+    if (s.status() != QDataStream::Ok) {
+      return;
+    }
+
+    d.files.emplace_back(name, QDateTime::fromMSecsSinceEpoch(time), size);
+  }
+
+  quint32 dirCount = 0;
+  s >> dirCount;
+
+  if (s.status() != QDataStream::Ok) {
+    return;
+  }
+
+  d.dirs.reserve(dirCount);
+  for (quint32 i = 0; i < dirCount; ++i) {
+    readDirectory(s, d.dirs.emplace_back());
+
+    if (s.status() != QDataStream::Ok) {
+      return;
+    }
+  }
+}
+
+std::size_t countFiles(const env::Directory& d)
+{
+  std::size_t n = d.files.size();
+
+  for (const auto& sd : d.dirs) {
+    n += countFiles(sd);
+  }
+
+  return n;
+}
+
+void addDeleted(const env::Directory& d, const QString& path, QStringList& deleted)
+{
+  for (const auto& f : d.files) {
+    deleted.push_back(joinPath(path, f.name));
+  }
+
+  for (const auto& sd : d.dirs) {
+    addDeleted(sd, joinPath(path, sd.name), deleted);
+  }
+}
+
+// compares the files and directories of two listings of the same directory,
+// added files go in `created`, which is a listing of the directory at `path`
+//
+void diffDirectory(const env::Directory& before, const env::Directory& after,
+                   const QString& path, env::Directory& created,
+                   DirectorySnapshot::Changes& c)
+{
+  QSet<QString> beforeFiles, afterFiles;
+  beforeFiles.reserve(static_cast<qsizetype>(before.files.size()));
+  afterFiles.reserve(static_cast<qsizetype>(after.files.size()));
+
+  for (const auto& f : before.files) {
+    beforeFiles.insert(f.lcname);
+  }
+
+  for (const auto& f : after.files) {
+    afterFiles.insert(f.lcname);
+
+    if (!beforeFiles.contains(f.lcname)) {
+      created.files.push_back(f);
+      ++c.createdCount;
+    }
+  }
+
+  for (const auto& f : before.files) {
+    if (!afterFiles.contains(f.lcname)) {
+      c.deleted.push_back(joinPath(path, f.name));
+    }
+  }
+
+  QHash<QString, const env::Directory*> beforeDirs;
+  QSet<QString> afterDirs;
+
+  for (const auto& sd : before.dirs) {
+    beforeDirs.insert(sd.lcname, &sd);
+  }
+
+  for (const auto& sd : after.dirs) {
+    afterDirs.insert(sd.lcname);
+
+    auto itor = beforeDirs.constFind(sd.lcname);
+
+    if (itor == beforeDirs.constEnd()) {
+      // new directory, everything in it was added
+      created.dirs.push_back(sd);
+      c.createdCount += countFiles(sd);
+      continue;
+    }
+
+    env::Directory sub(sd.name);
+    diffDirectory(**itor, sd, joinPath(path, sd.name), sub, c);
+
+    if (!sub.files.empty() || !sub.dirs.empty()) {
+      created.dirs.push_back(std::move(sub));
+    }
+  }
+
+  for (const auto& sd : before.dirs) {
+    if (!afterDirs.contains(sd.lcname)) {
+      addDeleted(sd, joinPath(path, sd.name), c.deleted);
+    }
+  }
+}
+
+}  // namespace
+
+bool DirectorySnapshot::load(const QString& file)
+{
+  std::unique_lock lock(m_OriginsMutex);
+  m_Origins.clear();
+
+  QFile f(file);
+  if (!f.open(QIODevice::ReadOnly)) {
+    // not necessarily a problem, the file may just not exist (yet)
+    return false;
+  }
+
+  QDataStream s(&f);
+
+  quint32 magic = 0, version = 0, count = 0;
+  s >> magic >> version;
+
+  if (magic != Magic || version != FormatVersion) {
+    log::debug("ignoring directory snapshot '{}', unknown format", file);
+    return false;
+  }
+
+  s >> count;
+
+  for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+    QString name;
+    Origin o;
+    quint32 stampCount = 0;
+
+    s >> name >> o.path >> stampCount;
+    if (s.status() != QDataStream::Ok) {
+      break;
+    }
+
+    o.stamps.reserve(stampCount);
+    for (quint32 j = 0; j < stampCount; ++j) {
+      DirectoryStamp ds;
+      s >> ds.path >> ds.lastModified;
+      o.stamps.push_back(std::move(ds));
+    }
+
+    auto root = std::make_shared<env::Directory>();
+    readDirectory(s, *root);
+    o.root = std::move(root);
+
+    m_Origins.emplace(std::move(name), std::move(o));
+  }
+
+  if (s.status() != QDataStream::Ok) {
+    log::error("directory snapshot '{}' is corrupted, ignoring", file);
+    m_Origins.clear();
+    return false;
+  }
+
+  log::debug("loaded directory snapshot with {} origins", m_Origins.size());
+  return true;
+}
+
+bool DirectorySnapshot::save(const QString& file) const
+{
+  QSaveFile f(file);
+  if (!f.open(QIODevice::WriteOnly)) {
+    log::error("failed to save directory snapshot to '{}': {}", file, f.errorString());
+    return false;
+  }
+
+  QDataStream s(&f);
+  std::shared_lock lock(m_OriginsMutex);
+
+  s << Magic << FormatVersion << static_cast<quint32>(m_Origins.size());
+
+  for (const auto& [name, o] : m_Origins) {
+    s << name << o.path << static_cast<quint32>(o.stamps.size());
+
+    for (const auto& ds : o.stamps) {
+      s << ds.path << ds.lastModified;
+    }
+
+    writeDirectory(s, *o.root);
+  }
+
+  if (s.status() != QDataStream::Ok || !f.commit()) {
+    log::error("failed to save directory snapshot to '{}': {}", file, f.errorString());
+    return false;
+  }
+
+  return true;
+}
+
+void DirectorySnapshot::commit()
+{
+  std::scoped_lock lock(m_OriginsMutex, m_RecordedMutex);
+  m_Origins = std::move(m_Recorded);
+  m_Recorded.clear();
+}
+
+const DirectorySnapshot::Origin*
+DirectorySnapshot::findUpToDate(const std::map<QString, Origin>& origins,
+                                const QString& originName, const QString& path)
+{
+  auto itor = origins.find(originName);
+
+  if (itor == origins.end() || itor->second.path != path ||
+      !isUpToDate(itor->second)) {
+    return nullptr;
+  }
+
+  return &itor->second;
+}
+
+void DirectorySnapshot::checkCommitted()
+{
+  std::scoped_lock checkLock(m_CheckMutex);
+
+  // the listings are shared, the copy only holds the paths and stamps; the
+  // directories are stat'ed without holding the lock
+  std::map<QString, Origin> origins;
+
+  {
+    std::shared_lock lock(m_OriginsMutex);
+    origins = m_Origins;
+  }
+
+  std::size_t stale = 0;
+
+  for (const auto& [name, o] : origins) {
+    for (const auto& ds : o.stamps) {
+      const QString path =
+          ds.path.isEmpty() ? o.path : QString(o.path % "/"_L1 % ds.path);
+
+      const qint64 time = directoryTime(path);
+
+      if (time != ds.lastModified) {
+        stale = qHashMulti(stale, name, ds.path, time);
+      }
+    }
+  }
+
+  // the same changes only count once, until they're walked
+  if (stale != 0 && stale != m_LastStale) {
+    ++m_Generation;
+  }
+
+  m_LastStale = stale;
+}
+
+bool DirectorySnapshot::isUpToDate(const Origin& o)
+{
+  for (const auto& ds : o.stamps) {
+    const QString path =
+        ds.path.isEmpty() ? o.path : QString(o.path % "/"_L1 % ds.path);
+
+    if (directoryTime(path) != ds.lastModified) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+DirectorySnapshot::Origin DirectorySnapshot::walk(env::DirectoryWalker& walker,
+                                                  const QString& path)
+{
+  struct Context
+  {
+    Origin& origin;
+    std::stack<env::Directory*> current;
+    std::stack<QString> paths;
+  };
+
+  Origin o;
+  o.path = path;
+
+  auto root = std::make_shared<env::Directory>();
+  o.root    = root;
+
+  // the time of a directory is taken before it is listed, so a change made
+  // while it is being walked invalidates it on the next lookup
+  o.stamps.push_back({QString(), directoryTime(path)});
+
+  if (o.stamps.back().lastModified == -1) {
+    return o;
+  }
+
+  Context cx = {o};
+  cx.current.push(root.get());
+  cx.paths.push(QString());
+
+  walker.forEachEntry(
+      path, &cx,
+      [](void* pcx, QStringView name) {
+        Context* cx = (Context*)pcx;
+
+        const QString relative = joinPath(cx->paths.top(), name);
+        cx->origin.stamps.push_back(
+            {relative, directoryTime(cx->origin.path % "/"_L1 % relative)});
+
+        cx->current.top()->dirs.push_back(env::Directory(name));
+        cx->current.push(&cx->current.top()->dirs.back());
+        cx->paths.push(relative);
+      },
+
+      [](void* pcx, QStringView) {
+        Context* cx = (Context*)pcx;
+        cx->current.pop();
+        cx->paths.pop();
+      },
+
+      [](void* pcx, QStringView name, QDateTime ft, uint64_t s) {
+        Context* cx = (Context*)pcx;
+        cx->current.top()->files.push_back(env::File(name, ft, s));
+      });
+
+  return o;
+}
+
+DirectorySnapshot::Changes DirectorySnapshot::diff(const env::Directory& before,
+                                                   const env::Directory& after)
+{
+  Changes c;
+  diffDirectory(before, after, QString(), c.created, c);
+  return c;
+}
+
+void DirectorySnapshot::record(const QString& originName, Origin origin)
+{
+  std::scoped_lock lock(m_RecordedMutex);
+  m_Recorded.insert_or_assign(originName, std::move(origin));
+}
+
+std::shared_ptr<const env::Directory>
+DirectorySnapshot::get(env::DirectoryWalker& walker, const QString& originName,
+                       const QString& path, bool* hit)
+{
+  if (hit) {
+    *hit = true;
+  }
+
+  // already asked for since the last commit, typically by the file tree of the
+  // mod before the refresher gets to it
+  {
+    std::shared_lock lock(m_RecordedMutex);
+
+    if (const Origin* o = findUpToDate(m_Recorded, originName, path)) {
+      return o->root;
+    }
+  }
+
+  {
+    std::shared_lock lock(m_OriginsMutex);
+
+    if (const Origin* o = findUpToDate(m_Origins, originName, path)) {
+      // still up to date, keep it for the next commit
+      record(originName, *o);
+      return o->root;
+    }
+  }
+
+  if (hit) {
+    *hit = false;
+  }
+
+  ++m_Generation;
+
+  Origin o  = walk(walker, path);
+  auto root = o.root;
+  record(originName, std::move(o));
+
+  return root;
+}
@@ -0,0 +1,204 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DIRECTORYSNAPSHOT_H
+#define DIRECTORYSNAPSHOT_H
+
+#include "envfs.h"
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+/**
+ * @brief on-disk snapshot of the loose files provided by every origin of the
+ * directory structure
+ *
+ * the refresher records the listing of every origin it walks; the snapshot is
+ * saved once the refresh is done and loaded on the next start. an origin is
+ * only walked again when the modification time of one of its directories has
+ * changed since it was recorded, which is the case when files or directories
+ * are added, removed or renamed
+ *
+ * the size and modification time of the files themselves are not checked: a
+ * file rewritten in place, which doesn't touch its directory, keeps the size
+ * and time it had when it was recorded until the origin is walked again for
+ * another reason; only the presence of files can be relied upon
+ *
+ * listings are immutable once recorded and are shared with whoever asked for
+ * them, such as the file trees of the mods, so a directory is only walked once
+ * no matter how many parts of MO need its content
+ *
+ * all functions can be called from multiple threads
+ **/
+class DirectorySnapshot
+{
+public:
+  // bumped every time the format of the file changes, snapshots with a
+  // different version are ignored
+  static constexpr quint32 FormatVersion = 1;
+
+  // modification time of a directory when it was walked
+  //
+  struct DirectoryStamp
+  {
+    // path relative to the origin, empty for the root
+    QString path;
+
+    // milliseconds since epoch, -1 if the directory did not exist
+    qint64 lastModified = -1;
+  };
+
+  // listing of an origin
+  //
+  struct Origin
+  {
+    QString path;
+    std::shared_ptr<const env::Directory> root;
+    std::vector<DirectoryStamp> stamps;
+  };
+
+  // files added to or removed from a listing, see diff()
+  //
+  struct Changes
+  {
+    // listing of the files that were added only, along with their parent
+    // directories
+    env::Directory created;
+    std::size_t createdCount = 0;
+
+    // paths of the files that were removed, relative to the origin
+    QStringList deleted;
+
+    bool empty() const { return (createdCount == 0 && deleted.empty()); }
+  };
+
+  DirectorySnapshot() = default;
+
+  // noncopyable
+  DirectorySnapshot(const DirectorySnapshot&)            = delete;
+  DirectorySnapshot& operator=(const DirectorySnapshot&) = delete;
+
+  /**
+   * @brief loads the snapshot from the given file, replacing anything that was
+   * loaded before
+   *
+   * @return false if the file does not exist or is invalid, in which case the
+   * snapshot is empty
+   **/
+  bool load(const QString& file);
+
+  /**
+   * @brief saves the origins that were recorded since the last commit() to the
+   * given file
+   **/
+  bool save(const QString& file) const;
+
+  /**
+   * @brief makes the origins recorded since the last call the current ones,
+   * origins that were not recorded are forgotten
+   **/
+  void commit();
+
+  /**
+   * @brief walks the given directory and returns its listing along with the
+   * modification times of all its directories
+   **/
+  static Origin walk(env::DirectoryWalker& walker, const QString& path);
+
+  /**
+   * @brief compares two listings of the same origin
+   *
+   * files are compared by name only, a file that was renamed shows up as both
+   * removed and added, but a file that was modified in place doesn't show up
+   **/
+  static Changes diff(const env::Directory& before, const env::Directory& after);
+
+  /**
+   * @brief remembers the listing of the given origin, to be saved on the next
+   * commit()
+   **/
+  void record(const QString& originName, Origin origin);
+
+  /**
+   * @brief returns the listing of the given origin, walking it only if it has
+   * changed on disk since it was recorded
+   *
+   * origins recorded since the last commit() are preferred over the committed
+   * ones; checking an origin stats every one of its directories, but none of
+   * its files, see the class comment
+   *
+   * @param hit set to true if the listing came from the snapshot
+   **/
+  std::shared_ptr<const env::Directory> get(env::DirectoryWalker& walker,
+                                            const QString& originName,
+                                            const QString& path, bool* hit = nullptr);
+
+  std::size_t size() const
+  {
+    std::shared_lock lock(m_OriginsMutex);
+    return m_Origins.size();
+  }
+
+  /**
+   * @brief changes whenever files may have been added to or removed from an
+   * origin: every time get() has to walk an origin, and every time
+   * checkCommitted() finds origins that changed since they were walked
+   **/
+  std::uint64_t generation() const { return m_Generation; }
+
+  /**
+   * @brief bumps generation() if a directory of a committed origin was
+   * modified since it was walked and wasn't already found to be by the last
+   * check, such as when files are added to a mod outside of MO
+   *
+   * stats every directory, but none of the files; meant to be called off the
+   * ui thread
+   **/
+  void checkCommitted();
+
+private:
+  // origins that were loaded or committed
+  std::map<QString, Origin> m_Origins;
+  mutable std::shared_mutex m_OriginsMutex;
+
+  // origins recorded during the current refresh
+  std::map<QString, Origin> m_Recorded;
+  mutable std::shared_mutex m_RecordedMutex;
+
+  std::atomic<std::uint64_t> m_Generation = 0;
+
+  // hash of the directories that were out of date in the last
+  // checkCommitted() along with their times, 0 if they were all up to date
+  std::size_t m_LastStale = 0;
+  std::mutex m_CheckMutex;
+
+  static bool isUpToDate(const Origin& o);
+
+  // the origin if it's in the given map and still up to date, null otherwise
+  static const Origin* findUpToDate(const std::map<QString, Origin>& origins,
+                                    const QString& originName, const QString& path);
+};
+
+#endif  // DIRECTORYSNAPSHOT_H
@@ -28,7 +28,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "nxmurl.h"
 #include "organizercore.h"
 #include "selectiondialog.h"
+#include "settings.h"
 #include "shared/util.h"
+#include "taskscheduler.h"
 #include "utility.h"
 #include <nxmurl.h>
 #include <report.h>
@@ -99,7 +101,15 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
       0)
     return nullptr;
 
-  QSettings metaFile(metaFileName, QSettings::IniFormat);
+  return createFromMeta(filePath, ModMeta::read(metaFileName), showHidden,
+                        fileSize ? *fileSize : QFileInfo(filePath).size());
+}
+
+DownloadManager::DownloadInfo*
+DownloadManager::DownloadInfo::createFromMeta(const QString& filePath,
+                                              const ModMeta& metaFile, bool showHidden,
+                                              uint64_t fileSize)
+{
   const bool hidden = metaFile.value("removed", false).toBool();
   if (!showHidden && hidden) {
     return nullptr;
@@ -130,7 +140,7 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
 
   info->m_DownloadID = newDownloadID();
   info->m_Output.setFileName(filePath);
-  info->m_TotalSize      = fileSize ? *fileSize : QFileInfo(filePath).size();
+  info->m_TotalSize      = fileSize;
   info->m_PreResumeSize  = info->m_TotalSize;
   info->m_CurrentUrl     = 0;
   info->m_Urls           = metaFile.value("url", "").toString().split(";");
@@ -384,19 +394,6 @@ void DownloadManager::refreshList()
   ModelResetGuard guard(*this);
 
   try {
-    // remove finished downloads
-    for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin();
-         iter != m_ActiveDownloads.end();) {
-      if (((*iter)->m_State == STATE_READY) || ((*iter)->m_State == STATE_INSTALLED) ||
-          ((*iter)->m_State == STATE_UNINSTALLED)) {
-        m_ByID.remove((*iter)->m_DownloadID);
-        delete *iter;
-        iter = m_ActiveDownloads.erase(iter);
-      } else {
-        ++iter;
-      }
-    }
-
     const QStringList supportedExtensions =
         m_OrganizerCore->installationManager()->getSupportedExtensions();
     std::vector<QString> nameFilters;
@@ -406,77 +403,174 @@ void DownloadManager::refreshList()
 
     nameFilters.push_back(QString(UNFINISHED).toLower());
 
-    QDir dir(QDir::fromNativeSeparators(m_OutputDirectory));
+    const QString outputDirectory = QDir::fromNativeSeparators(m_OutputDirectory);
+
+    struct Entry
+    {
+      QString name;
+      qint64 lastModified;
+      uint64_t size;
+    };
+
+    // everything is listed once, the .meta files along with the downloads,
+    // keyed by the lowercase name of the download
+    struct Context
+    {
+      std::vector<QString>& extensions;
+      std::map<QString, Entry> downloads;
+      std::map<QString, Entry> metas;
+
+      // lowercase names of all the other files, for orphaned .meta files
+      std::set<QString> others;
+    };
+
+    Context cx = {nameFilters};
+
+    env::forEachEntry(
+        QDir::toNativeSeparators(m_OutputDirectory), &cx, nullptr, nullptr,
+        [](void* data, QStringView f, QDateTime ft, uint64_t size) {
+          auto& cx = *static_cast<Context*>(data);
+
+          QString lc = MOShared::ToLowerCopy(f);
+          Entry e    = {f.toString(), ft.toMSecsSinceEpoch(), size};
+
+          if (lc.endsWith(u".meta"_s)) {
+            cx.others.insert(lc);
+            lc.chop(5);
+            cx.metas.emplace(std::move(lc), std::move(e));
+            return;
+          }
+
+          for (auto&& ext : cx.extensions) {
+            if (lc.endsWith(ext)) {
+              cx.downloads.emplace(std::move(lc), std::move(e));
+              return;
+            }
+          }
+
+          cx.others.insert(std::move(lc));
+        });
 
     // find orphaned meta files and delete them (sounds cruel but it's better for
     // everyone)
     QStringList orphans;
-    QStringList metaFiles = dir.entryList(QStringList() << "*.meta");
-    foreach (const QString& metaFile, metaFiles) {
-      QString baseFile = metaFile.left(metaFile.length() - 5);
-      if (!QFile::exists(dir.absoluteFilePath(baseFile))) {
-        orphans.append(dir.absoluteFilePath(metaFile));
+    QDir dir(outputDirectory);
+
+    for (const auto& [lc, meta] : cx.metas) {
+      if (!cx.downloads.contains(lc) && !cx.others.contains(lc)) {
+        orphans.append(dir.absoluteFilePath(meta.name));
       }
     }
+
     if (orphans.size() > 0) {
       log::debug("{} orphaned meta files will be deleted", orphans.size());
       shellDelete(orphans, true);
     }
 
-    std::set<QString> seen;
+    const auto metaStamp = [&](const QString& lc, const QString& name) {
+      ModMetaCache::Stamp s;
+      s.path = outputDirectory % u"/"_s % name % u".meta"_s;
 
-    struct Context
-    {
-      DownloadManager& self;
-      std::set<QString>& seen;
-      std::vector<QString>& extensions;
+      auto itor = cx.metas.find(lc);
+      if (itor != cx.metas.end()) {
+        s.size         = itor->second.size;
+        s.lastModified = itor->second.lastModified;
+      }
+
+      return s;
     };
 
-    Context cx = {*this, seen, nameFilters};
+    // finished downloads are kept as long as neither the file nor its .meta
+    // have changed, the others are read again
+    std::vector<ModMetaCache::Stamp> kept;
+
+    for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin();
+         iter != m_ActiveDownloads.end();) {
+      DownloadInfo* info = *iter;
+
+      if ((info->m_State == STATE_READY) || (info->m_State == STATE_INSTALLED) ||
+          (info->m_State == STATE_UNINSTALLED)) {
+        const QString name = QFileInfo(info->m_Output.fileName()).fileName();
+        const QString lc   = name.toLower();
+
+        auto itor = cx.downloads.find(lc);
+        bool keep = (itor != cx.downloads.end()) &&
+                    (static_cast<uint64_t>(info->m_TotalSize) == itor->second.size) &&
+                    (m_ShowHidden || !info->m_Hidden);
+
+        if (keep) {
+          const auto stamp = metaStamp(lc, name);
+          keep = (stamp.size == info->m_MetaStamp.size &&
+                  stamp.lastModified == info->m_MetaStamp.lastModified);
+        }
+
+        if (!keep) {
+          m_ByID.remove(info->m_DownloadID);
+          delete info;
+          iter = m_ActiveDownloads.erase(iter);
+          continue;
+        }
+
+        kept.push_back(info->m_MetaStamp);
+      }
+
+      ++iter;
+    }
+
+    std::set<QString> seen;
 
     for (auto&& d : m_ActiveDownloads) {
-      cx.seen.insert(d->m_FileName.toLower());
-      cx.seen.insert(QFileInfo(d->m_Output.fileName()).fileName().toLower());
+      seen.insert(d->m_FileName.toLower());
+      seen.insert(QFileInfo(d->m_Output.fileName()).fileName().toLower());
     }
 
-    env::forEachEntry(
-        QDir::toNativeSeparators(m_OutputDirectory), &cx, nullptr, nullptr,
-        [](void* data, QStringView f, QDateTime, uint64_t size) {
-          auto& cx = *static_cast<Context*>(data);
+    // new or changed downloads, their .meta files are only read if they're not
+    // in the index
+    std::vector<const Entry*> added;
+    std::vector<ModMetaCache::Stamp> stamps;
 
-          QString lc = MOShared::ToLowerCopy(f);
+    for (const auto& [lc, e] : cx.downloads) {
+      if (!seen.contains(lc)) {
+        added.push_back(&e);
+        stamps.push_back(metaStamp(lc, e.name));
+      }
+    }
 
-          bool interestingExt = false;
-          for (auto&& ext : cx.extensions) {
-            if (lc.endsWith(ext)) {
-              interestingExt = true;
-              break;
-            }
-          }
+    const std::size_t addedCount = stamps.size();
 
-          if (!interestingExt) {
-            return;
-          }
+    // kept downloads are given too, so they stay in the index
+    stamps.insert(stamps.end(), kept.begin(), kept.end());
 
-          if (cx.seen.contains(lc)) {
-            return;
-          }
+    const QString indexFile = Settings::instance().paths().cache() + "/downloads.meta";
 
-          QString fileName =
-              QDir::fromNativeSeparators(cx.self.m_OutputDirectory) % u"/"_s % f;
+    if (indexFile != m_MetaIndexFile) {
+      m_MetaIndex.load(indexFile);
+      m_MetaIndexFile = indexFile;
+    }
 
-          DownloadInfo* info = DownloadInfo::createFromMeta(
-              fileName, cx.self.m_ShowHidden, cx.self.m_OutputDirectory, size);
+    const auto metas = m_MetaIndex.get(stamps, TaskScheduler::global().threadCount());
 
-          if (info == nullptr) {
-            return;
-          }
+    log::debug("download metas: {} from the index, {} read", m_MetaIndex.hits(),
+               m_MetaIndex.misses());
 
-          cx.self.m_ActiveDownloads.push_front(info);
-          cx.self.m_ByID.insert(info->m_DownloadID, info);
-          cx.seen.insert(std::move(lc));
-          cx.seen.insert(QFileInfo(info->m_Output.fileName()).fileName().toLower());
-        });
+    m_MetaIndex.removeUnseen();
+    m_MetaIndex.save(indexFile);
+
+    for (std::size_t i = 0; i < addedCount; ++i) {
+      const QString fileName = outputDirectory % u"/"_s % added[i]->name;
+
+      DownloadInfo* info = DownloadInfo::createFromMeta(fileName, *metas[i],
+                                                        m_ShowHidden, added[i]->size);
+
+      if (info == nullptr) {
+        continue;
+      }
+
+      info->m_MetaStamp = stamps[i];
+
+      m_ActiveDownloads.push_front(info);
+      m_ByID.insert(info->m_DownloadID, info);
+    }
 
     log::debug("saw {} downloads", m_ActiveDownloads.size());
   } catch (const std::bad_alloc&) {
@@ -677,14 +771,9 @@ bool DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
     newDownload->m_Urls = QStringList(reply->url().toString());
   }
 
-  QIODevice::OpenMode mode = QIODevice::WriteOnly;
-  if (resume) {
-    mode |= QIODevice::Append;
-  }
-
   newDownload->m_StartTime.start();
 
-  if (!newDownload->m_Output.open(mode)) {
+  if (!newDownload->m_Output.open(resume)) {
     reportError(tr("failed to download %1: could not open output file: %2")
                     .arg(reply->url().toString())
                     .arg(newDownload->m_Output.fileName()));
@@ -1189,6 +1278,14 @@ void DownloadManager::queryInfoMd5(int index, bool askIfNotFound)
   info->m_GamesToQuery << m_ManagedGame->gameShortName();
   info->m_GamesToQuery << m_ManagedGame->validShortNames();
 
+  if (!info->m_Hash.isEmpty()) {
+    // already known from when the file was downloaded
+    info->m_ReQueried     = true;
+    info->m_AskIfNotFound = askIfNotFound;
+    setState(info, STATE_FETCHINGMODINFO_MD5);
+    return;
+  }
+
   QFile downloadFile(info->m_FileName);
   if (!downloadFile.exists()) {
     downloadFile.setFileName(m_OrganizerCore->downloadsPath() + "/" + info->m_FileName);
@@ -1438,7 +1535,7 @@ QDateTime DownloadManager::getFileTime(int index) const
 
   DownloadInfo* info = m_ActiveDownloads.at(index);
   if (!info->m_Created.isValid()) {
-    QFileInfo fileInfo(info->m_Output);
+    QFileInfo fileInfo(info->m_Output.fileName());
     info->m_Created = fileInfo.birthTime();
     if (!info->m_Created.isValid())
       info->m_Created = fileInfo.metadataChangeTime();
@@ -2370,10 +2467,8 @@ void DownloadManager::finishDownload(DownloadID id)
   int index = indexByInfo(info);
 
   QNetworkReply* reply = info->m_Reply;
-  QByteArray data;
   if (reply->isOpen() && info->m_HasData) {
-    data = reply->readAll();
-    info->m_Output.write(data);
+    info->m_Output.write(*reply);
   }
   info->m_Output.close();
   TaskProgressManager::instance().forgetMe(info->m_TaskProgressId);
@@ -2415,7 +2510,7 @@ void DownloadManager::finishDownload(DownloadID id)
     setState(info, STATE_CANCELED);
   } else if (info->m_State == STATE_PAUSING) {
     if (info->m_Output.isOpen() && info->m_HasData) {
-      info->m_Output.write(info->m_Reply->readAll());
+      info->m_Output.write(*info->m_Reply);
     }
     setState(info, STATE_PAUSED);
   }
@@ -2453,6 +2548,10 @@ void DownloadManager::finishDownload(DownloadID id)
       }
     }
 
+    // computed while the data was written, saves reading the file again when
+    // querying by md5
+    info->m_Hash = info->m_Output.hash();
+
     bool isNexus = info->m_FileInfo->repository == "Nexus";
     // need to change state before changing the file name, otherwise .unfinished is
     // appended
@@ -2463,7 +2562,7 @@ void DownloadManager::finishDownload(DownloadID id)
     }
 
     QString newName = getFileNameFromNetworkReply(reply);
-    QString oldName = QFileInfo(info->m_Output).fileName();
+    QString oldName = QFileInfo(info->m_Output.fileName()).fileName();
 
     if (!newName.isEmpty() && (oldName.isEmpty())) {
       info->setName(getDownloadFileName(newName), true);
@@ -2513,8 +2612,7 @@ void DownloadManager::metaDataChanged()
         info->setName(getDownloadFileName(newName), true);
       }
       notifyRowChanged(index);
-      if (!info->m_Output.isOpen() &&
-          !info->m_Output.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      if (!info->m_Output.isOpen() && !info->m_Output.open(true)) {
         reportError(tr("failed to re-open %1").arg(info->m_FileName));
         setState(info, STATE_CANCELING);
       }
@@ -2532,19 +2630,25 @@ void DownloadManager::managedGameChanged(MOBase::IPluginGame const* managedGame)
 void DownloadManager::writeData(DownloadInfo* info)
 {
   if (info != nullptr) {
-    qint64 ret = info->m_Output.write(info->m_Reply->readAll());
-    if (ret < info->m_Reply->size()) {
+    // the content length is only known once the headers have been received,
+    // which is always the case by the time data arrives
+    const QVariant length = info->m_Reply->header(QNetworkRequest::ContentLengthHeader);
+    if (length.isValid()) {
+      info->m_Output.reserve(length.toLongLong());
+    }
+
+    if (!info->m_Output.write(*info->m_Reply)) {
       QString fileName =
           info->m_FileName;  // m_FileName may be destroyed after setState
+      const QString error = info->m_Output.errorString();
       setState(info, DownloadState::STATE_CANCELED);
 
-      log::error("Unable to write download \"{}\" to drive (return {})",
-                 info->m_FileName, ret);
+      log::error("Unable to write download \"{}\" to drive ({})", fileName, error);
 
-      reportError(tr("Unable to write download to drive (return %1).\n"
+      reportError(tr("Unable to write download to drive (%1).\n"
                      "Check the drive's available storage.\n\n"
                      "Canceling download \"%2\"...")
-                      .arg(ret)
+                      .arg(error)
                       .arg(fileName));
     }
   }
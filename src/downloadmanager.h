@@ -20,6 +20,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DOWNLOADMANAGER_H
 #define DOWNLOADMANAGER_H
 
+#include "downloadsink.h"
+#include "modmetacache.h"
 #include "serverinfo.h"
 #include <QElapsedTimer>
 #include <QFile>
@@ -189,7 +191,7 @@ private:
     qint64 m_DownloadTimeLast;
     DownloadID m_DownloadID;
     QString m_FileName;
-    QFile m_Output;
+    DownloadSink m_Output;
     QNetworkReply* m_Reply;
     QElapsedTimer m_StartTime;
     qint64 m_PreResumeSize;
@@ -216,6 +218,10 @@ private:
 
     bool m_Hidden;
 
+    // the .meta file as it was when the download was read by refreshList(),
+    // the download is only read again once the file has changed
+    ModMetaCache::Stamp m_MetaStamp;
+
     /**
      * @brief Issue a new download id.
      *
@@ -240,6 +246,11 @@ private:
                                         const QString outputDirectory,
                                         std::optional<uint64_t> fileSize = {});
 
+    // same as above with the values of the .meta file already read
+    //
+    static DownloadInfo* createFromMeta(const QString& filePath, const ModMeta& meta,
+                                        bool showHidden, uint64_t fileSize);
+
     /**
      * @brief rename the file
      * this will change the file name as well as the display name. It will automatically
@@ -819,6 +830,11 @@ private:
 
   bool m_ShowHidden;
 
+  // parsed .meta files of the downloads, saved between runs so refreshList()
+  // only reads the files that are new or have changed
+  ModMetaCache m_MetaIndex{QStringLiteral("download meta index")};
+  QString m_MetaIndexFile;
+
   MOBase::IPluginGame const* m_ManagedGame;
 };
 
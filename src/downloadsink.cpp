@@ -0,0 +1,340 @@
+#include "downloadsink.h"
+#include "thread_utils.h"
+#include <QIODevice>
+#include <algorithm>
+#include <log.h>
+
+#ifdef __unix__
+#include <fcntl.h>
+#else
+#include <io.h>
+#include <windows.h>
+#endif
+
+using namespace MOBase;
+
+DownloadSink::~DownloadSink()
+{
+  close();
+}
+
+QString DownloadSink::fileName() const
+{
+  return m_File.fileName();
+}
+
+void DownloadSink::setFileName(const QString& name)
+{
+  if (!m_Open) {
+    m_File.setFileName(name);
+  }
+}
+
+bool DownloadSink::isOpen() const
+{
+  return m_Open;
+}
+
+bool DownloadSink::open(bool append)
+{
+  if (m_Open) {
+    return true;
+  }
+
+  // chunks are already large, QFile's buffer would only add a copy
+  QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Unbuffered;
+  if (append) {
+    mode |= QIODevice::Append;
+  }
+
+  if (!m_File.open(mode)) {
+    return false;
+  }
+
+  m_Open          = true;
+  m_Reserved      = false;
+  m_OpenSize      = m_File.size();
+  m_Accepted      = 0;
+  m_CurrentSize   = 0;
+  m_Closing       = false;
+  m_Written       = 0;
+  m_WriterStopped = false;
+  m_Failed        = false;
+  m_HashFromFile  = (m_OpenSize > 0);
+  m_HashValid     = true;
+  m_Error.clear();
+  m_Result.clear();
+  m_Hash.reset();
+
+  m_Thread = MOShared::startSafeThread([&] {
+    threadFun();
+  });
+
+  if (m_HashFromFile) {
+    m_HashThread = MOShared::startSafeThread([&] {
+      hashFile();
+    });
+  }
+
+  return true;
+}
+
+void DownloadSink::reserve(qint64 bytes)
+{
+  if (!m_Open || m_Reserved || bytes <= 0) {
+    return;
+  }
+
+  m_Reserved = true;
+  push({{}, m_OpenSize + bytes});
+}
+
+bool DownloadSink::write(QIODevice& device)
+{
+  if (!m_Open || m_Failed) {
+    return false;
+  }
+
+  for (;;) {
+    if (m_Current.size() < ChunkSize) {
+      m_Current.resize(ChunkSize);
+    }
+
+    const qint64 n =
+        device.read(m_Current.data() + m_CurrentSize, ChunkSize - m_CurrentSize);
+
+    if (n <= 0) {
+      break;
+    }
+
+    m_CurrentSize += n;
+    m_Accepted += n;
+
+    if (m_CurrentSize == ChunkSize) {
+      flushCurrent();
+    }
+  }
+
+  return !m_Failed;
+}
+
+bool DownloadSink::close()
+{
+  if (!m_Open) {
+    return !m_Failed;
+  }
+
+  flushCurrent();
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Closing = true;
+  }
+
+  m_Wake.notify_one();
+  m_Thread.join();
+
+  if (m_HashThread.joinable()) {
+    m_HashThread.join();
+  }
+
+  m_File.close();
+  m_Open = false;
+
+  m_Current = {};
+  m_Free.clear();
+
+  if (m_Failed) {
+    log::error("failed to write download '{}', {}", m_File.fileName(), m_Error);
+    return false;
+  }
+
+  if (m_HashValid) {
+    m_Result = m_Hash.result();
+  }
+
+  return true;
+}
+
+qint64 DownloadSink::size() const
+{
+  if (m_Open) {
+    return m_OpenSize + m_Accepted;
+  }
+
+  return m_File.size();
+}
+
+bool DownloadSink::rename(const QString& newName)
+{
+  close();
+  return m_File.rename(newName);
+}
+
+bool DownloadSink::remove()
+{
+  close();
+  return m_File.remove();
+}
+
+QString DownloadSink::errorString() const
+{
+  std::scoped_lock lock(m_Mutex);
+  return m_Error;
+}
+
+void DownloadSink::push(Job job)
+{
+  {
+    // this is called from the ui thread, the queue grows instead of waiting
+    // for the disk
+    std::scoped_lock lock(m_Mutex);
+    m_Queue.push_back(std::move(job));
+  }
+
+  m_Wake.notify_one();
+}
+
+void DownloadSink::flushCurrent()
+{
+  if (m_CurrentSize == 0) {
+    return;
+  }
+
+  m_Current.resize(m_CurrentSize);
+  m_CurrentSize = 0;
+
+  push({std::move(m_Current), 0});
+
+  // reuse a buffer that was already written
+  std::scoped_lock lock(m_Mutex);
+  if (!m_Free.empty()) {
+    m_Current = std::move(m_Free.back());
+    m_Free.pop_back();
+  }
+}
+
+void DownloadSink::threadFun()
+{
+  for (;;) {
+    Job job;
+
+    {
+      std::unique_lock lock(m_Mutex);
+
+      m_Wake.wait(lock, [&] {
+        return !m_Queue.empty() || m_Closing;
+      });
+
+      if (m_Queue.empty()) {
+        m_WriterStopped = true;
+        break;
+      }
+
+      job = std::move(m_Queue.front());
+      m_Queue.pop_front();
+    }
+
+    if (job.reserve > 0) {
+      preallocate(job.reserve);
+      continue;
+    }
+
+    // data that comes after a failed write is dropped, the download is
+    // canceled anyway
+    qint64 written = 0;
+
+    if (!m_Failed) {
+      written = m_File.write(job.data);
+
+      if (written == job.data.size()) {
+        if (!m_HashFromFile) {
+          m_Hash.addData(job.data);
+        }
+      } else {
+        std::scoped_lock lock(m_Mutex);
+        m_Error  = m_File.errorString();
+        m_Failed = true;
+        written  = 0;
+      }
+    }
+
+    {
+      std::scoped_lock lock(m_Mutex);
+      m_Written += written;
+      m_Free.push_back(std::move(job.data));
+    }
+
+    if (m_HashFromFile) {
+      m_WrittenChanged.notify_one();
+    }
+  }
+
+  m_WrittenChanged.notify_one();
+}
+
+void DownloadSink::hashFile()
+{
+  // the download is being resumed, the md5 must include what's already there;
+  // the whole file is read back in order, up to what the thread has written
+  QFile file(m_File.fileName());
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    log::warn("can't hash existing data of download '{}', {}", file.fileName(),
+              file.errorString());
+
+    m_HashValid = false;
+    return;
+  }
+
+  QByteArray buffer(ChunkSize, Qt::Uninitialized);
+  qint64 hashed = 0;
+
+  for (;;) {
+    qint64 available = 0;
+
+    {
+      std::unique_lock lock(m_Mutex);
+
+      m_WrittenChanged.wait(lock, [&] {
+        return m_OpenSize + m_Written > hashed || m_WriterStopped;
+      });
+
+      available = m_OpenSize + m_Written;
+
+      if (available <= hashed) {
+        break;
+      }
+    }
+
+    while (hashed < available) {
+      const qint64 n =
+          file.read(buffer.data(), std::min(ChunkSize, available - hashed));
+
+      if (n <= 0) {
+        log::warn("can't hash download '{}', {}", file.fileName(), file.errorString());
+
+        m_HashValid = false;
+        return;
+      }
+
+      m_Hash.addData(QByteArrayView(buffer.data(), n));
+      hashed += n;
+    }
+  }
+}
+
+void DownloadSink::preallocate(qint64 size)
+{
+  // failures are ignored, the space will be allocated by the writes
+#ifdef __unix__
+  ::fallocate(m_File.handle(), FALLOC_FL_KEEP_SIZE, 0, size);
+#else
+  FILE_ALLOCATION_INFO info    = {};
+  info.AllocationSize.QuadPart = size;
+
+  ::SetFileInformationByHandle(
+      reinterpret_cast<HANDLE>(_get_osfhandle(m_File.handle())), FileAllocationInfo,
+      &info, sizeof(info));
+#endif
+}
@@ -0,0 +1,148 @@
+#ifndef MODORGANIZER_DOWNLOADSINK_INCLUDED
+#define MODORGANIZER_DOWNLOADSINK_INCLUDED
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QIODevice;
+
+// file a download is written to
+//
+// data is read from the network reply into fixed-size chunks on the ui
+// thread and written by a thread owned by the sink, which also computes the
+// md5 of the file as it goes; the ui thread only blocks when the sink is
+// closed, chunks are queued for as long as the disk can't keep up
+//
+// when a download is resumed, the md5 has to start with the data that's
+// already in the file; a second thread hashes the file from the start while
+// the new data is being written, reading back what was written once it gets
+// there, so writes never wait for the existing data to be hashed
+//
+// apart from write() and reserve(), this works like a QFile: it must be
+// closed before being renamed or removed, and all functions must be called
+// from the same thread
+//
+class DownloadSink
+{
+public:
+  // size of a write
+  static constexpr qint64 ChunkSize = 1024 * 1024;
+
+  DownloadSink() = default;
+  ~DownloadSink();
+
+  // noncopyable
+  DownloadSink(const DownloadSink&)            = delete;
+  DownloadSink& operator=(const DownloadSink&) = delete;
+
+  QString fileName() const;
+
+  // does nothing if the sink is open
+  //
+  void setFileName(const QString& name);
+
+  bool isOpen() const;
+
+  // opens the file and starts the thread, the file is truncated unless
+  // `append` is set, in which case the existing data is hashed by a second
+  // thread
+  //
+  bool open(bool append);
+
+  // reserves space on disk for the given number of bytes past the size the
+  // file had when it was opened, without changing the size of the file; only
+  // the first call after open() does anything
+  //
+  void reserve(qint64 bytes);
+
+  // reads everything available from the device; returns false if a previous
+  // write failed, see errorString()
+  //
+  bool write(QIODevice& device);
+
+  // writes everything that's left, stops the thread and closes the file;
+  // returns false if any write failed
+  //
+  bool close();
+
+  // size of the file, including data that hasn't been written yet
+  //
+  qint64 size() const;
+
+  // closes the file if it's open
+  //
+  bool rename(const QString& newName);
+  bool remove();
+
+  QString errorString() const;
+
+  // md5 of the whole file, only available after close() if every write
+  // succeeded
+  //
+  QByteArray hash() const { return m_Result; }
+
+private:
+  struct Job
+  {
+    QByteArray data;
+
+    // size to reserve, the data is empty when this is set
+    qint64 reserve = 0;
+  };
+
+  // used by the thread while the sink is open
+  QFile m_File;
+
+  // used by the writing thread, or by the hashing thread when the download is
+  // resumed
+  QCryptographicHash m_Hash{QCryptographicHash::Md5};
+  bool m_HashFromFile = false;
+  bool m_HashValid    = false;
+
+  std::thread m_Thread;
+  std::thread m_HashThread;
+  bool m_Open     = false;
+  bool m_Reserved = false;
+
+  // size when opened and number of bytes accepted since
+  qint64 m_OpenSize = 0;
+  qint64 m_Accepted = 0;
+
+  // chunk being filled
+  QByteArray m_Current;
+  qint64 m_CurrentSize = 0;
+
+  std::deque<Job> m_Queue;
+  std::vector<QByteArray> m_Free;
+  bool m_Closing = false;
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+
+  // bytes written by the thread since the file was opened and whether it has
+  // stopped, for the hashing thread
+  qint64 m_Written     = 0;
+  bool m_WriterStopped = false;
+  std::condition_variable m_WrittenChanged;
+
+  std::atomic<bool> m_Failed = false;
+  QString m_Error;
+
+  QByteArray m_Result;
+
+  void push(Job job);
+  void flushCurrent();
+
+  void threadFun();
+  void hashFile();
+  void preallocate(qint64 size);
+};
+
+#endif  // MODORGANIZER_DOWNLOADSINK_INCLUDED
@@ -29,34 +29,16 @@ void forEachEntryImpl(void* cx, const QString& path, std::size_t depth,
   }
 }
 
-QString makeNtPath(const QString& path)
+DirectoryWalker& DirectoryWalker::forThisThread()
 {
-  static const QString nt_prefix     = QStringLiteral("\\??\\");
-  static const QString nt_unc_prefix = QStringLiteral("\\??\\UNC\\");
-  static const QString share_prefix  = QStringLiteral("\\\\");
-
-  if (path.startsWith(nt_prefix)) {
-    // already an nt path
-    return path;
-  } else if (path.startsWith(share_prefix)) {
-    // network shared need \??\UNC\ as a prefix
-    return nt_unc_prefix + path.sliced(2);
-  } else {
-    // prepend the \??\ prefix
-    return nt_prefix + path;
-  }
+  thread_local DirectoryWalker walker;
+  return walker;
 }
 
-void DirectoryWalker::forEachEntry(const QString& path, void* cx, DirStartF* dirStartF,
-                                   DirEndF* dirEndF, FileF* fileF)
+void forEachEntryGeneric(const QString& path, void* cx, DirStartF* dirStartF,
+                         DirEndF* dirEndF, FileF* fileF)
 {
-#ifdef _WIN32
-  const QString ntpath = makeNtPath(path);
-#else
-  const QString& ntpath = path;
-#endif
-
-  forEachEntryImpl(cx, ntpath, 0, dirStartF, dirEndF, fileF);
+  forEachEntryImpl(cx, path, 0, dirStartF, dirEndF, fileF);
 }
 
 void forEachEntry(const QString& path, void* cx, DirStartF* dirStartF, DirEndF* dirEndF,
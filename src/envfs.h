@@ -5,6 +5,8 @@
 #include <QDateTime>
 #include <QString>
 #include <condition_variable>
+#include <memory>
+#include <optional>
 #include <thread>
 
 namespace env
@@ -32,162 +34,82 @@ struct Directory
   Directory(QStringView name);
 };
 
-template <class T>
-class ThreadPool
-{
-public:
-  ThreadPool(std::size_t max = 1) { setMax(max); }
-
-  ~ThreadPool() { stopAndJoin(); }
-
-  void setMax(std::size_t n) { m_threads.resize(n); }
-
-  void stopAndJoin()
-  {
-    for (auto& ti : m_threads) {
-      ti.stop = true;
-      ti.wakeup();
-    }
-
-    for (auto& ti : m_threads) {
-      if (ti.thread.joinable()) {
-        ti.thread.join();
-      }
-    }
-  }
-
-  void waitForAll()
-  {
-    for (;;) {
-      bool done = true;
-
-      for (auto& ti : m_threads) {
-        if (ti.busy) {
-          done = false;
-          break;
-        }
-      }
-
-      if (done) {
-        break;
-      }
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-  }
-
-  T& request()
-  {
-    if (m_threads.empty()) {
-      std::terminate();
-    }
-
-    for (;;) {
-      for (auto& ti : m_threads) {
-        bool expected = false;
-
-        if (ti.busy.compare_exchange_strong(expected, true)) {
-          ti.wakeup();
-          return ti.o;
-        }
-      }
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-  }
-
-  template <class F>
-  void forEach(F&& f)
-  {
-    for (auto& ti : m_threads) {
-      f(ti.o);
-    }
-  }
-
-private:
-  struct ThreadInfo
-  {
-    std::thread thread;
-    std::atomic<bool> busy;
-    T o;
-
-    std::condition_variable cv;
-    std::mutex mutex;
-    bool ready;
-
-    std::atomic<bool> stop;
-
-    ThreadInfo() : busy(true), ready(false), stop(false)
-    {
-      thread = MOShared::startSafeThread([&] {
-        run();
-      });
-    }
-
-    ~ThreadInfo()
-    {
-      if (thread.joinable()) {
-        stop = true;
-        wakeup();
-        thread.join();
-      }
-    }
-
-    void wakeup()
-    {
-      {
-        std::scoped_lock lock(mutex);
-        ready = true;
-      }
-
-      cv.notify_one();
-    }
-
-    void run()
-    {
-      busy = false;
-
-      while (!stop) {
-        std::unique_lock lock(mutex);
-        cv.wait(lock, [&] {
-          return ready;
-        });
-
-        if (stop) {
-          break;
-        }
-
-        o.run();
-
-        ready = false;
-        busy  = false;
-      }
-    }
-  };
-
-  std::list<ThreadInfo> m_threads;
-};
-
 using DirStartF = void(void*, QStringView);
 using DirEndF   = void(void*, QStringView);
 using FileF     = void(void*, QStringView, QDateTime, uint64_t);
 
+// walks a directory recursively with the native api of the os; on Linux, this
+// reads entries with getdents64() and only calls statx() on the entries that
+// need it, optionally batching those through io_uring
+//
+// a walker reuses its buffers between calls, so it's best kept around when
+// walking many directories on the same thread
+//
 class DirectoryWalker
 {
 public:
+  DirectoryWalker();
+  ~DirectoryWalker();
+
+  // noncopyable
+  DirectoryWalker(const DirectoryWalker&)            = delete;
+  DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+
+  // walker of the calling thread, created on first use and destroyed when the
+  // thread exits; walks that run on pool threads use this instead of setting up
+  // new buffers every time
+  //
+  // this must not be used from the callbacks of a walk made with it
+  //
+  static DirectoryWalker& forThisThread();
+
   void forEachEntry(const QString& path, void* cx, DirStartF* dirStartF,
                     DirEndF* dirEndF, FileF* fileF);
 
 private:
-  std::vector<std::unique_ptr<unsigned char[]>> m_buffers;
+  // buffers and other state of the native walker, defined in the os-specific
+  // file
+  struct Native;
+  std::unique_ptr<Native> m_native;
 };
 
+// walks a directory recursively with QDirIterator, used by the walker on
+// systems without a native implementation
+//
+void forEachEntryGeneric(const QString& path, void* cx, DirStartF* dirStartF,
+                         DirEndF* dirEndF, FileF* fileF);
+
 void forEachEntry(const QString& path, void* cx, DirStartF* dirStartF, DirEndF* dirEndF,
                   FileF* fileF);
 
 Directory getFilesAndDirs(const QString& path);
 Directory getFilesAndDirsWithFind(const QString& path);
 
+// how cloneFile() copied a file
+//
+enum class CloneMethod
+{
+  // the copy shares the data of the original until either of them is modified
+  Reflink,
+
+  // the data was copied by the os without going through this process, some
+  // filesystems also share the data in this case
+  SystemCopy,
+
+  // the data was read and written by this process
+  Copy
+};
+
+// copies a file, sharing its data with the copy if the filesystem supports it;
+// the destination must not exist, it gets the permissions and modification
+// time of the source
+//
+// returns nothing on failure, in which case `error` is set and the destination
+// is removed
+//
+std::optional<CloneMethod> cloneFile(const QString& from, const QString& to,
+                                     QString& error);
+
 }  // namespace env
 
 #endif  // ENV_ENVFS_H
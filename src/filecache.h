@@ -0,0 +1,265 @@
+#ifndef MODORGANIZER_FILECACHE_INCLUDED
+#define MODORGANIZER_FILECACHE_INCLUDED
+
+#include "taskscheduler.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QString>
+#include <log.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief on-disk cache of values read from files, so the files that haven't
+ * changed don't have to be read again
+ *
+ * values are keyed by the full path of the file along with its size and
+ * modification time; files that are not in the cache are read in parallel.
+ * values are saved with QDataStream, so T must have the stream operators
+ *
+ * this must only be used from one thread at a time
+ **/
+template <class T>
+class FileCache
+{
+public:
+  // a file along with its size and modification time in milliseconds since
+  // epoch, both -1 if the file doesn't exist
+  //
+  struct Stamp
+  {
+    QString path;
+    qint64 size         = -1;
+    qint64 lastModified = -1;
+  };
+
+  // the magic and version are written at the start of the file, files with
+  // different ones are ignored; the name is only used in the log
+  //
+  FileCache(quint32 magic, quint32 version, QString name)
+      : m_Magic(magic), m_Version(version), m_Name(std::move(name))
+  {}
+
+  /**
+   * @brief reads the given file, replacing anything that was loaded before
+   *
+   * @return false if the file does not exist or is invalid, in which case the
+   * cache is empty
+   **/
+  bool load(const QString& file)
+  {
+    m_Entries.clear();
+    m_Dirty = false;
+
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+      return false;
+    }
+
+    QDataStream s(&f);
+
+    quint32 magic = 0, version = 0, count = 0;
+    s >> magic >> version >> count;
+
+    if (magic != m_Magic || version != m_Version) {
+      MOBase::log::debug("ignoring {} '{}', unknown format", m_Name, file);
+      return false;
+    }
+
+    for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+      QString path;
+      Entry e;
+      auto v = std::make_shared<T>();
+
+      s >> path >> e.size >> e.lastModified >> *v;
+
+      e.value = std::move(v);
+      m_Entries.emplace(std::move(path), std::move(e));
+    }
+
+    if (s.status() != QDataStream::Ok) {
+      MOBase::log::error("{} '{}' is corrupted, ignoring", m_Name, file);
+      m_Entries.clear();
+      return false;
+    }
+
+    MOBase::log::debug("loaded {} with {} entries", m_Name, m_Entries.size());
+    return true;
+  }
+
+  /**
+   * @brief saves the values to the given file, does nothing if they haven't
+   * changed since the last load() or save()
+   **/
+  bool save(const QString& file)
+  {
+    if (!m_Dirty) {
+      return true;
+    }
+
+    QSaveFile f(file);
+    if (!f.open(QIODevice::WriteOnly)) {
+      MOBase::log::error("failed to save {} to '{}': {}", m_Name, file,
+                         f.errorString());
+      return false;
+    }
+
+    QDataStream s(&f);
+    s << m_Magic << m_Version << static_cast<quint32>(m_Entries.size());
+
+    for (const auto& [path, e] : m_Entries) {
+      s << path << e.size << e.lastModified << *e.value;
+    }
+
+    if (s.status() != QDataStream::Ok || !f.commit()) {
+      MOBase::log::error("failed to save {} to '{}': {}", m_Name, file,
+                         f.errorString());
+      return false;
+    }
+
+    m_Dirty = false;
+    return true;
+  }
+
+  /**
+   * @brief returns the value of each of the given files, in the same order
+   *
+   * read() is called with the index of every file that is not in the cache,
+   * from at most the given number of threads at once; it returns null if the
+   * file couldn't be read, in which case nothing is cached for it
+   **/
+  template <class Read>
+  std::vector<std::shared_ptr<const T>> get(const std::vector<Stamp>& files,
+                                            std::size_t threadCount, Read&& read)
+  {
+    std::vector<std::shared_ptr<const T>> results(files.size());
+    std::vector<std::size_t> misses;
+
+    m_Hits   = 0;
+    m_Misses = 0;
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      const auto& f = files[i];
+
+      auto itor = m_Entries.find(f.path);
+      if (itor != m_Entries.end() && itor->second.size == f.size &&
+          itor->second.lastModified == f.lastModified) {
+        ++m_Hits;
+        itor->second.seen = true;
+        results[i]        = itor->second.value;
+      } else {
+        misses.push_back(i);
+      }
+    }
+
+    // the map is left alone while reading, misses are added below
+    MOShared::parallelMap(
+        misses.begin(), misses.end(),
+        [&](std::size_t i) {
+          results[i] = read(i);
+        },
+        threadCount);
+
+    for (const auto i : misses) {
+      const auto& f = files[i];
+
+      ++m_Misses;
+
+      if (results[i]) {
+        m_Entries[f.path] = {f.size, f.lastModified, results[i], true};
+        m_Dirty           = true;
+      } else if (m_Entries.erase(f.path) > 0) {
+        m_Dirty = true;
+      }
+    }
+
+    return results;
+  }
+
+  /**
+   * @brief same as above for files whose size and modification time are not
+   * known yet, they're stat'ed in parallel first
+   **/
+  template <class Read>
+  std::vector<std::shared_ptr<const T>> get(const std::vector<QString>& paths,
+                                            std::size_t threadCount, Read&& read)
+  {
+    return get(stat(paths, threadCount), threadCount, std::forward<Read>(read));
+  }
+
+  /**
+   * @brief forgets the files that were not given to get() since the last call,
+   * used after a get() that was given every file
+   **/
+  void removeUnseen()
+  {
+    const auto removed = std::erase_if(m_Entries, [](auto&& p) {
+      return !p.second.seen;
+    });
+
+    if (removed > 0) {
+      m_Dirty = true;
+    }
+
+    for (auto& [path, e] : m_Entries) {
+      e.seen = false;
+    }
+  }
+
+  // number of files that were found in the cache and that had to be read by
+  // the last get()
+  //
+  std::size_t hits() const { return m_Hits; }
+  std::size_t misses() const { return m_Misses; }
+
+  // stamps of the given files, using at most the given number of threads
+  //
+  static std::vector<Stamp> stat(const std::vector<QString>& paths,
+                                 std::size_t threadCount)
+  {
+    std::vector<Stamp> files(paths.size());
+
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+      files[i].path = paths[i];
+    }
+
+    MOShared::parallelMap(
+        files.begin(), files.end(),
+        [&](Stamp& f) {
+          const QFileInfo fi(f.path);
+
+          if (fi.exists()) {
+            f.size         = fi.size();
+            f.lastModified = fi.lastModified().toMSecsSinceEpoch();
+          }
+        },
+        threadCount);
+
+    return files;
+  }
+
+private:
+  struct Entry
+  {
+    qint64 size         = 0;
+    qint64 lastModified = 0;
+    std::shared_ptr<const T> value;
+    bool seen = false;
+  };
+
+  quint32 m_Magic;
+  quint32 m_Version;
+  QString m_Name;
+
+  std::map<QString, Entry> m_Entries;
+  bool m_Dirty = false;
+
+  std::size_t m_Hits   = 0;
+  std::size_t m_Misses = 0;
+};
+
+#endif  // MODORGANIZER_FILECACHE_INCLUDED
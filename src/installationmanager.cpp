@@ -22,6 +22,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "installationmanager.h"
 
 #include "categories.h"
+#include "directorycloner.h"
 #include "filesystemutilities.h"
 #include "iplugininstallercustom.h"
 #include "iplugininstallersimple.h"
@@ -395,8 +396,15 @@ InstallationResult InstallationManager::testOverwrite(GuessedValue<QString>& mod
 
       if (overwriteDialog.backup()) {
         QString backupDirectory = generateBackupName(targetDirectory);
-        if (!copyDir(targetDirectory, backupDirectory, false)) {
-          reportError(tr("Failed to create backup"));
+        QString error;
+
+        if (!cloneDirectory(m_ParentWidget, targetDirectory, backupDirectory, false,
+                            error)) {
+          if (error.isEmpty()) {
+            return {IPluginInstaller::RESULT_CANCELED};
+          }
+
+          reportError(tr("Failed to create backup: %1").arg(error));
           return {IPluginInstaller::RESULT_FAILED};
         }
       }
@@ -0,0 +1,569 @@
+#include "envfs.h"
+#include <QFile>
+#include <QTimeZone>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <log.h>
+#include <memory>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifdef MO2_HAS_LIBURING
+#include <liburing.h>
+#endif
+
+namespace env
+{
+
+using namespace MOBase;
+
+namespace
+{
+
+// record returned by getdents64(), glibc only declares it in recent versions
+struct LinuxDirent64
+{
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// initial size of the buffer for a directory level, grown as needed for large
+// directories
+constexpr std::size_t BufferSize = 32 * 1024;
+
+// getdents64() fails with EINVAL if a single record doesn't fit, names are at
+// most 255 bytes
+constexpr std::size_t MinRead = 512;
+
+constexpr unsigned int StatxMask = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+
+enum class EntryType
+{
+  // needs statx() to find out
+  Unknown,
+
+  File,
+  Directory,
+
+  // anything else, or a broken symlink; QDirIterator skips those without
+  // QDir::System
+  Skip
+};
+
+struct Entry
+{
+  // offset of the name in the level's buffer, nul-terminated
+  std::size_t name;
+  std::size_t length;
+
+  EntryType type;
+
+  // only for files, set by statx()
+  QDateTime lastModified;
+  uint64_t size;
+};
+
+EntryType typeFromDirent(unsigned char t)
+{
+  switch (t) {
+  case DT_REG:
+    // size and time are still needed
+    return EntryType::Unknown;
+
+  case DT_DIR:
+    return EntryType::Directory;
+
+  case DT_LNK:
+  case DT_UNKNOWN:
+    // symlinks are followed, like QDirIterator does
+    return EntryType::Unknown;
+
+  default:
+    return EntryType::Skip;
+  }
+}
+
+void setFromStatx(Entry& e, const struct statx& stx)
+{
+  if (S_ISDIR(stx.stx_mode)) {
+    e.type = EntryType::Directory;
+  } else if (S_ISREG(stx.stx_mode)) {
+    e.type = EntryType::File;
+    e.size = stx.stx_size;
+
+    const qint64 ms = static_cast<qint64>(stx.stx_mtime.tv_sec) * 1000 +
+                      stx.stx_mtime.tv_nsec / 1000000;
+
+    e.lastModified = QDateTime::fromMSecsSinceEpoch(ms, QTimeZone::LocalTime);
+  } else {
+    e.type = EntryType::Skip;
+  }
+}
+
+#ifdef MO2_HAS_LIBURING
+
+// submits the statx() calls of a directory in batches, which saves a syscall
+// per file on large directories
+//
+class StatxRing
+{
+public:
+  // directories with fewer entries than this are stat'ed directly
+  static constexpr std::size_t MinBatch = 16;
+
+  StatxRing() : m_ok(io_uring_queue_init(QueueDepth, &m_ring, 0) == 0)
+  {
+    if (!m_ok) {
+      // io_uring is commonly disabled in containers and sandboxes
+      log::debug("io_uring is not available, statx() calls won't be batched");
+    }
+  }
+
+  ~StatxRing()
+  {
+    if (m_ok) {
+      io_uring_queue_exit(&m_ring);
+    }
+  }
+
+  // noncopyable
+  StatxRing(const StatxRing&)            = delete;
+  StatxRing& operator=(const StatxRing&) = delete;
+
+  bool ok() const { return m_ok; }
+
+  // stats all the entries with an unknown type, returns false if the ring
+  // failed, in which case the remaining entries still have an unknown type
+  //
+  bool stat(int dirfd, const char* names, std::vector<Entry>& entries)
+  {
+    std::size_t next = 0;
+
+    while (next < entries.size()) {
+      std::size_t submitted = 0;
+      std::size_t i         = next;
+
+      for (; i < entries.size() && submitted < QueueDepth; ++i) {
+        if (entries[i].type != EntryType::Unknown) {
+          continue;
+        }
+
+        io_uring_sqe* sqe = io_uring_get_sqe(&m_ring);
+        if (!sqe) {
+          break;
+        }
+
+        io_uring_prep_statx(sqe, dirfd, names + entries[i].name, 0, StatxMask,
+                            &m_results[submitted]);
+
+        m_indices[submitted] = i;
+        io_uring_sqe_set_data64(sqe, submitted);
+        ++submitted;
+      }
+
+      if (submitted == 0) {
+        break;
+      }
+
+      if (io_uring_submit_and_wait(&m_ring, static_cast<unsigned>(submitted)) < 0) {
+        return false;
+      }
+
+      for (std::size_t done = 0; done < submitted; ++done) {
+        io_uring_cqe* cqe = nullptr;
+        if (io_uring_wait_cqe(&m_ring, &cqe) < 0) {
+          return false;
+        }
+
+        const auto slot = io_uring_cqe_get_data64(cqe);
+        Entry& e        = entries[m_indices[slot]];
+
+        if (cqe->res < 0) {
+          e.type = EntryType::Skip;
+        } else {
+          setFromStatx(e, m_results[slot]);
+        }
+
+        io_uring_cqe_seen(&m_ring, cqe);
+      }
+
+      next = i;
+    }
+
+    return true;
+  }
+
+private:
+  static constexpr unsigned QueueDepth = 128;
+
+  io_uring m_ring;
+  bool m_ok;
+  std::array<struct statx, QueueDepth> m_results;
+  std::array<std::size_t, QueueDepth> m_indices;
+};
+
+#endif  // MO2_HAS_LIBURING
+
+}  // namespace
+
+struct DirectoryWalker::Native
+{
+  // names and entries of the directory being listed at each depth, reused
+  // between directories; levels never move once added
+  struct Level
+  {
+    std::vector<char> buffer;
+    std::vector<Entry> entries;
+  };
+
+  std::deque<Level> levels;
+
+  // names are almost always ascii and are widened here instead of allocating
+  // a QString for each of them
+  std::u16string ascii;
+  QString other;
+
+#ifdef MO2_HAS_LIBURING
+  // created on first use, reset if it fails
+  std::unique_ptr<StatxRing> ring;
+  bool ringFailed = false;
+#endif
+
+  Level& level(std::size_t depth)
+  {
+    while (levels.size() <= depth) {
+      levels.emplace_back().buffer.resize(BufferSize);
+    }
+
+    return levels[depth];
+  }
+
+  // the returned view is valid until the next call
+  //
+  QStringView decode(const char* name, std::size_t length)
+  {
+    ascii.resize(length);
+
+    for (std::size_t i = 0; i < length; ++i) {
+      const auto c = static_cast<unsigned char>(name[i]);
+
+      if (c >= 0x80) {
+        other = QString::fromUtf8(name, static_cast<qsizetype>(length));
+        return other;
+      }
+
+      ascii[i] = c;
+    }
+
+    return ascii;
+  }
+
+  bool read(int fd, Level& level)
+  {
+    level.entries.clear();
+
+    std::size_t used = 0;
+
+    for (;;) {
+      if (level.buffer.size() - used < MinRead) {
+        level.buffer.resize(level.buffer.size() * 2);
+      }
+
+      const long n = syscall(SYS_getdents64, fd, level.buffer.data() + used,
+                             level.buffer.size() - used);
+
+      if (n < 0) {
+        return false;
+      } else if (n == 0) {
+        break;
+      }
+
+      for (std::size_t offset = used; offset < used + n;) {
+        const auto* d =
+            reinterpret_cast<const LinuxDirent64*>(level.buffer.data() + offset);
+
+        const std::size_t nameOffset = offset + offsetof(LinuxDirent64, d_name);
+        offset += d->d_reclen;
+
+        // hidden files are skipped, like QDirIterator does without
+        // QDir::Hidden; this also skips . and ..
+        if (d->d_name[0] == '.') {
+          continue;
+        }
+
+        level.entries.push_back(
+            {nameOffset, std::strlen(d->d_name), typeFromDirent(d->d_type), {}, 0});
+      }
+
+      used += n;
+    }
+
+    return true;
+  }
+
+  void stat(int fd, Level& level)
+  {
+#ifdef MO2_HAS_LIBURING
+    if (!ringFailed && level.entries.size() >= StatxRing::MinBatch) {
+      if (!ring) {
+        ring = std::make_unique<StatxRing>();
+      }
+
+      if (ring->ok() && ring->stat(fd, level.buffer.data(), level.entries)) {
+        return;
+      }
+
+      // the remaining entries are stat'ed below
+      ringFailed = true;
+      ring.reset();
+    }
+#endif
+
+    struct statx stx;
+
+    for (auto& e : level.entries) {
+      if (e.type != EntryType::Unknown) {
+        continue;
+      }
+
+      if (statx(fd, level.buffer.data() + e.name, 0, StatxMask, &stx) == 0) {
+        setFromStatx(e, stx);
+      } else {
+        e.type = EntryType::Skip;
+      }
+    }
+  }
+
+  void walk(int fd, std::size_t depth, void* cx, DirStartF* dirStartF,
+            DirEndF* dirEndF, FileF* fileF)
+  {
+    Level& lv = level(depth);
+
+    if (!read(fd, lv)) {
+      log::error("failed to list directory at depth {}, {}", depth,
+                 std::strerror(errno));
+      return;
+    }
+
+    stat(fd, lv);
+
+    for (const auto& e : lv.entries) {
+      const char* name = lv.buffer.data() + e.name;
+
+      if (e.type == EntryType::File) {
+        fileF(cx, decode(name, e.length), e.lastModified, e.size);
+      } else if (e.type == EntryType::Directory && dirStartF && dirEndF) {
+        const int child = openat(fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (child < 0) {
+          log::error("failed to open directory '{}', {}", QString::fromUtf8(name),
+                     std::strerror(errno));
+          continue;
+        }
+
+        dirStartF(cx, decode(name, e.length));
+        walk(child, depth + 1, cx, dirStartF, dirEndF, fileF);
+        close(child);
+
+        // the name was overwritten while walking the directory
+        dirEndF(cx, decode(name, e.length));
+      }
+    }
+  }
+};
+
+DirectoryWalker::DirectoryWalker() : m_native(std::make_unique<Native>()) {}
+
+DirectoryWalker::~DirectoryWalker() = default;
+
+void DirectoryWalker::forEachEntry(const QString& path, void* cx, DirStartF* dirStartF,
+                                   DirEndF* dirEndF, FileF* fileF)
+{
+  const int fd =
+      open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (fd < 0) {
+    // QDirIterator doesn't report anything for a missing directory either
+    if (errno != ENOENT) {
+      log::error("failed to open directory '{}', {}", path, std::strerror(errno));
+    }
+
+    return;
+  }
+
+  m_native->walk(fd, 0, cx, dirStartF, dirEndF, fileF);
+  close(fd);
+}
+
+namespace
+{
+
+// buffer used when the data has to go through this process
+constexpr std::size_t CopyBufferSize = 256 * 1024;
+
+enum class RangeResult
+{
+  Done,
+
+  // copy_file_range() can't be used for these files, nothing was copied
+  Unsupported,
+
+  Failed
+};
+
+// copies the data in the kernel; this also shares the data on filesystems
+// where FICLONE isn't available but copy_file_range() can clone, such as nfs
+//
+RangeResult copyRange(int in, int out, off_t size)
+{
+  off_t done = 0;
+
+  while (done < size) {
+    const ssize_t n = copy_file_range(in, nullptr, out, nullptr, size - done, 0);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      // across filesystems on older kernels, or not supported by either of
+      // them
+      if (done == 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP ||
+                        errno == EINVAL)) {
+        return RangeResult::Unsupported;
+      }
+
+      return RangeResult::Failed;
+    }
+
+    if (n == 0) {
+      // the file got smaller
+      break;
+    }
+
+    done += n;
+  }
+
+  return RangeResult::Done;
+}
+
+bool copyData(int in, int out)
+{
+  auto buffer = std::make_unique<char[]>(CopyBufferSize);
+
+  for (;;) {
+    const ssize_t n = read(in, buffer.get(), CopyBufferSize);
+
+    if (n == 0) {
+      return true;
+    } else if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    for (ssize_t written = 0; written < n;) {
+      const ssize_t w = write(out, buffer.get() + written, n - written);
+
+      if (w < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return false;
+      }
+
+      written += w;
+    }
+  }
+}
+
+}  // namespace
+
+std::optional<CloneMethod> cloneFile(const QString& from, const QString& to,
+                                     QString& error)
+{
+  const QByteArray toPath = QFile::encodeName(to);
+
+  const int in = open(QFile::encodeName(from).constData(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) {
+    error = QString::fromLocal8Bit(std::strerror(errno));
+    return {};
+  }
+
+  struct stat st;
+  if (fstat(in, &st) != 0) {
+    error = QString::fromLocal8Bit(std::strerror(errno));
+    close(in);
+    return {};
+  }
+
+  const int out = open(toPath.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                       st.st_mode & 07777);
+
+  if (out < 0) {
+    error = QString::fromLocal8Bit(std::strerror(errno));
+    close(in);
+    return {};
+  }
+
+  std::optional<CloneMethod> method;
+
+  // reflinks on btrfs, xfs and others, fails with EOPNOTSUPP or EXDEV when
+  // they're not available
+  if (ioctl(out, FICLONE, in) == 0) {
+    method = CloneMethod::Reflink;
+  } else {
+    switch (copyRange(in, out, st.st_size)) {
+    case RangeResult::Done:
+      method = CloneMethod::SystemCopy;
+      break;
+
+    case RangeResult::Unsupported:
+      if (copyData(in, out)) {
+        method = CloneMethod::Copy;
+      }
+      break;
+
+    case RangeResult::Failed:
+      break;
+    }
+  }
+
+  if (method) {
+    // the modification time is used for the load order of some games
+    const timespec times[2] = {st.st_atim, st.st_mtim};
+    if (futimens(out, times) != 0) {
+      method.reset();
+    }
+  }
+
+  const int e = errno;
+  close(in);
+
+  if (close(out) != 0 && method) {
+    error = QString::fromLocal8Bit(std::strerror(errno));
+    method.reset();
+  } else if (!method) {
+    error = QString::fromLocal8Bit(std::strerror(e));
+  }
+
+  if (!method) {
+    unlink(toPath.constData());
+  }
+
+  return method;
+}
+
+}  // namespace env
@@ -0,0 +1,285 @@
+#include "processmonitor.h"
+#include "thread_utils.h"
+#include <array>
+#include <fcntl.h>
+#include <log.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace MOBase;
+using namespace std::chrono;
+
+namespace
+{
+
+// key of the eventfd used to wake up the thread, no process has this pid
+constexpr uint64_t WakeUpKey = 0;
+
+// whether the process of the given pidfd has exited, doesn't block
+//
+bool hasExited(int pidFd)
+{
+  pollfd p{pidFd, POLLIN, 0};
+  return (poll(&p, 1, 0) > 0);
+}
+
+// exit status of the process if it's a child of this process; the process is
+// left waitable so whoever started it can still reap it
+//
+std::optional<int> exitCode(int pidFd)
+{
+  siginfo_t info{};
+
+  if (waitid(P_PIDFD, pidFd, &info, WEXITED | WNOHANG | WNOWAIT) != 0) {
+    // not a child
+    return {};
+  }
+
+  if (info.si_pid == 0) {
+    return {};
+  }
+
+  if (info.si_code == CLD_EXITED) {
+    return info.si_status;
+  }
+
+  // killed by a signal, same as the shell
+  return 128 + info.si_status;
+}
+
+}  // namespace
+
+ProcessMonitor::ProcessMonitor()
+    : m_epoll(epoll_create1(EPOLL_CLOEXEC)),
+      m_wakeUp(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), m_stop(false)
+{
+  if (m_epoll == -1 || m_wakeUp == -1) {
+    const int e = errno;
+    log::error("process monitor: failed to create epoll instance, {}", strerror(e));
+    m_stop = true;
+    return;
+  }
+
+  epoll_event ev{};
+  ev.events   = EPOLLIN;
+  ev.data.u64 = WakeUpKey;
+
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeUp, &ev) == -1) {
+    const int e = errno;
+    log::error("process monitor: failed to watch eventfd, {}", strerror(e));
+    m_stop = true;
+    return;
+  }
+
+  m_thread = MOShared::startSafeThread([&] {
+    threadFun();
+  });
+}
+
+ProcessMonitor::~ProcessMonitor()
+{
+  m_stop = true;
+
+  if (m_thread.joinable()) {
+    const uint64_t one = 1;
+    if (write(m_wakeUp, &one, sizeof(one)) == -1) {
+      const int e = errno;
+      log::error("process monitor: failed to wake up thread, {}", strerror(e));
+    }
+
+    m_thread.join();
+  }
+
+  for (auto& [pid, e] : m_entries) {
+    if (e.pidFd != -1) {
+      close(e.pidFd);
+    }
+  }
+
+  if (m_wakeUp != -1) {
+    close(m_wakeUp);
+  }
+
+  if (m_epoll != -1) {
+    close(m_epoll);
+  }
+}
+
+ProcessMonitor& ProcessMonitor::instance()
+{
+  static ProcessMonitor m;
+  return m;
+}
+
+std::optional<ProcessMonitor::Exit>
+ProcessMonitor::waitForExit(pid_t pid, milliseconds timeout, int pidFd)
+{
+  std::unique_lock lock(m_mutex);
+
+  watch(pid, pidFd);
+
+  // the entry can be removed by isRunning() while waiting, in which case the
+  // process has exited
+  auto exited = [&] {
+    auto itor = m_entries.find(pid);
+    return (itor == m_entries.end() || itor->second.exit.has_value());
+  };
+
+  m_exited.wait_for(lock, timeout, exited);
+
+  auto itor = m_entries.find(pid);
+  if (itor == m_entries.end()) {
+    return Exit{};
+  }
+
+  if (!itor->second.exit) {
+    // still running
+    return {};
+  }
+
+  auto exit = *itor->second.exit;
+  m_entries.erase(itor);
+
+  return exit;
+}
+
+bool ProcessMonitor::isRunning(pid_t pid)
+{
+  std::scoped_lock lock(m_mutex);
+
+  if (!watch(pid, -1).exit) {
+    return true;
+  }
+
+  m_entries.erase(pid);
+  return false;
+}
+
+ProcessMonitor::Entry& ProcessMonitor::watch(pid_t pid, int pidFd)
+{
+  auto itor = m_entries.find(pid);
+  if (itor != m_entries.end()) {
+    return itor->second;
+  }
+
+  Entry& e = m_entries[pid];
+  e.start  = steady_clock::now();
+
+  if (m_stop) {
+    // the thread is not running, processes can't be waited on
+    setExited(pid, e, ECANCELED);
+    return e;
+  }
+
+  // the given pidfd belongs to the caller, a duplicate is watched instead
+  if (pidFd == -1) {
+    e.pidFd = pidfd_open(pid, 0);
+  } else {
+    e.pidFd = fcntl(pidFd, F_DUPFD_CLOEXEC, 0);
+  }
+
+  if (e.pidFd == -1) {
+    const int err = errno;
+
+    // ESRCH means the process doesn't exist anymore
+    setExited(pid, e, (err == ESRCH ? 0 : err));
+    return e;
+  }
+
+  epoll_event ev{};
+  ev.events   = EPOLLIN;
+  ev.data.u64 = static_cast<uint64_t>(pid);
+
+  if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, e.pidFd, &ev) == -1) {
+    const int err = errno;
+    setExited(pid, e, err);
+    return e;
+  }
+
+  // the thread would also be notified, but callers checking right after
+  // watching should see it
+  if (hasExited(e.pidFd)) {
+    setExited(pid, e);
+  }
+
+  return e;
+}
+
+void ProcessMonitor::setExited(pid_t pid, Entry& e, int error)
+{
+  Exit exit;
+  exit.runTime = steady_clock::now() - e.start;
+  exit.error   = error;
+
+  if (e.pidFd != -1) {
+    exit.exitCode = exitCode(e.pidFd);
+
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, e.pidFd, nullptr);
+    close(e.pidFd);
+    e.pidFd = -1;
+  }
+
+  if (error != 0) {
+    log::error("process monitor: failed to watch process {}, {}", pid,
+               strerror(error));
+  } else {
+    log::debug("process monitor: process {} exited after {}ms, exit code {}", pid,
+               duration_cast<milliseconds>(exit.runTime).count(),
+               exit.exitCode ? std::to_string(*exit.exitCode) : "unknown");
+  }
+
+  e.exit = exit;
+  m_exited.notify_all();
+}
+
+void ProcessMonitor::threadFun()
+{
+  std::array<epoll_event, 16> events;
+
+  while (!m_stop) {
+    const int n = epoll_wait(m_epoll, events.data(), events.size(), -1);
+
+    if (n == -1) {
+      const int e = errno;
+      if (e == EINTR) {
+        continue;
+      }
+
+      log::error("process monitor: epoll_wait() failed, {}", strerror(e));
+
+      // nothing can be waited on anymore, wake up everybody
+      std::scoped_lock lock(m_mutex);
+      m_stop = true;
+
+      for (auto& [pid, entry] : m_entries) {
+        if (!entry.exit) {
+          setExited(pid, entry, e);
+        }
+      }
+
+      break;
+    }
+
+    std::scoped_lock lock(m_mutex);
+
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.u64 == WakeUpKey) {
+        // only used to wake up the thread, resets the counter
+        uint64_t count                = 0;
+        [[maybe_unused]] const auto r = read(m_wakeUp, &count, sizeof(count));
+
+        continue;
+      }
+
+      const auto pid = static_cast<pid_t>(events[i].data.u64);
+
+      auto itor = m_entries.find(pid);
+      if (itor != m_entries.end() && !itor->second.exit) {
+        setExited(pid, itor->second);
+      }
+    }
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef MODORGANIZER_PROCESSMONITOR_INCLUDED
+#define MODORGANIZER_PROCESSMONITOR_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sys/types.h>
+#include <thread>
+
+// waits for processes to exit without polling
+//
+// every watched process has a pidfd registered with an epoll instance, a single
+// thread blocks on it and wakes up the waiters as soon as a process exits; this
+// works for any process, unlike waitid(), which only works for children of this
+// process while most processes started in the vfs are grandchildren
+//
+class ProcessMonitor
+{
+public:
+  struct Exit
+  {
+    // exit status, only available for children of this process
+    std::optional<int> exitCode;
+
+    // time between the process being watched and its exit
+    std::chrono::steady_clock::duration runTime{};
+
+    // errno if the process could not be watched, in which case it's considered
+    // to have exited
+    int error = 0;
+  };
+
+  ProcessMonitor();
+  ~ProcessMonitor();
+
+  // noncopyable
+  ProcessMonitor(const ProcessMonitor&)            = delete;
+  ProcessMonitor& operator=(const ProcessMonitor&) = delete;
+
+  static ProcessMonitor& instance();
+
+  // waits until the given process exits or the timeout elapses, returns
+  // immediately once the process has exited; the process is watched first if
+  // it wasn't already, using a duplicate of the given pidfd if there is one
+  //
+  // returns nothing if the process is still running, the exit is only returned
+  // once and the process is forgotten afterwards
+  //
+  std::optional<Exit> waitForExit(pid_t pid, std::chrono::milliseconds timeout,
+                                  int pidFd = -1);
+
+  // whether the given process is still running, watches it if it wasn't
+  // already; processes that have exited are forgotten
+  //
+  bool isRunning(pid_t pid);
+
+private:
+  struct Entry
+  {
+    int pidFd = -1;
+    std::chrono::steady_clock::time_point start;
+    std::optional<Exit> exit;
+  };
+
+  int m_epoll;
+  int m_wakeUp;
+  std::thread m_thread;
+  std::atomic<bool> m_stop;
+
+  // guards m_entries, the condition is notified every time a process exits
+  std::mutex m_mutex;
+  std::condition_variable m_exited;
+  std::map<pid_t, Entry> m_entries;
+
+  // adds the process to m_entries if it's not there yet, m_mutex must be locked
+  //
+  Entry& watch(pid_t pid, int pidFd);
+
+  // marks the given entry as exited and stops watching its pidfd, m_mutex must
+  // be locked
+  //
+  void setExited(pid_t pid, Entry& e, int error = 0);
+
+  void threadFun();
+};
+
+#endif  // MODORGANIZER_PROCESSMONITOR_INCLUDED
@@ -1,5 +1,6 @@
 #include "env.h"
 #include "organizercore.h"
+#include "processmonitor.h"
 #include "processrunner.h"
 #include <sys/wait.h>
 #include <usvfs-fuse/usvfsmanager.h>
@@ -31,26 +32,22 @@ std::optional<ProcessRunner::Results> singleWait(HANDLE pidFd, DWORD pid)
     return ProcessRunner::Error;
   }
 
-  // todo: find a better solution
-  // poll() supports timeouts, but is unreliable here
-  this_thread::sleep_for(50ms);
-
-  siginfo_t info{};
-  int result = waitid(P_PID, pid, &info, WEXITED | WSTOPPED | WNOHANG | WNOWAIT);
-
-  if (result == 0) {
-    if (info.si_pid != 0) {
-      log::debug("process {} completed", pid);
-      return ProcessRunner::Completed;
-    }
+  // returns as soon as the process exits, the timeout only allows the caller
+  // to check the lock widget regularly
+  const auto exit = ProcessMonitor::instance().waitForExit(pid, 50ms, pidFd);
 
+  if (!exit) {
     // still running
     return {};
   }
 
-  const int e = errno;
-  log::error("failed waiting for {}, {}", pid, formatSystemMessage(e));
-  return ProcessRunner::Error;
+  if (exit->error != 0) {
+    log::error("failed waiting for {}, {}", pid, formatSystemMessage(exit->error));
+    return ProcessRunner::Error;
+  }
+
+  log::debug("process {} completed", pid);
+  return ProcessRunner::Completed;
 }
 
 extern void waitForProcessesThread(ProcessRunner::Results& result, HANDLE job,
@@ -86,7 +83,7 @@ ProcessRunner::Results waitForProcesses(const std::vector<HANDLE>& initialProces
   delete t;
 
   if (results == ProcessRunner::Completed) {
-    if (getRunningUSVFSProcesses().empty()) {
+    if (!anyUSVFSProcessRunning()) {
       UsvfsManager::instance()->unmount();
     }
   }
@@ -103,20 +100,20 @@ ProcessRunner::Results waitForProcess(HANDLE initialProcess, LPDWORD exitCode,
 
   // as long as it's not running anymore, try to get the exit code
   if (exitCode && r != ProcessRunner::Running) {
-    siginfo_t info;
+    siginfo_t info{};
 
     if (waitid(P_PIDFD, initialProcess, &info, WEXITED) != 0) {
       const auto e = errno;
       log::warn("failed to get exit code of process, {}", strerror(e));
+    } else if (info.si_code == CLD_EXITED) {
+      *exitCode = info.si_status;
+    } else {
+      // killed by a signal
+      *exitCode = 128 + info.si_status;
     }
-    *exitCode = info.si_code;
   }
 
-  // wait for unmount to complete
-  // todo: improve or remove this
-  log::debug("sleeping for 10ms");
-  std::this_thread::sleep_for(std::chrono::milliseconds(10));
-
+  // unmount() is synchronous, there's nothing left to wait for
   return r;
 }
 
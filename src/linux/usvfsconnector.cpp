@@ -1,8 +1,12 @@
 #include "usvfsconnector.h"
 #include "organizercore.h"
+#include "processmonitor.h"
 #include "settings.h"
 #include "shared/util.h"
+#include "vfsmapping.h"
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QProgressDialog>
 #include <sys/wait.h>
 #include <usvfs-fuse/usvfsmanager.h>
 
@@ -97,31 +101,79 @@ UsvfsConnector::~UsvfsConnector()
   }
 }
 
-void UsvfsConnector::updateMapping(const MappingType& mapping)
+void UsvfsConnector::updateMapping(const MappingType& mapping,
+                                   std::size_t contentToken)
 {
-  const auto start = std::chrono::high_resolution_clock::now();
+  const auto start   = std::chrono::high_resolution_clock::now();
+  const auto changes = MappingChanges::compute(m_applied, mapping);
 
+  // the content of linked directories is only read when they're linked
+  const bool sameContent = (contentToken == m_appliedToken);
+
+  if (sameContent && changes.identical) {
+    log::debug("VFS mappings unchanged, {} links", mapping.size());
+    return;
+  }
+
+  log::debug("Updating VFS mappings, {} added, {} removed, {} changed, {} kept, "
+             "files {}...",
+             changes.added, changes.removed, changes.changed, changes.common,
+             sameContent ? "unchanged" : "changed");
+
+  std::size_t first = 0;
+
+  if (sameContent && changes.appendOnly) {
+    // links can be added on top of the ones that are already there
+    first = changes.common;
+  } else {
+    // there's no way to remove a single link
+    clearMapping();
+  }
+
+  const auto [dirs, files] = link(mapping, first);
+  m_applied                = mapping;
+  m_appliedToken           = contentToken;
+
+  const auto end  = std::chrono::high_resolution_clock::now();
+  const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  log::debug("VFS mappings updated, linked {} dirs and {} files in {}ms", dirs, files,
+             time.count());
+}
+
+void UsvfsConnector::clearMapping()
+{
+  m_usvfsManager->usvfsClearVirtualMappings();
+  m_applied.clear();
+}
+
+std::pair<int, int> UsvfsConnector::link(const MappingType& mapping, std::size_t first)
+{
+  // the progress dialog is only shown if this takes a while, and events are
+  // processed a few times per second instead of after every few links
   QProgressDialog progress(qApp->activeWindow());
   progress.setLabelText(tr("Preparing vfs"));
-  progress.setMaximum(static_cast<int>(mapping.size()));
-  progress.show();
+  progress.setMaximum(static_cast<int>(mapping.size() - first));
+  progress.setMinimumDuration(500);
 
-  int value = 0;
-  int files = 0;
-  int dirs  = 0;
+  QElapsedTimer sinceEvents;
+  sinceEvents.start();
 
-  log::debug("Updating VFS mappings...");
+  int dirs  = 0;
+  int files = 0;
 
-  m_usvfsManager->usvfsClearVirtualMappings();
+  for (std::size_t i = first; i < mapping.size(); ++i) {
+    const auto& map = mapping[i];
 
-  for (const auto& map : mapping) {
-    if (progress.wasCanceled()) {
-      m_usvfsManager->usvfsClearVirtualMappings();
-      throw UsvfsConnectorException(u"VFS mapping canceled by user"_s);
-    }
-    progress.setValue(value++);
-    if (value % 10 == 0) {
+    if (sinceEvents.elapsed() >= 50) {
+      progress.setValue(static_cast<int>(i - first));
       QCoreApplication::processEvents();
+      sinceEvents.restart();
+
+      if (progress.wasCanceled()) {
+        clearMapping();
+        throw UsvfsConnectorException(u"VFS mapping canceled by user"_s);
+      }
     }
 
     try {
@@ -136,16 +188,12 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
         ++files;
       }
     } catch (const std::runtime_error& ex) {
-      m_usvfsManager->usvfsClearVirtualMappings();
+      clearMapping();
       throw UsvfsConnectorException(ex.what());
     }
   }
 
-  const auto end  = std::chrono::high_resolution_clock::now();
-  const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-  log::debug("VFS mappings updated, linked {} dirs and {} files in {}ms", dirs, files,
-             time.count());
+  return {dirs, files};
 }
 
 void UsvfsConnector::updateParams(log::Levels logLevel,
@@ -195,17 +243,38 @@ void UsvfsConnector::updateForcedLibraries(
 
 std::vector<HANDLE> getRunningUSVFSProcesses()
 {
-  const auto& pids = UsvfsManager::instance()->usvfsGetVFSProcessList();
+  const auto& pids    = UsvfsManager::instance()->usvfsGetVFSProcessList();
+  const pid_t thisPid = getpid();
+  auto& monitor       = ProcessMonitor::instance();
 
   std::vector<HANDLE> result;
 
   for (const auto& pid : pids) {
-    siginfo_t info{};
-    if (waitid(P_PID, pid, &info, WEXITED | WSTOPPED | WNOHANG | WNOWAIT) == 0) {
-      if (info.si_pid == 0) {
-        result.emplace_back(pidfd_open(pid, 0));
-      }
+    if (pid == thisPid) {
+      continue;  // obviously don't wait for MO process
+    }
+
+    // processes that have exited are skipped without being opened; the pidfd
+    // is opened for the caller, the monitor keeps its own
+    if (!monitor.isRunning(pid)) {
+      continue;
+    }
+
+    const int fd = pidfd_open(pid, 0);
+    if (fd != -1) {
+      result.push_back(fd);
     }
   }
   return result;
 }
+
+bool anyUSVFSProcessRunning()
+{
+  const auto& pids    = UsvfsManager::instance()->usvfsGetVFSProcessList();
+  const pid_t thisPid = getpid();
+  auto& monitor       = ProcessMonitor::instance();
+
+  return std::ranges::any_of(pids, [&](auto&& pid) {
+    return (pid != thisPid && monitor.isRunning(pid));
+  });
+}
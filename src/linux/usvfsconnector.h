@@ -30,7 +30,12 @@ public:
   UsvfsConnector();
   ~UsvfsConnector() override;
 
-  void updateMapping(const MappingType& mapping);
+  // only adds the links that changed since the last call, or nothing at all
+  // if the mapping is the same; directories are linked statically, so
+  // everything is linked again if the content token has changed since the
+  // last call
+  //
+  void updateMapping(const MappingType& mapping, std::size_t contentToken = 0);
 
   void updateParams(MOBase::log::Levels logLevel, env::CoreDumpTypes coreDumpType,
                     const QString& crashDumpsPath, std::chrono::seconds spawnDelay,
@@ -42,8 +47,25 @@ public:
 
 private:
   std::shared_ptr<UsvfsManager> m_usvfsManager;
+
+  // mapping as it was last applied to the vfs
+  MappingType m_applied;
+  std::size_t m_appliedToken = 0;
+
+  void clearMapping();
+
+  // links the given range of the mapping, returns the number of directories
+  // and files
+  std::pair<int, int> link(const MappingType& mapping, std::size_t first);
 };
 
-std::vector<pid_t> getRunningUSVFSProcesses();
+// opens a pidfd for every process running in the vfs except this one, the
+// caller owns the returned handles and must close them
+//
+std::vector<HANDLE> getRunningUSVFSProcesses();
+
+// same as !getRunningUSVFSProcesses().empty(), but doesn't open the processes
+//
+bool anyUSVFSProcessRunning();
 
 #endif  // USVFSCONNECTOR_H
@@ -0,0 +1,92 @@
+#include "listingfiletree.h"
+
+using namespace MOBase;
+
+class ListingFileTreeImpl : public ListingFileTree
+{
+public:
+  ListingFileTreeImpl(std::shared_ptr<const IFileTree> parent, const QString& name,
+                      std::shared_ptr<const env::Directory> listing,
+                      const env::Directory* dir, bool ignoreMeta)
+      : FileTreeEntry(parent, name), ListingFileTree(), m_Listing(std::move(listing)),
+        m_Dir(dir), m_IgnoreMeta(ignoreMeta)
+  {}
+
+protected:
+  /**
+   * No mutable operations allowed.
+   */
+  bool beforeReplace(IFileTree const* dstTree, FileTreeEntry const* destination,
+                     FileTreeEntry const* source) override
+  {
+    return false;
+  }
+  bool beforeInsert(IFileTree const* entry, FileTreeEntry const* name) override
+  {
+    return false;
+  }
+  bool beforeRemove(IFileTree const* entry, FileTreeEntry const* name) override
+  {
+    return false;
+  }
+  std::shared_ptr<FileTreeEntry> makeFile(std::shared_ptr<const IFileTree> parent,
+                                          QString name) const override
+  {
+    return nullptr;
+  }
+  std::shared_ptr<IFileTree> makeDirectory(std::shared_ptr<const IFileTree> parent,
+                                           QString name) const override
+  {
+    return nullptr;
+  }
+
+  bool doPopulate(std::shared_ptr<const IFileTree> parent,
+                  std::vector<std::shared_ptr<FileTreeEntry>>& entries) const override
+  {
+    entries.reserve(m_Dir->dirs.size() + m_Dir->files.size());
+
+    for (const auto& d : m_Dir->dirs) {
+      entries.push_back(
+          std::make_shared<ListingFileTreeImpl>(parent, d.name, m_Listing, &d, false));
+    }
+
+    for (const auto& f : m_Dir->files) {
+      if (m_IgnoreMeta && f.name.compare("meta.ini", Qt::CaseInsensitive) == 0) {
+        continue;
+      }
+
+      entries.push_back(createFileEntry(parent, f.name));
+    }
+
+    // entries are in the order of the walker, which is not sorted
+    return false;
+  }
+
+  std::shared_ptr<IFileTree> doClone() const
+  {
+    return std::make_shared<ListingFileTreeImpl>(nullptr, name(), m_Listing, m_Dir,
+                                                 m_IgnoreMeta);
+  }
+
+private:
+  // keeps the whole listing alive, m_Dir points into it
+  std::shared_ptr<const env::Directory> m_Listing;
+  const env::Directory* m_Dir;
+
+  // only set for the root
+  bool m_IgnoreMeta;
+};
+
+/**
+ *
+ */
+std::shared_ptr<const ListingFileTree>
+ListingFileTree::makeTree(const QString& name,
+                          std::shared_ptr<const env::Directory> listing,
+                          bool ignoreRootMeta)
+{
+  const env::Directory* root = listing.get();
+
+  return std::make_shared<ListingFileTreeImpl>(nullptr, name, std::move(listing), root,
+                                               ignoreRootMeta);
+}
@@ -0,0 +1,63 @@
+/*
+Copyright (C) MO2 Team. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LISTINGFILETREE_H
+#define LISTINGFILETREE_H
+
+#include <memory>
+
+#include "envfs.h"
+#include "ifiletree.h"
+
+/**
+ * @brief Class that expose the listing of a directory, as walked by the
+ * directory refresher, as a `MOBase::IFileTree`.
+ *
+ * The listing is already in memory, so populating the tree never touches the
+ * disk. The tree keeps the listing alive.
+ *
+ * This class does not expose mutable operations, so any mutable operations will
+ * fail.
+ */
+class ListingFileTree : public MOBase::IFileTree
+{
+public:
+  /**
+   * @brief Create a new file tree representing the given listing.
+   *
+   * @param name Name of the root of the tree.
+   * @param listing Listing of the directory.
+   * @param ignoreRootMeta If true, the meta.ini file in the root folder will
+   *   be ignored.
+   *
+   * @return a file tree representing the given listing.
+   */
+  static std::shared_ptr<const ListingFileTree>
+  makeTree(const QString& name, std::shared_ptr<const env::Directory> listing,
+           bool ignoreRootMeta = true);
+
+protected:
+  using IFileTree::IFileTree;
+
+  virtual bool
+  doPopulate(std::shared_ptr<const IFileTree> parent,
+             std::vector<std::shared_ptr<FileTreeEntry>>& entries) const = 0;
+};
+
+#endif
@@ -51,6 +51,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modlist.h"
 #include "modlistcontextmenu.h"
 #include "modlistviewactions.h"
+#include "modmetawriter.h"
 #include "motddialog.h"
 #include "nexusinterface.h"
 #include "nxmaccessmanager.h"
@@ -484,10 +485,6 @@ MainWindow::MainWindow(Settings& settings, OrganizerCore& organizerCore,
   connect(this, &MainWindow::checkForProblemsDone, this,
           &MainWindow::updateProblemsButton, Qt::ConnectionType::QueuedConnection);
 
-  m_SaveMetaTimer.setSingleShot(false);
-  connect(&m_SaveMetaTimer, SIGNAL(timeout()), this, SLOT(saveModMetas()));
-  m_SaveMetaTimer.start(5000);
-
   FileDialogMemory::restore(settings);
 
   fixCategories();
@@ -1490,8 +1487,8 @@ void MainWindow::cleanup()
     m_IntegratedBrowser = {};
   }
 
-  m_SaveMetaTimer.stop();
-  m_MetaSave.waitForFinished();
+  // changes to the meta.ini of mods are written in the background
+  ModMetaWriter::instance().flush();
 }
 
 bool MainWindow::eventFilter(QObject* object, QEvent* event)
@@ -1936,11 +1933,7 @@ void MainWindow::updateBSAList(const QStringList& defaultArchives,
   std::vector<FileEntryPtr> files = m_OrganizerCore.directoryStructure()->getFiles();
 
   QStringList plugins =
-      m_OrganizerCore.findFiles("", [](const QString& fileName) -> bool {
-        return fileName.endsWith(".esp", Qt::CaseInsensitive) ||
-               fileName.endsWith(".esm", Qt::CaseInsensitive) ||
-               fileName.endsWith(".esl", Qt::CaseInsensitive);
-      });
+      m_OrganizerCore.findFiles("", QStringList{"*.esp", "*.esm", "*.esl"});
 
   QList<std::pair<QString, QString>> pluginNamePairs;
   pluginNamePairs.reserve(plugins.size());
@@ -2091,18 +2084,6 @@ void MainWindow::checkBSAList()
   }
 }
 
-void MainWindow::saveModMetas()
-{
-  if (m_MetaSave.isFinished()) {
-    m_MetaSave = QtConcurrent::run([this]() {
-      for (unsigned int i = 0; i < ModInfo::getNumMods(); ++i) {
-        ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-        modInfo->saveMeta();
-      }
-    });
-  }
-}
-
 void MainWindow::fixCategories()
 {
   for (unsigned int i = 0; i < ModInfo::getNumMods(); ++i) {
@@ -3517,7 +3498,6 @@ void MainWindow::nxmTrackedModsAvailable(QVariant userData, QVariant resultData,
     }
 
     modInfo->setIsTracked(found);
-    modInfo->saveMeta();
   }
 }
 
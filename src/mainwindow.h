@@ -291,11 +291,8 @@ private:
   CategoryFactory& m_CategoryFactory;
 
   QTimer m_CheckBSATimer;
-  QTimer m_SaveMetaTimer;
   QTimer m_UpdateProblemsTimer;
 
-  QFuture<void> m_MetaSave;
-
   QTime m_StartTime;
 
   OrganizerCore& m_OrganizerCore;
@@ -418,8 +415,6 @@ private slots:
   // Perform the actual problem check in another thread.
   QFuture<void> checkForProblemsAsync();
 
-  void saveModMetas();
-
   void updateStyle(const QString& style);
 
   void resizeLists(bool pluginListCustom);
@@ -0,0 +1,377 @@
+#include "modconflicts.h"
+#include "modinfo.h"
+#include "shared/directoryentry.h"
+#include "shared/fileentry.h"
+#include "shared/fileregister.h"
+#include "shared/filesorigin.h"
+#include "taskscheduler.h"
+#include <algorithm>
+#include <log.h>
+#include <unordered_map>
+#include <utility.h>
+
+using namespace MOBase;
+using namespace MOShared;
+
+namespace
+{
+
+// files per range, ranges are small enough to keep all the threads busy but
+// large enough that the per-range accumulators stay cheap
+constexpr std::size_t MinFilesPerRange = 2048;
+
+struct OriginInfo
+{
+  int priority          = 0;
+  unsigned int modIndex = UINT_MAX;
+  bool isData           = false;
+};
+
+// conflicts of one origin collected from a range of files
+//
+struct Accumulator
+{
+  bool hasFiles = false;
+  bool hidden   = false;
+  bool visible  = false;
+  bool provides = false;
+
+  ModConflicts::Entry entry;
+};
+
+struct Range
+{
+  std::size_t begin = 0;
+  std::size_t end   = 0;
+
+  // indexed by origin id, only allocated for the origins seen in this range
+  std::vector<std::unique_ptr<Accumulator>> origins;
+
+  // whether each directory seen in this range is hidden
+  std::unordered_map<const DirectoryEntry*, bool> hiddenDirs;
+};
+
+// lists are only compacted at the end, but consecutive files usually conflict
+// with the same mods so most duplicates are skipped here
+//
+void add(std::vector<unsigned int>& v, unsigned int modIndex)
+{
+  if (v.empty() || v.back() != modIndex) {
+    v.push_back(modIndex);
+  }
+}
+
+void compact(std::vector<unsigned int>& v)
+{
+  std::sort(v.begin(), v.end());
+  v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+void append(std::vector<unsigned int>& dest, const std::vector<unsigned int>& from)
+{
+  dest.insert(dest.end(), from.begin(), from.end());
+}
+
+// a directory is hidden if its name or the name of any of its parents ends
+// with the hidden extension
+//
+bool isHidden(const DirectoryEntry* dir, Range& range)
+{
+  if (dir == nullptr) {
+    return false;
+  }
+
+  auto itor = range.hiddenDirs.find(dir);
+  if (itor != range.hiddenDirs.end()) {
+    return itor->second;
+  }
+
+  const bool hidden =
+      dir->getName().endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive) ||
+      isHidden(dir->getParent(), range);
+
+  range.hiddenDirs.emplace(dir, hidden);
+  return hidden;
+}
+
+bool isKnown(OriginID id, const std::vector<OriginInfo>& infos)
+{
+  return (id >= 0 && static_cast<std::size_t>(id) < infos.size());
+}
+
+void checkFile(FileEntry& file, const std::vector<OriginInfo>& infos, Range& range)
+{
+  const OriginID primary = file.getOrigin();
+  if (!isKnown(primary, infos)) {
+    return;
+  }
+
+  const auto& alternatives = file.getAlternatives();
+
+  // the origins that contain this file, an origin can have the same file both
+  // loose and in an archive but it's only checked once
+  boost::container::small_vector<OriginID, 4> origins;
+  origins.push_back(primary);
+
+  for (const auto& alt : alternatives) {
+    const OriginID id = alt.originID();
+
+    if (isKnown(id, infos) &&
+        std::find(origins.begin(), origins.end(), id) == origins.end()) {
+      origins.push_back(id);
+    }
+  }
+
+  const bool hidden =
+      file.getName().endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive) ||
+      isHidden(file.getParent(), range);
+
+  // no alternatives or overwriting a file from the game -> no conflict
+  const bool noConflict = alternatives.empty() ||
+                          (isKnown(alternatives.back().originID(), infos) &&
+                           infos[alternatives.back().originID()].isData);
+
+  for (const OriginID id : origins) {
+    auto& acc = range.origins[id];
+    if (!acc) {
+      acc = std::make_unique<Accumulator>();
+    }
+
+    acc->hasFiles = true;
+
+    if (hidden) {
+      // skip hidden file conflicts
+      acc->hidden = true;
+      continue;
+    }
+
+    acc->visible = true;
+
+    if (noConflict) {
+      acc->provides = true;
+      continue;
+    }
+
+    auto& e = acc->entry;
+
+    // archive of the file in this origin
+    DataArchiveOrigin archiveData;
+    if (id == primary) {
+      archiveData = file.getArchive();
+    } else {
+      for (const auto& alt : alternatives) {
+        if (alt.originID() == id) {
+          archiveData = alt.archive();
+          break;
+        }
+      }
+    }
+
+    if (id != primary) {
+      const unsigned int altIndex = infos[primary].modIndex;
+
+      if (!file.getArchive().isValid()) {
+        if (!archiveData.isValid()) {
+          add(e.m_OverwrittenList, altIndex);
+        } else {
+          add(e.m_ArchiveLooseOverwrittenList, altIndex);
+        }
+      } else {
+        add(e.m_ArchiveOverwrittenList, altIndex);
+      }
+    } else {
+      acc->provides = true;
+    }
+
+    for (const auto& alt : alternatives) {
+      if (alt.originID() == id || !isKnown(alt.originID(), infos)) {
+        continue;
+      }
+
+      const auto& altInfo         = infos[alt.originID()];
+      const unsigned int altIndex = altInfo.modIndex;
+
+      if (!alt.isFromArchive()) {
+        if (!archiveData.isValid()) {
+          if (infos[id].priority > altInfo.priority) {
+            add(e.m_OverwriteList, altIndex);
+          } else {
+            add(e.m_OverwrittenList, altIndex);
+          }
+        } else {
+          add(e.m_ArchiveLooseOverwrittenList, altIndex);
+        }
+      } else {
+        if (!archiveData.isValid()) {
+          add(e.m_ArchiveLooseOverwriteList, altIndex);
+        } else if (archiveData.order() > alt.archive().order()) {
+          add(e.m_ArchiveOverwriteList, altIndex);
+        } else if (archiveData.order() < alt.archive().order()) {
+          add(e.m_ArchiveOverwrittenList, altIndex);
+        }
+      }
+    }
+  }
+}
+
+ModConflicts::EConflictType conflictState(const std::vector<unsigned int>& overwrite,
+                                          const std::vector<unsigned int>& overwritten)
+{
+  if (!overwrite.empty() && !overwritten.empty()) {
+    return ModConflicts::CONFLICT_MIXED;
+  } else if (!overwrite.empty()) {
+    return ModConflicts::CONFLICT_OVERWRITE;
+  } else if (!overwritten.empty()) {
+    return ModConflicts::CONFLICT_OVERWRITTEN;
+  }
+
+  return ModConflicts::CONFLICT_NONE;
+}
+
+// merges the accumulators of the given origin from all the ranges
+//
+bool merge(OriginID id, const std::vector<Range>& ranges, ModConflicts::Entry& e)
+{
+  bool hasFiles = false, hidden = false, visible = false, provides = false;
+
+  for (const auto& range : ranges) {
+    const auto& acc = range.origins[id];
+    if (!acc) {
+      continue;
+    }
+
+    hasFiles |= acc->hasFiles;
+    hidden |= acc->hidden;
+    visible |= acc->visible;
+    provides |= acc->provides;
+
+    append(e.m_OverwriteList, acc->entry.m_OverwriteList);
+    append(e.m_OverwrittenList, acc->entry.m_OverwrittenList);
+    append(e.m_ArchiveOverwriteList, acc->entry.m_ArchiveOverwriteList);
+    append(e.m_ArchiveOverwrittenList, acc->entry.m_ArchiveOverwrittenList);
+    append(e.m_ArchiveLooseOverwriteList, acc->entry.m_ArchiveLooseOverwriteList);
+    append(e.m_ArchiveLooseOverwrittenList, acc->entry.m_ArchiveLooseOverwrittenList);
+  }
+
+  if (!hasFiles) {
+    return false;
+  }
+
+  compact(e.m_OverwriteList);
+  compact(e.m_OverwrittenList);
+  compact(e.m_ArchiveOverwriteList);
+  compact(e.m_ArchiveOverwrittenList);
+  compact(e.m_ArchiveLooseOverwriteList);
+  compact(e.m_ArchiveLooseOverwrittenList);
+
+  if (visible && !provides) {
+    e.m_CurrentConflictState = ModConflicts::CONFLICT_REDUNDANT;
+  } else {
+    e.m_CurrentConflictState = conflictState(e.m_OverwriteList, e.m_OverwrittenList);
+  }
+
+  e.m_ArchiveConflictState =
+      conflictState(e.m_ArchiveOverwriteList, e.m_ArchiveOverwrittenList);
+
+  e.m_ArchiveConflictLooseState =
+      conflictState(e.m_ArchiveLooseOverwriteList, e.m_ArchiveLooseOverwrittenList);
+
+  e.m_HasHiddenFiles = hidden;
+
+  return true;
+}
+
+}  // namespace
+
+std::shared_ptr<const ModConflicts>
+ModConflicts::compute(const DirectoryEntry& root, const QStringList& dataOrigins,
+                      std::size_t threadCount)
+{
+  TimeThis tt("ModConflicts::compute()");
+
+  // everything the ranges need about the origins is gathered here, mod
+  // indices are behind a mutex and origins are looked up by id in a map
+  const auto origins = root.getOrigins();
+  std::vector<OriginInfo> infos;
+
+  for (const auto* origin : origins) {
+    const auto id = static_cast<std::size_t>(origin->getID());
+    if (id >= infos.size()) {
+      infos.resize(id + 1);
+    }
+
+    auto& info    = infos[id];
+    info.priority = origin->getPriority();
+    info.modIndex = ModInfo::getIndex(origin->getName());
+    info.isData   = dataOrigins.contains(origin->getName());
+  }
+
+  const auto files = root.getFileRegister()->getFiles();
+
+  const std::size_t perRange = std::max(
+      MinFilesPerRange, files.size() / std::max<std::size_t>(1, threadCount * 4));
+
+  std::vector<Range> ranges;
+  for (std::size_t i = 0; i < files.size(); i += perRange) {
+    Range r;
+    r.begin = i;
+    r.end   = std::min(files.size(), i + perRange);
+    r.origins.resize(infos.size());
+
+    ranges.push_back(std::move(r));
+  }
+
+  parallelMap(
+      ranges.begin(), ranges.end(),
+      [&](Range& range) {
+        for (std::size_t i = range.begin; i < range.end; ++i) {
+          if (files[i]) {
+            checkFile(*files[i], infos, range);
+          }
+        }
+      },
+      threadCount);
+
+  // merged in parallel by origin, entries are null for origins without files
+  std::vector<std::unique_ptr<Entry>> entries(infos.size());
+  std::vector<OriginID> ids(infos.size());
+
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    ids[i] = static_cast<OriginID>(i);
+  }
+
+  parallelMap(
+      ids.begin(), ids.end(),
+      [&](OriginID id) {
+        auto e = std::make_unique<Entry>();
+        if (merge(id, ranges, *e)) {
+          entries[id] = std::move(e);
+        }
+      },
+      threadCount);
+
+  auto mc = std::make_shared<ModConflicts>();
+  mc->m_Entries.reserve(static_cast<qsizetype>(origins.size()));
+
+  for (const auto* origin : origins) {
+    auto& e = entries[origin->getID()];
+    if (e) {
+      mc->m_Entries.insert(origin->getName(), std::move(*e));
+    }
+  }
+
+  log::debug("computed conflicts of {} origins from {} files in {} ranges",
+             mc->m_Entries.size(), files.size(), ranges.size());
+
+  return mc;
+}
+
+const ModConflicts::Entry* ModConflicts::find(const QString& originName) const
+{
+  auto itor = m_Entries.constFind(originName);
+  if (itor == m_Entries.constEnd()) {
+    return nullptr;
+  }
+
+  return &*itor;
+}
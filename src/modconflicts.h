@@ -0,0 +1,87 @@
+#ifndef MODORGANIZER_MODCONFLICTS_INCLUDED
+#define MODORGANIZER_MODCONFLICTS_INCLUDED
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+namespace MOShared
+{
+class DirectoryEntry;
+}
+
+/**
+ * @brief conflicts of every mod of a directory structure, computed in one pass
+ * over all the files of the structure instead of once per mod
+ *
+ * the files are split in ranges that are processed in parallel, each range
+ * collects the conflicts of the origins it sees and the results are merged
+ * per origin afterwards
+ *
+ * this is immutable once computed, so it can be shared between threads
+ **/
+class ModConflicts
+{
+public:
+  enum EConflictType
+  {
+    CONFLICT_NONE,
+    CONFLICT_OVERWRITE,
+    CONFLICT_OVERWRITTEN,
+    CONFLICT_MIXED,
+    CONFLICT_REDUNDANT,
+    CONFLICT_CROSS
+  };
+
+  // conflicts of one origin; lists contain mod indices and are sorted without
+  // duplicates
+  //
+  struct Entry
+  {
+    EConflictType m_CurrentConflictState      = CONFLICT_NONE;
+    EConflictType m_ArchiveConflictState      = CONFLICT_NONE;
+    EConflictType m_ArchiveConflictLooseState = CONFLICT_NONE;
+    bool m_HasHiddenFiles                     = false;
+
+    // mods overwritten by this mod
+    std::vector<unsigned int> m_OverwriteList;
+
+    // mods overwriting this mod
+    std::vector<unsigned int> m_OverwrittenList;
+
+    // mods with archive files overwritten by this mod's archives
+    std::vector<unsigned int> m_ArchiveOverwriteList;
+
+    // mods with archive files overwriting this mod's archives
+    std::vector<unsigned int> m_ArchiveOverwrittenList;
+
+    // mods with archives being overwritten by this mod's loose files
+    std::vector<unsigned int> m_ArchiveLooseOverwriteList;
+
+    // mods with loose files overwriting this mod's archive files
+    std::vector<unsigned int> m_ArchiveLooseOverwrittenList;
+  };
+
+  /**
+   * @brief computes the conflicts of every origin of the given structure
+   *
+   * @param root Root of the structure.
+   * @param dataOrigins Names of the origins for the data directories of the
+   *     game, files that are in one of them don't conflict.
+   * @param threadCount Maximum number of threads to use.
+   **/
+  static std::shared_ptr<const ModConflicts>
+  compute(const MOShared::DirectoryEntry& root, const QStringList& dataOrigins,
+          std::size_t threadCount);
+
+  // conflicts of the given origin, null if it doesn't exist or has no files
+  //
+  const Entry* find(const QString& originName) const;
+
+private:
+  QHash<QString, Entry> m_Entries;
+};
+
+#endif  // MODORGANIZER_MODCONFLICTS_INCLUDED
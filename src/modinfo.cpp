@@ -28,9 +28,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "categories.h"
 #include "modinfodialog.h"
 #include "modlist.h"
+#include "modmetacache.h"
 #include "organizercore.h"
 #include "overwriteinfodialog.h"
-#include "thread_utils.h"
+#include "settings.h"
+#include "taskscheduler.h"
 #include "versioninfo.h"
 
 #include "shared/appconfig.h"
@@ -49,13 +51,15 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 using namespace MOBase;
 using namespace MOShared;
 
-const std::set<unsigned int> ModInfo::s_EmptySet;
+const std::vector<unsigned int> ModInfo::s_EmptyList;
 std::vector<ModInfo::Ptr> ModInfo::s_Collection;
 ModInfo::Ptr ModInfo::s_Overwrite;
 std::map<QString, unsigned int, MOBase::FileNameComparator> ModInfo::s_ModsByName;
 std::map<std::pair<QString, int>, std::vector<unsigned int>> ModInfo::s_ModsByModID;
 int ModInfo::s_NextID;
 QRecursiveMutex ModInfo::s_Mutex;
+ModMetaCache ModInfo::s_MetaCache;
+QString ModInfo::s_MetaCacheFile;
 
 QString ModInfo::s_HiddenExt(".mohidden");
 
@@ -83,17 +87,18 @@ bool ModInfo::isRegularName(const QString& name)
   return !isSeparatorName(name) && !isBackupName(name);
 }
 
-ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core)
+ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core,
+                                  std::shared_ptr<const ModMeta> meta)
 {
   QMutexLocker locker(&s_Mutex);
   ModInfo::Ptr result;
 
   if (isBackupName(dir.dirName())) {
-    result = ModInfo::Ptr(new ModInfoBackup(dir, core));
+    result = ModInfo::Ptr(new ModInfoBackup(dir, core, std::move(meta)));
   } else if (isSeparatorName(dir.dirName())) {
-    result = Ptr(new ModInfoSeparator(dir, core));
+    result = Ptr(new ModInfoSeparator(dir, core, std::move(meta)));
   } else {
-    result = ModInfo::Ptr(new ModInfoRegular(dir, core));
+    result = ModInfo::Ptr(new ModInfoRegular(dir, core, std::move(meta)));
   }
   result->m_Index = s_Collection.size();
   s_Collection.push_back(result);
@@ -245,8 +250,19 @@ void ModInfo::updateFromDisc(const QString& modsDirectory, OrganizerCore& core,
     QDir mods(QDir::fromNativeSeparators(modsDirectory));
     mods.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
     QDirIterator modIter(mods);
+
+    std::vector<QString> dirs, metaPaths;
     while (modIter.hasNext()) {
-      createFrom(QDir(modIter.next()), core);
+      dirs.push_back(modIter.next());
+      metaPaths.push_back(dirs.back() + "/meta.ini");
+    }
+
+    // the meta.ini files are read in parallel, but mods are QObjects and must be
+    // created on this thread
+    const auto metas = readMetas(metaPaths, refreshThreadCount);
+
+    for (std::size_t i = 0; i < dirs.size(); ++i) {
+      createFrom(QDir(dirs[i]), core, metas[i]);
     }
   }
 
@@ -280,6 +296,30 @@ void ModInfo::updateFromDisc(const QString& modsDirectory, OrganizerCore& core,
   updateIndices();
 }
 
+std::vector<std::shared_ptr<const ModMeta>>
+ModInfo::readMetas(const std::vector<QString>& paths, std::size_t threadCount)
+{
+  TimeThis tt("ModInfo::readMetas()");
+
+  const QString file = Settings::instance().paths().cache() + "/mods.meta";
+
+  if (file != s_MetaCacheFile) {
+    s_MetaCache.load(file);
+    s_MetaCacheFile = file;
+  }
+
+  auto metas = s_MetaCache.get(paths, threadCount);
+
+  log::debug("meta.ini: {} from the cache, {} read", s_MetaCache.hits(),
+             s_MetaCache.misses());
+
+  // all the mods were given, so the others are gone
+  s_MetaCache.removeUnseen();
+  s_MetaCache.save(file);
+
+  return metas;
+}
+
 void ModInfo::updateIndices()
 {
   s_ModsByName.clear();
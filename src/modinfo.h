@@ -24,6 +24,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "imodinterface.h"
 #include "versioninfo.h"
 
+class ModMetaCache;
+struct ModMeta;
 class OrganizerCore;
 class PluginContainer;
 class QDir;
@@ -38,6 +40,7 @@ class QDateTime;
 #include <boost/function.hpp>
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -57,7 +60,9 @@ class DirectoryEntry;
  * to manage the mod collection
  *
  */
-class ModInfo : public QObject, public MOBase::IModInterface
+class ModInfo : public QObject,
+                public MOBase::IModInterface,
+                public QEnableSharedFromThis<ModInfo>
 {
 
   Q_OBJECT
@@ -932,43 +937,49 @@ public:  // Conflicts
   // retrieve the list of mods (as mod index) that are overwritten by this one.
   // Updates may be delayed.
   //
-  virtual const std::set<unsigned int>& getModOverwrite() const { return s_EmptySet; }
+  virtual const std::vector<unsigned int>& getModOverwrite() const
+  {
+    return s_EmptyList;
+  }
 
   // retrieve the list of mods (as mod index) that overwrite this one.
   // Updates may be delayed.
   //
-  virtual const std::set<unsigned int>& getModOverwritten() const { return s_EmptySet; }
+  virtual const std::vector<unsigned int>& getModOverwritten() const
+  {
+    return s_EmptyList;
+  }
 
   // retrieve the list of mods (as mod index) with archives that are overwritten by
   // this one. Updates may be delayed
   //
-  virtual const std::set<unsigned int>& getModArchiveOverwrite() const
+  virtual const std::vector<unsigned int>& getModArchiveOverwrite() const
   {
-    return s_EmptySet;
+    return s_EmptyList;
   }
 
   // retrieve the list of mods (as mod index) with archives that overwrite this one.
   // Updates may be delayed.
   //
-  virtual const std::set<unsigned int>& getModArchiveOverwritten() const
+  virtual const std::vector<unsigned int>& getModArchiveOverwritten() const
   {
-    return s_EmptySet;
+    return s_EmptyList;
   }
 
   // retrieve the list of mods (as mod index) with archives that are overwritten by
   // loose files of this mod. Updates may be delayed.
   //
-  virtual const std::set<unsigned int>& getModArchiveLooseOverwrite() const
+  virtual const std::vector<unsigned int>& getModArchiveLooseOverwrite() const
   {
-    return s_EmptySet;
+    return s_EmptyList;
   }
 
   // retrieve the list of mods (as mod index) with loose files that overwrite this one's
   // archive files. Updates may be delayed.
   //
-  virtual const std::set<unsigned int>& getModArchiveLooseOverwritten() const
+  virtual const std::vector<unsigned int>& getModArchiveLooseOverwritten() const
   {
-    return s_EmptySet;
+    return s_EmptyList;
   }
 
 public slots:
@@ -1017,7 +1028,7 @@ protected:
 
   // empty set that can be returned in overwrite functions by
   // default
-  static const std::set<unsigned int> s_EmptySet;
+  static const std::vector<unsigned int> s_EmptyList;
 
 protected:
   friend class OrganizerCore;
@@ -1026,10 +1037,12 @@ protected:
    * @brief Create a new mod from the specified directory and add it to the collection.
    *
    * @param dir Directory to create from.
+   * @param meta Values of the meta.ini of the mod, read from the disk if null.
    *
    * @return pointer to the info-structure of the newly created/added mod.
    */
-  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core);
+  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core,
+                                 std::shared_ptr<const ModMeta> meta = {});
 
   /**
    * @brief Create a new "foreign-managed" mod from a tuple of plugin and archives.
@@ -1049,6 +1062,12 @@ protected:
   //
   static void updateIndices();
 
+  // returns the values of the given meta.ini files, from the cache when they
+  // haven't changed
+  //
+  static std::vector<std::shared_ptr<const ModMeta>>
+  readMetas(const std::vector<QString>& paths, std::size_t threadCount);
+
 protected:
   static QRecursiveMutex s_Mutex;
   static std::vector<ModInfo::Ptr> s_Collection;
@@ -1056,6 +1075,11 @@ protected:
   static std::map<QString, unsigned int, MOBase::FileNameComparator> s_ModsByName;
   static std::map<std::pair<QString, int>, std::vector<unsigned int>> s_ModsByModID;
   static int s_NextID;
+
+  // meta.ini of every mod, kept between refreshes and saved in the cache
+  // directory of the instance given by s_MetaCacheFile
+  static ModMetaCache s_MetaCache;
+  static QString s_MetaCacheFile;
 };
 
 #endif  // MODINFO_H
@@ -51,7 +51,8 @@ public:
   virtual void addInstalledFile(int, int) override {}
 
 private:
-  ModInfoBackup(const QDir& path, OrganizerCore& core);
+  ModInfoBackup(const QDir& path, OrganizerCore& core,
+                std::shared_ptr<const ModMeta> meta);
 };
 
 #endif  // MODINFOBACKUP_H
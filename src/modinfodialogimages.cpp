@@ -9,18 +9,6 @@
 using namespace MOBase;
 using namespace ImagesTabHelpers;
 
-QSize resizeWithAspectRatio(const QSize& original, const QSize& available)
-{
-  const auto ratio =
-      std::min({1.0, static_cast<double>(available.width()) / original.width(),
-                static_cast<double>(available.height()) / original.height()});
-
-  const QSize scaledSize(static_cast<int>(std::round(original.width() * ratio)),
-                         static_cast<int>(std::round(original.height() * ratio)));
-
-  return scaledSize;
-}
-
 QRect centeredRect(const QRect& rect, const QSize& size)
 {
   return QRect((rect.left() + rect.width() / 2) - size.width() / 2,
@@ -35,7 +23,8 @@ QString dimensionString(const QSize& s)
 
 ImagesTab::ImagesTab(ModInfoDialogTabContext cx)
     : ModInfoDialogTab(std::move(cx)), m_image(new ScalableImage),
-      m_ddsAvailable(false), m_ddsEnabled(false)
+      m_ddsAvailable(false), m_ddsEnabled(false),
+      m_thumbnails(Settings::instance().paths().cache() + "/thumbnails")
 {
   getSupportedFormats();
 
@@ -58,6 +47,11 @@ ImagesTab::ImagesTab(ModInfoDialogTabContext cx)
     onScrolled();
   });
 
+  connect(&m_thumbnails, &ThumbnailLoader::loaded,
+          [&](const ThumbnailLoader::Thumbnail& t) {
+            onThumbnailLoaded(t);
+          });
+
   ui->imagesShowDDS->setEnabled(m_ddsAvailable);
 
   m_filter.setEdit(ui->imagesFilter);
@@ -105,6 +99,7 @@ ImagesTab::ImagesTab(ModInfoDialogTabContext cx)
 
 void ImagesTab::clear()
 {
+  m_thumbnails.clear();
   m_files.clear();
   ui->imagesScrollerVBar->setValue(0);
   select(BadIndex);
@@ -253,12 +248,17 @@ void ImagesTab::getSupportedFormats()
 
 void ImagesTab::select(std::size_t i, Visibility v)
 {
+  auto* previous = m_files.selectedFile();
   m_files.select(i);
 
+  // only the selected file keeps its full image
+  if (previous && previous != m_files.selectedFile()) {
+    previous->releaseOriginal();
+  }
+
   if (auto* f = m_files.selectedFile()) {
-    // when jumping elsewhere in the list, such as with page down/up, the file
-    // might not be visible yet, which means it hasn't been loaded and would
-    // pass a null image in setImage() below
+    // thumbnails don't need the full image, it's only decoded for the
+    // selection
     f->ensureOriginalLoaded();
 
     ui->imagesPath->setText(QDir::toNativeSeparators(f->path()));
@@ -408,6 +408,9 @@ void ImagesTab::paintThumbnailsArea(QPaintEvent* e)
   const auto visible = cx.geo.fullyVisibleCount() + 1;
   const auto first   = ui->imagesScrollerVBar->value();
 
+  // thumbnails to load, visible ones first
+  std::vector<QString> wanted;
+
   for (std::size_t i = 0; i < visible; ++i) {
     const auto fileIndex = first + i;
     auto* file           = m_files.get(fileIndex);
@@ -415,12 +418,32 @@ void ImagesTab::paintThumbnailsArea(QPaintEvent* e)
       break;
     }
 
+    if (file->needsThumbnail(cx.geo)) {
+      wanted.push_back(file->path());
+    }
+
     cx.file       = file;
     cx.thumbIndex = i;
     cx.fileIndex  = fileIndex;
 
     paintThumbnail(cx);
   }
+
+  // followed by the next page, so scrolling down doesn't show empty thumbnails
+  for (std::size_t i = visible; i < visible * 2; ++i) {
+    auto* file = m_files.get(first + i);
+    if (!file) {
+      break;
+    }
+
+    if (file->needsThumbnail(cx.geo)) {
+      wanted.push_back(file->path());
+    }
+  }
+
+  // replaces the thumbnails that were wanted before, which might not be
+  // visible anymore
+  m_thumbnails.load(wanted, cx.geo.imageRect(0).size());
 }
 
 void ImagesTab::paintThumbnail(const PaintContext& cx)
@@ -454,12 +477,11 @@ void ImagesTab::paintThumbnailBorder(const PaintContext& cx)
 
 void ImagesTab::paintThumbnailImage(const PaintContext& cx)
 {
-  if (cx.file->failed()) {
+  if (cx.file->thumbnail().isNull()) {
+    // not loaded yet
     return;
   }
 
-  cx.file->loadIfNeeded(cx.geo);
-
   const auto imageRect       = cx.geo.imageRect(cx.thumbIndex);
   const auto scaledThumbRect = centeredRect(imageRect, cx.file->thumbnail().size());
 
@@ -560,6 +582,23 @@ void ImagesTab::onScrolled()
   ui->imagesThumbnails->update();
 }
 
+void ImagesTab::onThumbnailLoaded(const ThumbnailLoader::Thumbnail& t)
+{
+  auto* f = m_files.find(t.path);
+  if (!f) {
+    return;
+  }
+
+  // the thumbnails were resized while this one was loading, it'll be requested
+  // again on the next paint
+  if (t.available != makeGeometry().imageRect(0).size()) {
+    return;
+  }
+
+  f->setThumbnail(t);
+  ui->imagesThumbnails->update();
+}
+
 void ImagesTab::showTooltip(QHelpEvent* e)
 {
   const auto* f = fileAtPos(e->pos());
@@ -571,7 +610,7 @@ void ImagesTab::showTooltip(QHelpEvent* e)
 
   const auto s = QString("%1 (%2)")
                      .arg(QDir::toNativeSeparators(f->path()))
-                     .arg(dimensionString(f->original().size()));
+                     .arg(dimensionString(f->originalSize()));
 
   QToolTip::showText(e->globalPos(), s, ui->imagesThumbnails);
 }
@@ -901,7 +940,15 @@ void File::ensureOriginalLoaded()
                static_cast<int>(reader.error()));
 
     m_failed = true;
+    return;
   }
+
+  m_originalSize = m_original.size();
+}
+
+void File::releaseOriginal()
+{
+  m_original = {};
 }
 
 const QString& File::path() const
@@ -928,48 +975,40 @@ const QImage& File::thumbnail() const
   return m_thumbnail;
 }
 
-bool File::failed() const
+QSize File::originalSize() const
 {
-  return m_failed;
+  return m_originalSize;
 }
 
-void File::loadIfNeeded(const Geometry& geo)
+bool File::failed() const
 {
-  if (needsLoad(geo)) {
-    load(geo);
-  }
+  return m_failed;
 }
 
-bool File::needsLoad(const Geometry& geo) const
+bool File::needsThumbnail(const Geometry& geo) const
 {
   if (m_failed) {
     return false;
   }
 
-  if (m_original.isNull() || m_thumbnail.isNull()) {
-    return true;
-  }
-
-  const auto scaledSize = geo.scaledImageSize(m_original.size());
-  return (m_thumbnail.size() != scaledSize);
+  return (m_thumbnail.isNull() || m_thumbnailAvailable != geo.imageRect(0).size());
 }
 
-void File::load(const Geometry& geo)
+void File::setThumbnail(const ThumbnailLoader::Thumbnail& t)
 {
-  m_failed = false;
-  ensureOriginalLoaded();
+  m_thumbnailAvailable = t.available;
+
+  if (t.image.isNull()) {
+    m_failed = true;
 
-  if (m_failed) {
     QImage warning(":/MO/gui/warning");
-    const auto scaledSize = geo.scaledImageSize(warning.size());
+    const auto scaledSize = resizeWithAspectRatio(warning.size(), t.available);
 
     m_thumbnail =
         warning.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
   } else {
-    const auto scaledSize = geo.scaledImageSize(m_original.size());
-
-    m_thumbnail =
-        m_original.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    m_thumbnail    = t.image;
+    m_originalSize = t.originalSize;
   }
 }
 
@@ -978,6 +1017,7 @@ Files::Files() : m_selection(BadIndex), m_filtered(false) {}
 void Files::clear()
 {
   m_allFiles.clear();
+  m_indices.clear();
   m_filteredFiles.clear();
   m_selection = BadIndex;
   m_filtered  = false;
@@ -985,6 +1025,7 @@ void Files::clear()
 
 void Files::add(File f)
 {
+  m_indices.insert(f.path(), m_allFiles.size());
   m_allFiles.emplace_back(std::move(f));
 }
 
@@ -1062,6 +1103,16 @@ std::size_t Files::indexOf(const File* f) const
   return BadIndex;
 }
 
+File* Files::find(const QString& path)
+{
+  auto itor = m_indices.constFind(path);
+  if (itor == m_indices.constEnd()) {
+    return nullptr;
+  }
+
+  return &m_allFiles[*itor];
+}
+
 const File* Files::selectedFile() const
 {
   return get(m_selection);
@@ -5,6 +5,8 @@
 #include "modinfodialogtab.h"
 #include "organizercore.h"
 #include "plugincontainer.h"
+#include "thumbnailloader.h"
+#include <QHash>
 #include <QPainter>
 #include <QScrollBar>
 
@@ -233,24 +235,45 @@ class File
 public:
   File(QString path);
 
+  // decodes the full image, only needed for the selected file; thumbnails are
+  // loaded separately by the ThumbnailLoader
+  //
   void ensureOriginalLoaded();
 
+  // forgets the full image, once the file is not selected anymore
+  //
+  void releaseOriginal();
+
   const QString& path() const;
   const QString& filename() const;
   const QImage& original() const;
   const QImage& thumbnail() const;
+
+  // size of the full image, invalid until either the thumbnail or the full
+  // image has been loaded
+  //
+  QSize originalSize() const;
+
   bool failed() const;
 
-  void loadIfNeeded(const Geometry& geo);
+  // whether the thumbnail hasn't been loaded yet for the given geometry
+  //
+  bool needsThumbnail(const Geometry& geo) const;
+
+  // sets the thumbnail loaded for this file, shows a warning if it failed
+  //
+  void setThumbnail(const ThumbnailLoader::Thumbnail& t);
 
 private:
   QString m_path;
   mutable QString m_filename;
   QImage m_original, m_thumbnail;
-  bool m_failed;
+  QSize m_originalSize;
 
-  bool needsLoad(const Geometry& geo) const;
-  void load(const Geometry& geo);
+  // size the thumbnail had to fit in when it was loaded
+  QSize m_thumbnailAvailable;
+
+  bool m_failed;
 };
 
 class Files
@@ -273,6 +296,10 @@ public:
   File* get(std::size_t i);
   std::size_t indexOf(const File* f) const;
 
+  // file with the given path in all the files, null if not found
+  //
+  File* find(const QString& path);
+
   const File* selectedFile() const;
   File* selectedFile();
   std::size_t selectedIndex() const;
@@ -285,6 +312,9 @@ public:
 private:
   std::vector<File> m_allFiles;
   std::vector<File*> m_filteredFiles;
+
+  // index in m_allFiles by path
+  QHash<QString, std::size_t> m_indices;
   std::size_t m_selection;
   bool m_filtered;
 };
@@ -340,6 +370,7 @@ private:
   bool m_ddsAvailable, m_ddsEnabled;
   Theme m_theme;
   Metrics m_metrics;
+  ThumbnailLoader m_thumbnails;
 
   void getSupportedFormats();
   void enableDDS(bool b);
@@ -350,6 +381,7 @@ private:
   void thumbnailAreaWheelEvent(QWheelEvent* e);
   bool thumbnailAreaKeyPressEvent(QKeyEvent* e);
   void onScrolled();
+  void onThumbnailLoaded(const ThumbnailLoader::Thumbnail& t);
 
   void showTooltip(QHelpEvent* e);
   void onExplore();
@@ -28,9 +28,10 @@ static bool ByName(const ModInfo::Ptr& LHS, const ModInfo::Ptr& RHS)
 }
 }  // namespace
 
-ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
+ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core,
+                               std::shared_ptr<const ModMeta> meta)
     : ModInfoWithConflictInfo(core), m_Name(path.dirName()),
-      m_Path(path.absolutePath()), m_Repository(),
+      m_Path(path.absolutePath()), m_NexusDescriptionLoaded(false), m_Repository(),
       m_GameName(core.managedGame()->gameShortName()), m_MetaInfoChanged(false),
       m_IsAlternate(false), m_Converted(false), m_Validated(false),
       m_EndorsedState(EndorsedState::ENDORSED_UNKNOWN),
@@ -39,7 +40,11 @@ ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
 {
   m_CreationTime = QFileInfo(path.absolutePath()).birthTime();
   // read out the meta-file for information
-  readMeta();
+  if (meta) {
+    readMeta(*meta);
+  } else {
+    readMeta();
+  }
   if (m_GameName.compare(core.managedGame()->gameShortName(), Qt::CaseInsensitive) != 0)
     if (!core.managedGame()->primarySources().contains(m_GameName, Qt::CaseInsensitive))
       m_IsAlternate = true;
@@ -84,7 +89,11 @@ bool ModInfoRegular::isEmpty() const
 
 void ModInfoRegular::readMeta()
 {
-  QSettings metaFile(m_Path + "/meta.ini", QSettings::IniFormat);
+  readMeta(ModMeta::read(m_Path + "/meta.ini"));
+}
+
+void ModInfoRegular::readMeta(const ModMeta& metaFile)
+{
   m_Comments           = metaFile.value("comments", "").toString();
   m_Notes              = metaFile.value("notes", "").toString();
   QString tempGameName = metaFile.value("gameName", m_GameName).toString();
@@ -95,7 +104,6 @@ void ModInfoRegular::readMeta()
   m_NewestVersion    = metaFile.value("newestVersion", "").toString();
   m_IgnoredVersion   = metaFile.value("ignoredVersion", "").toString();
   m_InstallationFile = metaFile.value("installationFile", "").toString();
-  m_NexusDescription = metaFile.value("nexusDescription", "").toString();
   m_NexusFileStatus  = metaFile.value("nexusFileStatus", "1").toInt();
   m_NexusCategory    = metaFile.value("nexusCategory", 0).toInt();
   m_Author           = metaFile.value("author", "").toString();
@@ -224,107 +232,136 @@ void ModInfoRegular::readMeta()
     }
   }
 
-  int numFiles = metaFile.beginReadArray("installedFiles");
-  for (int i = 0; i < numFiles; ++i) {
-    metaFile.setArrayIndex(i);
-    m_InstalledFileIDs.emplace_back(metaFile.value("modid").toInt(),
-                                    metaFile.value("fileid").toInt());
+  // arrays written by QSettings are indexed from 1
+  int numFiles = metaFile.value("installedFiles/size", 0).toInt();
+  for (int i = 1; i <= numFiles; ++i) {
+    const QString prefix = QString("installedFiles/%1/").arg(i);
+    m_InstalledFileIDs.emplace_back(metaFile.value(prefix + "modid").toInt(),
+                                    metaFile.value(prefix + "fileid").toInt());
   }
-  metaFile.endArray();
 
-  // Plugin settings:
-  metaFile.beginGroup("Plugins");
-  for (auto pluginName : metaFile.childGroups()) {
-    metaFile.beginGroup(pluginName);
-    for (auto settingKey : metaFile.childKeys()) {
-      m_PluginSettings[pluginName][settingKey] = metaFile.value(settingKey);
+  // Plugin settings, keys are Plugins/<plugin>/<setting>:
+  for (auto&& [key, value] : metaFile.values.asKeyValueRange()) {
+    const auto parts = key.split('/');
+    if (parts.size() == 3 && parts[0] == "Plugins") {
+      m_PluginSettings[parts[1]][parts[2]] = value;
     }
-    metaFile.endGroup();
   }
-  metaFile.endGroup();
+
+  m_NexusDescription.clear();
+  m_NexusDescriptionLoaded = false;
 
   m_MetaInfoChanged = false;
 }
 
+void ModInfoRegular::loadNexusDescription() const
+{
+  if (!m_NexusDescriptionLoaded) {
+    m_NexusDescription       = ModMeta::readDescription(m_Path + "/meta.ini");
+    m_NexusDescriptionLoaded = true;
+  }
+}
+
 void ModInfoRegular::saveMeta()
+{
+  ModMetaWriter::instance().save(this);
+}
+
+void ModInfoRegular::metaChanged()
+{
+  m_MetaInfoChanged = true;
+  ++m_MetaGeneration;
+
+  // a mod that's still being created isn't owned yet, it's written with its
+  // next change or when it's destroyed
+  if (auto self = sharedFromThis()) {
+    ModMetaWriter::instance().queue(std::move(self));
+  }
+}
+
+void ModInfoRegular::metaWritten(std::uint64_t generation)
+{
+  if (generation == m_MetaGeneration) {
+    m_MetaInfoChanged = false;
+  }
+}
+
+std::optional<ModMetaWriter::Snapshot> ModInfoRegular::takeMetaSnapshot()
 {
   // only write meta data if the mod directory exists
-  if (m_MetaInfoChanged && QFile::exists(absolutePath())) {
-    QSettings metaFile(absolutePath().append("/meta.ini"), QSettings::IniFormat);
-    if (metaFile.status() == QSettings::NoError) {
-      std::set<int> temp = m_Categories;
-      temp.erase(m_PrimaryCategory);
-      metaFile.setValue("category", QString("%1").arg(m_PrimaryCategory) + "," +
-                                        SetJoin(temp, ","));
-      metaFile.setValue("newestVersion", m_NewestVersion.canonicalString());
-      metaFile.setValue("ignoredVersion", m_IgnoredVersion.canonicalString());
-      metaFile.setValue("version", m_Version.canonicalString());
-      metaFile.setValue("installationFile", m_InstallationFile);
-      metaFile.setValue("repository", m_Repository);
-      metaFile.setValue("gameName", m_GameName);
-      metaFile.setValue("modid", m_NexusID);
-      metaFile.setValue("comments", m_Comments);
-      metaFile.setValue("notes", m_Notes);
-      metaFile.setValue("nexusDescription", m_NexusDescription);
-      metaFile.setValue("url", m_CustomURL);
-      metaFile.setValue("hasCustomURL", m_HasCustomURL);
-      metaFile.setValue("nexusFileStatus", m_NexusFileStatus);
-      metaFile.setValue("lastNexusQuery", m_LastNexusQuery.toString(Qt::ISODate));
-      metaFile.setValue("lastNexusUpdate", m_LastNexusUpdate.toString(Qt::ISODate));
-      metaFile.setValue("nexusLastModified", m_NexusLastModified.toString(Qt::ISODate));
-      metaFile.setValue("nexusCategory", m_NexusCategory);
-      metaFile.setValue("author", m_Author);
-      metaFile.setValue("uploader", m_Uploader);
-      metaFile.setValue("uploaderUrl", m_UploaderUrl);
-      metaFile.setValue("converted", m_Converted);
-      metaFile.setValue("validated", m_Validated);
-      metaFile.setValue("color", m_Color);
-      if (m_EndorsedState != EndorsedState::ENDORSED_UNKNOWN) {
-        metaFile.setValue(
-            "endorsed",
-            static_cast<std::underlying_type_t<EndorsedState>>(m_EndorsedState));
-      }
-      if (m_TrackedState != TrackedState::TRACKED_UNKNOWN) {
-        metaFile.setValue("tracked", static_cast<std::underlying_type_t<TrackedState>>(
-                                         m_TrackedState));
-      }
+  if (!m_MetaInfoChanged || !QFile::exists(absolutePath())) {
+    return {};
+  }
 
-      metaFile.remove("installedFiles");
-      metaFile.beginWriteArray("installedFiles");
-      int idx = 0;
-      for (auto iter = m_InstalledFileIDs.begin(); iter != m_InstalledFileIDs.end();
-           ++iter) {
-        metaFile.setArrayIndex(idx++);
-        metaFile.setValue("modid", iter->first);
-        metaFile.setValue("fileid", iter->second);
-      }
-      metaFile.endArray();
-
-      // Plugin settings:
-      metaFile.remove("Plugins");
-      metaFile.beginGroup("Plugins");
-      for (const auto& [pluginName, pluginSettings] : m_PluginSettings) {
-        metaFile.beginGroup(pluginName);
-        for (const auto& [settingName, settingValue] : pluginSettings) {
-          metaFile.setValue(settingName, settingValue);
-        }
-        metaFile.endGroup();
-      }
-      metaFile.endGroup();
+  ModMetaWriter::Snapshot s;
+  s.path       = absolutePath().append("/meta.ini");
+  s.generation = m_MetaGeneration;
+
+  auto set = [&](const QString& key, const QVariant& value) {
+    s.values.emplace_back(key, value);
+  };
+
+  std::set<int> temp = m_Categories;
+  temp.erase(m_PrimaryCategory);
+  set("category", QString("%1").arg(m_PrimaryCategory) + "," + SetJoin(temp, ","));
+  set("newestVersion", m_NewestVersion.canonicalString());
+  set("ignoredVersion", m_IgnoredVersion.canonicalString());
+  set("version", m_Version.canonicalString());
+  set("installationFile", m_InstallationFile);
+  set("repository", m_Repository);
+  set("gameName", m_GameName);
+  set("modid", m_NexusID);
+  set("comments", m_Comments);
+  set("notes", m_Notes);
+
+  // the description is kept as it is in the file if it was never loaded
+  if (m_NexusDescriptionLoaded) {
+    set("nexusDescription", m_NexusDescription);
+  }
+
+  set("url", m_CustomURL);
+  set("hasCustomURL", m_HasCustomURL);
+  set("nexusFileStatus", m_NexusFileStatus);
+  set("lastNexusQuery", m_LastNexusQuery.toString(Qt::ISODate));
+  set("lastNexusUpdate", m_LastNexusUpdate.toString(Qt::ISODate));
+  set("nexusLastModified", m_NexusLastModified.toString(Qt::ISODate));
+  set("nexusCategory", m_NexusCategory);
+  set("author", m_Author);
+  set("uploader", m_Uploader);
+  set("uploaderUrl", m_UploaderUrl);
+  set("converted", m_Converted);
+  set("validated", m_Validated);
+  set("color", m_Color);
+  if (m_EndorsedState != EndorsedState::ENDORSED_UNKNOWN) {
+    set("endorsed",
+        static_cast<std::underlying_type_t<EndorsedState>>(m_EndorsedState));
+  }
+  if (m_TrackedState != TrackedState::TRACKED_UNKNOWN) {
+    set("tracked", static_cast<std::underlying_type_t<TrackedState>>(m_TrackedState));
+  }
 
-      metaFile.sync();  // sync needs to be called to ensure the file is created
+  // same keys as QSettings::beginWriteArray(), indices start at 1
+  s.removedGroups.append("installedFiles");
+  int idx = 0;
+  for (auto iter = m_InstalledFileIDs.begin(); iter != m_InstalledFileIDs.end();
+       ++iter) {
+    ++idx;
+    set(QString("installedFiles/%1/modid").arg(idx), iter->first);
+    set(QString("installedFiles/%1/fileid").arg(idx), iter->second);
+  }
+  if (idx > 0) {
+    set("installedFiles/size", idx);
+  }
 
-      if (metaFile.status() == QSettings::NoError) {
-        m_MetaInfoChanged = false;
-      } else {
-        log::error("failed to write {}/meta.ini: error {}", absolutePath(),
-                   metaFile.status());
-      }
-    } else {
-      log::error("failed to write {}/meta.ini: error {}", absolutePath(),
-                 metaFile.status());
+  // Plugin settings:
+  s.removedGroups.append("Plugins");
+  for (const auto& [pluginName, pluginSettings] : m_PluginSettings) {
+    for (const auto& [settingName, settingValue] : pluginSettings) {
+      set("Plugins/" + pluginName + "/" + settingName, settingValue);
     }
   }
+
+  return s;
 }
 
 bool ModInfoRegular::updateAvailable() const
@@ -366,8 +403,7 @@ void ModInfoRegular::nxmDescriptionAvailable(QString, int, QVariant,
   m_LastNexusQuery = QDateTime::currentDateTimeUtc();
   m_NexusLastModified =
       QDateTime::fromSecsSinceEpoch(result["updated_timestamp"].toInt(), Qt::UTC);
-  m_MetaInfoChanged = true;
-  saveMeta();
+  metaChanged();
   disconnect(sender(), SIGNAL(descriptionAvailable(QString, int, QVariant, QVariant)));
   emit modDetailsUpdated(true);
 }
@@ -386,7 +422,6 @@ void ModInfoRegular::nxmEndorsementToggled(QString, int, QVariant, QVariant resu
       } else {
         mod->setIsEndorsed(false);
       }
-      mod->saveMeta();
     }
   }
   emit modDetailsUpdated(true);
@@ -399,7 +434,6 @@ void ModInfoRegular::nxmTrackingToggled(QString, int, QVariant, bool tracked)
     if (mod->gameName().compare(m_GameName, Qt::CaseInsensitive) == 0 &&
         mod->nexusId() == m_NexusID) {
       mod->setIsTracked(tracked);
-      mod->saveMeta();
     }
   }
   emit modDetailsUpdated(true);
@@ -445,7 +479,7 @@ bool ModInfoRegular::needsDescriptionUpdate() const
 
 void ModInfoRegular::setCategory(int categoryID, bool active)
 {
-  m_MetaInfoChanged = true;
+  metaChanged();
 
   if (active) {
     m_Categories.insert(categoryID);
@@ -523,70 +557,72 @@ bool ModInfoRegular::setName(const QString& name)
 
 void ModInfoRegular::setComments(const QString& comments)
 {
-  m_Comments        = comments;
-  m_MetaInfoChanged = true;
+  m_Comments = comments;
+  metaChanged();
 }
 
 void ModInfoRegular::setNotes(const QString& notes)
 {
-  m_Notes           = notes;
-  m_MetaInfoChanged = true;
+  m_Notes = notes;
+  metaChanged();
 }
 
 void ModInfoRegular::setGameName(const QString& gameName)
 {
-  m_GameName        = gameName;
-  m_MetaInfoChanged = true;
+  m_GameName = gameName;
+  metaChanged();
 }
 
 void ModInfoRegular::setNexusID(int modID)
 {
-  m_NexusID         = modID;
-  m_MetaInfoChanged = true;
+  m_NexusID = modID;
+  metaChanged();
 }
 
 void ModInfoRegular::setVersion(const VersionInfo& version)
 {
-  m_Version         = version;
-  m_MetaInfoChanged = true;
+  m_Version = version;
+  metaChanged();
 }
 
 void ModInfoRegular::setNewestVersion(const VersionInfo& version)
 {
   if (version != m_NewestVersion) {
-    m_NewestVersion   = version;
-    m_MetaInfoChanged = true;
+    m_NewestVersion = version;
+    metaChanged();
   }
 }
 
 void ModInfoRegular::setNexusDescription(const QString& description)
 {
+  loadNexusDescription();
+
   if (qHash(description) != qHash(m_NexusDescription)) {
     m_NexusDescription = description;
-    m_MetaInfoChanged  = true;
+    metaChanged();
   }
 }
 
 void ModInfoRegular::setEndorsedState(EndorsedState endorsedState)
 {
   if (endorsedState != m_EndorsedState) {
-    m_EndorsedState   = endorsedState;
-    m_MetaInfoChanged = true;
+    m_EndorsedState = endorsedState;
+    metaChanged();
   }
 }
 
 void ModInfoRegular::setTrackedState(TrackedState trackedState)
 {
   if (trackedState != m_TrackedState) {
-    m_TrackedState    = trackedState;
-    m_MetaInfoChanged = true;
+    m_TrackedState = trackedState;
+    metaChanged();
   }
 }
 
 void ModInfoRegular::setInstallationFile(const QString& fileName)
 {
   m_InstallationFile = fileName;
-  m_MetaInfoChanged  = true;
+  metaChanged();
 }
 
 void ModInfoRegular::addNexusCategory(int categoryID)
@@ -598,27 +634,27 @@ void ModInfoRegular::setIsEndorsed(bool endorsed)
 {
   m_EndorsedState =
       endorsed ? EndorsedState::ENDORSED_TRUE : EndorsedState::ENDORSED_FALSE;
-  m_MetaInfoChanged = true;
+  metaChanged();
 }
 
 void ModInfoRegular::setNeverEndorse()
 {
-  m_EndorsedState   = EndorsedState::ENDORSED_NEVER;
-  m_MetaInfoChanged = true;
+  m_EndorsedState = EndorsedState::ENDORSED_NEVER;
+  metaChanged();
 }
 
 void ModInfoRegular::setIsTracked(bool tracked)
 {
   if (tracked != (m_TrackedState == TrackedState::TRACKED_TRUE)) {
     m_TrackedState = tracked ? TrackedState::TRACKED_TRUE : TrackedState::TRACKED_FALSE;
-    m_MetaInfoChanged = true;
+    metaChanged();
   }
 }
 
 void ModInfoRegular::setColor(QColor color)
 {
-  m_Color           = color;
-  m_MetaInfoChanged = true;
+  m_Color = color;
+  metaChanged();
 }
 
 QColor ModInfoRegular::color() const
@@ -643,17 +679,15 @@ void ModInfoRegular::track(bool doTrack)
 
 void ModInfoRegular::markConverted(bool converted)
 {
-  m_Converted       = converted;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_Converted = converted;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
 void ModInfoRegular::markValidated(bool validated)
 {
-  m_Validated       = validated;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_Validated = validated;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -669,7 +703,7 @@ void ModInfoRegular::ignoreUpdate(bool ignore)
   } else {
     m_IgnoredVersion.clear();
   }
-  m_MetaInfoChanged = true;
+  metaChanged();
 }
 
 bool ModInfoRegular::canBeUpdated() const
@@ -773,8 +807,7 @@ int ModInfoRegular::getNexusFileStatus() const
 void ModInfoRegular::setNexusFileStatus(int status)
 {
   m_NexusFileStatus = status;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -795,6 +828,7 @@ QDateTime ModInfoRegular::creationTime() const
 
 QString ModInfoRegular::getNexusDescription() const
 {
+  loadNexusDescription();
   return m_NexusDescription;
 }
 
@@ -821,8 +855,7 @@ QDateTime ModInfoRegular::getLastNexusUpdate() const
 void ModInfoRegular::setLastNexusUpdate(QDateTime time)
 {
   m_LastNexusUpdate = time;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -833,9 +866,8 @@ QDateTime ModInfoRegular::getLastNexusQuery() const
 
 void ModInfoRegular::setLastNexusQuery(QDateTime time)
 {
-  m_LastNexusQuery  = time;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_LastNexusQuery = time;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -847,8 +879,7 @@ QDateTime ModInfoRegular::getNexusLastModified() const
 void ModInfoRegular::setNexusLastModified(QDateTime time)
 {
   m_NexusLastModified = time;
-  m_MetaInfoChanged   = true;
-  saveMeta();
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -859,9 +890,8 @@ int ModInfoRegular::getNexusCategory() const
 
 void ModInfoRegular::setNexusCategory(int category)
 {
-  m_NexusCategory   = category;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_NexusCategory = category;
+  metaChanged();
 }
 
 QString ModInfoRegular::author() const
@@ -871,9 +901,8 @@ QString ModInfoRegular::author() const
 
 void ModInfoRegular::setAuthor(const QString& author)
 {
-  m_Author          = author;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_Author = author;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -884,9 +913,8 @@ QString ModInfoRegular::uploader() const
 
 void ModInfoRegular::setUploader(const QString& uploader)
 {
-  m_Uploader        = uploader;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_Uploader = uploader;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
@@ -897,16 +925,15 @@ QString ModInfoRegular::uploaderUrl() const
 
 void ModInfoRegular::setUploaderUrl(const QString& uploaderUrl)
 {
-  m_UploaderUrl     = uploaderUrl;
-  m_MetaInfoChanged = true;
-  saveMeta();
+  m_UploaderUrl = uploaderUrl;
+  metaChanged();
   emit modDetailsUpdated(true);
 }
 
 void ModInfoRegular::setCustomURL(QString const& url)
 {
-  m_CustomURL       = url;
-  m_MetaInfoChanged = true;
+  m_CustomURL = url;
+  metaChanged();
 }
 
 QString ModInfoRegular::url() const
@@ -916,8 +943,8 @@ QString ModInfoRegular::url() const
 
 void ModInfoRegular::setHasCustomURL(bool b)
 {
-  m_HasCustomURL    = b;
-  m_MetaInfoChanged = true;
+  m_HasCustomURL = b;
+  metaChanged();
 }
 
 bool ModInfoRegular::hasCustomURL() const
@@ -948,7 +975,7 @@ void ModInfoRegular::addInstalledFile(int modId, int fileId)
     m_InstalledFileIDs.erase(existing);
   }
   m_InstalledFileIDs.push_back(entry);
-  m_MetaInfoChanged = true;
+  metaChanged();
 }
 
 std::vector<QString> ModInfoRegular::getIniTweaks() const
@@ -1005,8 +1032,7 @@ bool ModInfoRegular::setPluginSetting(const QString& pluginName, const QString&
                                       const QVariant& value)
 {
   m_PluginSettings[pluginName][key] = value;
-  m_MetaInfoChanged                 = true;
-  saveMeta();
+  metaChanged();
   return true;
 }
 
@@ -1019,6 +1045,6 @@ ModInfoRegular::clearPluginSettings(const QString& pluginName)
   }
   auto settings = itp->second;
   m_PluginSettings.erase(itp);
-  saveMeta();
+  metaChanged();
   return settings;
 }
@@ -5,6 +5,8 @@
 #include <optional>
 
 #include "modinfowithconflictinfo.h"
+#include "modmetacache.h"
+#include "modmetawriter.h"
 #include "nexusinterface.h"
 
 /**
@@ -20,6 +22,7 @@ class ModInfoRegular : public ModInfoWithConflictInfo
   Q_OBJECT
 
   friend class ModInfo;
+  friend class ModMetaWriter;
 
 public:
   ~ModInfoRegular();
@@ -171,7 +174,7 @@ public:
   virtual void setPrimaryCategory(int categoryID) override
   {
     m_PrimaryCategory = categoryID;
-    m_MetaInfoChanged = true;
+    metaChanged();
   }
 
   /**
@@ -429,7 +432,8 @@ public:
   virtual void addInstalledFile(int modId, int fileId) override;
 
   /**
-   * @brief stores meta information back to disk
+   * @brief stores meta information back to disk now, changes are otherwise
+   * written in the background by ModMetaWriter
    */
   virtual void saveMeta() override;
 
@@ -477,6 +481,20 @@ private:
   void setEndorsedState(MOBase::EndorsedState endorsedState);
   void setTrackedState(MOBase::TrackedState trackedState);
 
+  // flags the meta information as changed and queues the mod in ModMetaWriter
+  //
+  void metaChanged();
+
+  // values to write to meta.ini, nothing if the meta information hasn't
+  // changed or if the mod directory doesn't exist
+  //
+  std::optional<ModMetaWriter::Snapshot> takeMetaSnapshot();
+
+  // called once the values of the given snapshot have been written, clears
+  // the changed flag unless the mod changed again since the snapshot
+  //
+  void metaWritten(std::uint64_t generation);
+
 private slots:
 
   void nxmDescriptionAvailable(QString, int modID, QVariant userData,
@@ -489,7 +507,10 @@ private slots:
 protected:
   virtual std::set<int> doGetContents() const override;
 
-  ModInfoRegular(const QDir& path, OrganizerCore& core);
+  // reads the meta.ini of the mod if `meta` is null
+  //
+  ModInfoRegular(const QDir& path, OrganizerCore& core,
+                 std::shared_ptr<const ModMeta> meta);
 
 private:
   QString m_Name;
@@ -497,7 +518,11 @@ private:
   QString m_InstallationFile;
   QString m_Comments;
   QString m_Notes;
-  QString m_NexusDescription;
+
+  // the description is only read from meta.ini when it's first needed
+  mutable QString m_NexusDescription;
+  mutable bool m_NexusDescriptionLoaded;
+
   QString m_Repository;
   QString m_CustomURL;
   bool m_HasCustomURL;
@@ -527,6 +552,10 @@ private:
   std::map<QString, std::map<QString, QVariant>> m_PluginSettings;
 
   bool m_MetaInfoChanged;
+
+  // incremented on every change, see metaWritten()
+  std::uint64_t m_MetaGeneration = 0;
+
   bool m_IsAlternate;
   bool m_Converted;
   bool m_Validated;
@@ -540,6 +569,9 @@ private:
   NexusBridge m_NexusBridge;
 
   bool needsDescriptionUpdate() const;
+
+  void readMeta(const ModMeta& metaFile);
+  void loadNexusDescription() const;
 };
 
 #endif  // MODINFOREGULAR_H
@@ -62,7 +62,8 @@ protected:
   virtual bool doIsValid() const override { return true; }
 
 private:
-  ModInfoSeparator(const QDir& path, OrganizerCore& core);
+  ModInfoSeparator(const QDir& path, OrganizerCore& core,
+                   std::shared_ptr<const ModMeta> meta);
 };
 
 #endif
@@ -5,7 +5,9 @@
 #include "utility.h"
 #include <filesystem>
 
+#include "directoryrefresher.h"
 #include "iplugingame.h"
+#include "listingfiletree.h"
 #include "moddatachecker.h"
 #include "organizercore.h"
 #include "qdirfiletree.h"
@@ -16,7 +18,7 @@ namespace fs = std::filesystem;
 
 ModInfoWithConflictInfo::ModInfoWithConflictInfo(OrganizerCore& core)
     : ModInfo(core), m_FileTree([this]() {
-        return QDirFileTree::makeTree(absolutePath());
+        return makeFileTree();
       }),
       m_Valid([this]() {
         return doIsValid();
@@ -47,43 +49,43 @@ std::vector<ModInfo::EConflictFlag> ModInfoWithConflictInfo::getConflictFlags()
 {
   std::vector<ModInfo::EConflictFlag> result;
   switch (isConflicted()) {
-  case CONFLICT_MIXED: {
+  case ModConflicts::CONFLICT_MIXED: {
     result.push_back(ModInfo::FLAG_CONFLICT_MIXED);
   } break;
-  case CONFLICT_OVERWRITE: {
+  case ModConflicts::CONFLICT_OVERWRITE: {
     result.push_back(ModInfo::FLAG_CONFLICT_OVERWRITE);
   } break;
-  case CONFLICT_OVERWRITTEN: {
+  case ModConflicts::CONFLICT_OVERWRITTEN: {
     result.push_back(ModInfo::FLAG_CONFLICT_OVERWRITTEN);
   } break;
-  case CONFLICT_REDUNDANT: {
+  case ModConflicts::CONFLICT_REDUNDANT: {
     result.push_back(ModInfo::FLAG_CONFLICT_REDUNDANT);
   } break;
   default: { /* NOP */
   }
   }
   switch (isLooseArchiveConflicted()) {
-  case CONFLICT_MIXED: {
+  case ModConflicts::CONFLICT_MIXED: {
     result.push_back(ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITE);
     result.push_back(ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITTEN);
   } break;
-  case CONFLICT_OVERWRITE: {
+  case ModConflicts::CONFLICT_OVERWRITE: {
     result.push_back(ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITE);
   } break;
-  case CONFLICT_OVERWRITTEN: {
+  case ModConflicts::CONFLICT_OVERWRITTEN: {
     result.push_back(ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITTEN);
   } break;
   default: { /* NOP */
   }
   }
   switch (isArchiveConflicted()) {
-  case CONFLICT_MIXED: {
+  case ModConflicts::CONFLICT_MIXED: {
     result.push_back(ModInfo::FLAG_ARCHIVE_CONFLICT_MIXED);
   } break;
-  case CONFLICT_OVERWRITE: {
+  case ModConflicts::CONFLICT_OVERWRITE: {
     result.push_back(ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITE);
   } break;
-  case CONFLICT_OVERWRITTEN: {
+  case ModConflicts::CONFLICT_OVERWRITTEN: {
     result.push_back(ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITTEN);
   } break;
   default: { /* NOP */
@@ -92,184 +94,34 @@ std::vector<ModInfo::EConflictFlag> ModInfoWithConflictInfo::getConflictFlags()
   return result;
 }
 
-ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() const
+std::shared_ptr<const ModConflicts::Entry>
+ModInfoWithConflictInfo::doConflictCheck() const
 {
-  Conflicts conflicts;
+  auto all = m_Core.modConflicts();
 
-  bool providesAnything = false;
-  bool hasHiddenFiles   = false;
-  bool hasVisibleFiles  = false;
-
-  std::vector<int> dataIDs;
-  if (m_Core.directoryStructure()->originExists("data")) {
-    dataIDs.push_back(m_Core.directoryStructure()->getOriginByName("data").getID());
-  }
-  for (const auto& origin : m_Core.managedGame()->secondaryDataDirectories().keys()) {
-    if (m_Core.directoryStructure()->originExists(origin)) {
-      dataIDs.push_back(m_Core.directoryStructure()->getOriginByName(origin).getID());
-    }
+  if (const auto* e = all->find(name())) {
+    // shares the ownership of the results of all the mods
+    return std::shared_ptr<const ModConflicts::Entry>(std::move(all), e);
   }
 
-  QString name = this->name();
-
-  if (m_Core.directoryStructure()->originExists(name)) {
-    FilesOrigin& origin = m_Core.directoryStructure()->getOriginByName(name);
-    std::vector<FileEntryPtr> files = origin.getFiles();
-    std::set<const DirectoryEntry*> checkedDirs;
-
-    // for all files in this origin
-    for (FileEntryPtr file : files) {
-      if (file->getName().endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-        hasHiddenFiles = true;
-        // skip hidden file conflicts
-        continue;
-      } else {
-        const DirectoryEntry* parent = file->getParent();
-        auto hidden                  = false;
-
-        // iterate on all parent directory entries to check for .mohiddden
-        while (parent != nullptr) {
-          auto insertResult = checkedDirs.insert(parent);
-
-          if (insertResult.second == false) {
-            // if already present break as we can assume to have checked the parents as
-            // well
-            break;
-          } else {
-            if (parent->getName().endsWith(ModInfo::s_HiddenExt, Qt::CaseInsensitive)) {
-              hasHiddenFiles = hidden = true;
-              break;
-            }
-            parent = parent->getParent();
-          }
-        }
-        if (hidden) {
-          // skip hidden file conflicts
-          continue;
-        }
-      }
-
-      hasVisibleFiles   = true;
-      auto alternatives = file->getAlternatives();
-      if ((alternatives.size() == 0) ||
-          std::ranges::find(dataIDs, alternatives.back().originID()) != dataIDs.end()) {
-        // no alternatives -> no conflict
-        providesAnything = true;
-      } else {
-        // Get the archive data for the current mod
-        DataArchiveOrigin archiveData;
-        if (file->getOrigin() == origin.getID())
-          archiveData = file->getArchive();
-        else {
-          for (const auto& alt : alternatives) {
-            if (alt.originID() == origin.getID()) {
-              archiveData = alt.archive();
-              break;
-            }
-          }
-        }
-
-        // If this is not the origin then determine the correct overwrite
-        if (file->getOrigin() != origin.getID()) {
-          FilesOrigin& altOrigin =
-              m_Core.directoryStructure()->getOriginByID(file->getOrigin());
-          unsigned int altIndex = ModInfo::getIndex(altOrigin.getName());
-          if (!file->isFromArchive()) {
-            if (!archiveData.isValid())
-              conflicts.m_OverwrittenList.insert(altIndex);
-            else
-              conflicts.m_ArchiveLooseOverwrittenList.insert(altIndex);
-          } else {
-            conflicts.m_ArchiveOverwrittenList.insert(altIndex);
-          }
-        } else {
-          providesAnything = true;
-        }
-
-        // Sort out the alternatives
-        for (const auto& altInfo : alternatives) {
-          if (!(std::ranges::find(dataIDs, alternatives.back().originID()) !=
-                dataIDs.end()) &&
-              (altInfo.originID() != origin.getID())) {
-            FilesOrigin& altOrigin =
-                m_Core.directoryStructure()->getOriginByID(altInfo.originID());
-            QString altOriginName = altOrigin.getName();
-            unsigned int altIndex = ModInfo::getIndex(altOriginName);
-            if (!altInfo.isFromArchive()) {
-              if (!archiveData.isValid()) {
-                if (origin.getPriority() > altOrigin.getPriority()) {
-                  conflicts.m_OverwriteList.insert(altIndex);
-                } else {
-                  conflicts.m_OverwrittenList.insert(altIndex);
-                }
-              } else {
-                conflicts.m_ArchiveLooseOverwrittenList.insert(altIndex);
-              }
-            } else {
-              if (!archiveData.isValid()) {
-                conflicts.m_ArchiveLooseOverwriteList.insert(altIndex);
-              } else {
-                if (archiveData.order() > altInfo.archive().order()) {
-                  conflicts.m_ArchiveOverwriteList.insert(altIndex);
-                } else if (archiveData.order() < altInfo.archive().order()) {
-                  conflicts.m_ArchiveOverwrittenList.insert(altIndex);
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-
-    if (files.size() != 0) {
-      if (hasVisibleFiles && !providesAnything)
-        conflicts.m_CurrentConflictState = CONFLICT_REDUNDANT;
-      else if (!conflicts.m_OverwriteList.empty() &&
-               !conflicts.m_OverwrittenList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_MIXED;
-      else if (!conflicts.m_OverwriteList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_OVERWRITE;
-      else if (!conflicts.m_OverwrittenList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_OVERWRITTEN;
-
-      if (!conflicts.m_ArchiveOverwriteList.empty() &&
-          !conflicts.m_ArchiveOverwrittenList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_MIXED;
-      else if (!conflicts.m_ArchiveOverwriteList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITE;
-      else if (!conflicts.m_ArchiveOverwrittenList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITTEN;
-
-      if (!conflicts.m_ArchiveLooseOverwrittenList.empty() &&
-          !conflicts.m_ArchiveLooseOverwriteList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_MIXED;
-      else if (!conflicts.m_ArchiveLooseOverwrittenList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITTEN;
-      else if (!conflicts.m_ArchiveLooseOverwriteList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITE;
-
-      conflicts.m_HasHiddenFiles = hasHiddenFiles;
-    }
-  }
-
-  return conflicts;
+  return std::make_shared<ModConflicts::Entry>();
 }
 
 ModInfoWithConflictInfo::EConflictType ModInfoWithConflictInfo::isConflicted() const
 {
-  return m_Conflicts.value().m_CurrentConflictState;
+  return m_Conflicts.value()->m_CurrentConflictState;
 }
 
 ModInfoWithConflictInfo::EConflictType
 ModInfoWithConflictInfo::isArchiveConflicted() const
 {
-  return m_Conflicts.value().m_ArchiveConflictState;
+  return m_Conflicts.value()->m_ArchiveConflictState;
 }
 
 ModInfoWithConflictInfo::EConflictType
 ModInfoWithConflictInfo::isLooseArchiveConflicted() const
 {
-  return m_Conflicts.value().m_ArchiveConflictLooseState;
+  return m_Conflicts.value()->m_ArchiveConflictLooseState;
 }
 
 bool ModInfoWithConflictInfo::isRedundant() const
@@ -292,7 +144,7 @@ bool ModInfoWithConflictInfo::isRedundant() const
 
 bool ModInfoWithConflictInfo::hasHiddenFiles() const
 {
-  return m_Conflicts.value().m_HasHiddenFiles;
+  return m_Conflicts.value()->m_HasHiddenFiles;
 }
 
 void ModInfoWithConflictInfo::diskContentModified()
@@ -305,7 +157,8 @@ void ModInfoWithConflictInfo::diskContentModified()
 void ModInfoWithConflictInfo::prefetch()
 {
   // Populating the tree to 1-depth (IFileTree is lazy, so size() forces the
-  // tree to populate the first level):
+  // tree to populate the first level); this walks the whole mod, or checks that
+  // the snapshot is still up to date, and the refresher reuses the listing
   fileTree()->size();
 }
 
@@ -326,6 +179,27 @@ std::shared_ptr<const IFileTree> ModInfoWithConflictInfo::fileTree() const
   return m_FileTree.value();
 }
 
+std::shared_ptr<const IFileTree> ModInfoWithConflictInfo::makeFileTree() const
+{
+  const QString path = absolutePath();
+
+  // the refresher walks the same directory when the mod is active, so the
+  // listing is shared with it instead of walking the mod twice; foreign mods
+  // live in the data directory and the refresher only walks the data
+  // subdirectory of mods for some games, so these still go through QDir
+  if ((isRegular() || isOverwrite()) &&
+      m_Core.managedGame()->modDataDirectory().isEmpty()) {
+    try {
+      auto listing = m_Core.directoryRefresher()->listing(internalName(), path);
+      return ListingFileTree::makeTree(QDir(path).dirName(), std::move(listing));
+    } catch (const std::exception& e) {
+      log::warn("failed to list mod '{}', {}", internalName(), e.what());
+    }
+  }
+
+  return QDirFileTree::makeTree(path);
+}
+
 bool ModInfoWithConflictInfo::isValid() const
 {
   return m_Valid.value();
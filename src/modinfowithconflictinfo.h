@@ -4,6 +4,7 @@
 #include <ifiletree.h>
 
 #include "memoizedlock.h"
+#include "modconflicts.h"
 #include "modinfo.h"
 
 #include <QTime>
@@ -53,29 +54,29 @@ public:
    */
   void clearCaches() override;
 
-  const std::set<unsigned int>& getModOverwrite() const override
+  const std::vector<unsigned int>& getModOverwrite() const override
   {
-    return m_Conflicts.value().m_OverwriteList;
+    return m_Conflicts.value()->m_OverwriteList;
   }
-  const std::set<unsigned int>& getModOverwritten() const override
+  const std::vector<unsigned int>& getModOverwritten() const override
   {
-    return m_Conflicts.value().m_OverwrittenList;
+    return m_Conflicts.value()->m_OverwrittenList;
   }
-  const std::set<unsigned int>& getModArchiveOverwrite() const override
+  const std::vector<unsigned int>& getModArchiveOverwrite() const override
   {
-    return m_Conflicts.value().m_ArchiveOverwriteList;
+    return m_Conflicts.value()->m_ArchiveOverwriteList;
   }
-  const std::set<unsigned int>& getModArchiveOverwritten() const override
+  const std::vector<unsigned int>& getModArchiveOverwritten() const override
   {
-    return m_Conflicts.value().m_ArchiveOverwrittenList;
+    return m_Conflicts.value()->m_ArchiveOverwrittenList;
   }
-  const std::set<unsigned int>& getModArchiveLooseOverwrite() const override
+  const std::vector<unsigned int>& getModArchiveLooseOverwrite() const override
   {
-    return m_Conflicts.value().m_ArchiveLooseOverwriteList;
+    return m_Conflicts.value()->m_ArchiveLooseOverwriteList;
   }
-  const std::set<unsigned int>& getModArchiveLooseOverwritten() const override
+  const std::vector<unsigned int>& getModArchiveLooseOverwritten() const override
   {
-    return m_Conflicts.value().m_ArchiveLooseOverwrittenList;
+    return m_Conflicts.value()->m_ArchiveLooseOverwrittenList;
   }
 
 public slots:
@@ -100,15 +101,7 @@ protected:
   ModInfoWithConflictInfo(OrganizerCore& core);
 
 private:
-  enum EConflictType
-  {
-    CONFLICT_NONE,
-    CONFLICT_OVERWRITE,
-    CONFLICT_OVERWRITTEN,
-    CONFLICT_MIXED,
-    CONFLICT_REDUNDANT,
-    CONFLICT_CROSS
-  };
+  using EConflictType = ModConflicts::EConflictType;
 
 private:
   /**
@@ -144,34 +137,18 @@ protected:
   virtual void prefetch() override;
 
 private:
-  struct Conflicts
-  {
-    EConflictType m_CurrentConflictState      = CONFLICT_NONE;
-    EConflictType m_ArchiveConflictState      = CONFLICT_NONE;
-    EConflictType m_ArchiveConflictLooseState = CONFLICT_NONE;
-    bool m_HasLooseOverwrite                  = false;
-    bool m_HasHiddenFiles                     = false;
-
-    std::set<unsigned int> m_OverwriteList;    // indices of mods overritten by this mod
-    std::set<unsigned int> m_OverwrittenList;  // indices of mods overwriting this mod
-    std::set<unsigned int> m_ArchiveOverwriteList;    // indices of mods with archive
-                                                      // files overritten by this mod
-    std::set<unsigned int> m_ArchiveOverwrittenList;  // indices of mods with archive
-                                                      // files overwriting this mod
-    std::set<unsigned int>
-        m_ArchiveLooseOverwriteList;  // indices of mods with archives being overwritten
-                                      // by this mod's loose files
-    std::set<unsigned int>
-        m_ArchiveLooseOverwrittenList;  // indices of mods with loose files overwriting
-                                        // this mod's archive files
-  };
-
-  Conflicts doConflictCheck() const;
+  // conflicts of this mod from the results of all the mods
+  //
+  std::shared_ptr<const ModConflicts::Entry> doConflictCheck() const;
+
+  // tree backed by the listing shared with the refresher when possible, or
+  // populated from the disk otherwise
+  std::shared_ptr<const MOBase::IFileTree> makeFileTree() const;
 
   MOBase::MemoizedLocked<std::shared_ptr<const MOBase::IFileTree>> m_FileTree;
   MOBase::MemoizedLocked<bool> m_Valid;
   MOBase::MemoizedLocked<std::set<int>> m_Contents;
-  MOBase::MemoizedLocked<Conflicts> m_Conflicts;
+  MOBase::MemoizedLocked<std::shared_ptr<const ModConflicts::Entry>> m_Conflicts;
 };
 
 #endif  // MODINFOWITHCONFLICTINFO_H
@@ -44,11 +44,31 @@ ModListSortProxy::ModListSortProxy(Profile* profile, OrganizerCore* organizer)
 {
   setDynamicSortFilter(true);  // this seems to work without dynamicsortfilter
                                // but I don't know why. This should be necessary
+
+  // the search index and the sort keys are by mod, and the rows of the mod list
+  // are the indices of the mods; this is connected before the proxies between
+  // the mod list and this model so it's up to date when they forward the
+  // change
+  ModList* modList = organizer->modList();
+
+  connect(modList, &QAbstractItemModel::dataChanged, this,
+          &ModListSortProxy::modsChanged);
+  connect(modList, &QAbstractItemModel::modelReset, this, &ModListSortProxy::modsReset);
+  connect(modList, &QAbstractItemModel::layoutChanged, this,
+          &ModListSortProxy::modsReset);
+  connect(modList, &QAbstractItemModel::rowsRemoved, this,
+          &ModListSortProxy::modsReset);
+
+  // enabling a mod or changing its priority changes the conflicts of the mods
+  // it overwrites or is overwritten by, which are not in the change
+  connect(organizer, &OrganizerCore::modConflictsInvalidated, this,
+          &ModListSortProxy::conflictsInvalidated);
 }
 
 void ModListSortProxy::setProfile(Profile* profile)
 {
   m_Profile = profile;
+  clearSortKeys();
 }
 
 void ModListSortProxy::updateFilterActive()
@@ -110,53 +130,29 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
     }
   }
 
-  bool lOk, rOk;
-  int leftIndex  = left.data(ModList::IndexRole).toInt(&lOk);
-  int rightIndex = right.data(ModList::IndexRole).toInt(&rOk);
+  const SortKey* lKey = sortKey(left);
+  const SortKey* rKey = sortKey(right);
 
-  if (!lOk || !rOk) {
+  if (lKey == nullptr || rKey == nullptr) {
     return false;
   }
 
-  ModInfo::Ptr leftMod  = ModInfo::getByIndex(leftIndex);
-  ModInfo::Ptr rightMod = ModInfo::getByIndex(rightIndex);
+  const ModInfo::Ptr& leftMod  = lKey->mod;
+  const ModInfo::Ptr& rightMod = rKey->mod;
 
-  bool lt = left.data(ModList::PriorityRole).toInt() <
-            right.data(ModList::PriorityRole).toInt();
+  bool lt = lKey->priority < rKey->priority;
 
   switch (left.column()) {
-  case ModList::COL_FLAGS: {
-    std::vector<ModInfo::EFlag> leftFlags  = leftMod->getFlags();
-    std::vector<ModInfo::EFlag> rightFlags = rightMod->getFlags();
-    if (leftFlags.size() != rightFlags.size()) {
-      lt = leftFlags.size() < rightFlags.size();
-    } else {
-      lt = flagsId(leftFlags) < flagsId(rightFlags);
-    }
-  } break;
+  case ModList::COL_FLAGS:
   case ModList::COL_CONFLICTFLAGS: {
-    std::vector<ModInfo::EConflictFlag> leftFlags  = leftMod->getConflictFlags();
-    std::vector<ModInfo::EConflictFlag> rightFlags = rightMod->getConflictFlags();
-    if (leftFlags.size() != rightFlags.size()) {
-      lt = leftFlags.size() < rightFlags.size();
+    if (lKey->count != rKey->count) {
+      lt = lKey->count < rKey->count;
     } else {
-      lt = conflictFlagsId(leftFlags) < conflictFlagsId(rightFlags);
+      lt = lKey->id < rKey->id;
     }
   } break;
   case ModList::COL_CONTENT: {
-    const auto& lContents = leftMod->getContents();
-    const auto& rContents = rightMod->getContents();
-    unsigned int lValue   = 0;
-    unsigned int rValue   = 0;
-    m_Organizer->modDataContents().forEachContentIn(
-        lContents, [&lValue](auto const& content) {
-          lValue += 2U << static_cast<unsigned int>(content.id());
-        });
-    m_Organizer->modDataContents().forEachContentIn(
-        rContents, [&rValue](auto const& content) {
-          rValue += 2U << static_cast<unsigned int>(content.id());
-        });
-    lt = lValue < rValue;
+    lt = lKey->id < rKey->id;
   } break;
   case ModList::COL_NAME: {
     int comp = QString::compare(leftMod->name(), rightMod->name(), Qt::CaseInsensitive);
@@ -164,23 +160,13 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
       lt = comp < 0;
   } break;
   case ModList::COL_CATEGORY: {
-    if (leftMod->primaryCategory() != rightMod->primaryCategory()) {
-      if (leftMod->primaryCategory() < 0)
+    if (lKey->category != rKey->category) {
+      if (lKey->category < 0)
         lt = false;
-      else if (rightMod->primaryCategory() < 0)
+      else if (rKey->category < 0)
         lt = true;
-      else {
-        try {
-          CategoryFactory& categories = CategoryFactory::instance();
-          QString leftCatName         = categories.getCategoryName(
-              categories.getCategoryIndex(leftMod->primaryCategory()));
-          QString rightCatName = categories.getCategoryName(
-              categories.getCategoryIndex(rightMod->primaryCategory()));
-          lt = leftCatName < rightCatName;
-        } catch (const std::exception& e) {
-          log::error("failed to compare categories: {}", e.what());
-        }
-      }
+      else
+        lt = lKey->categoryName < rKey->categoryName;
     }
   } break;
   case ModList::COL_AUTHOR: {
@@ -208,14 +194,12 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
       lt = leftMod->nexusId() < rightMod->nexusId();
   } break;
   case ModList::COL_VERSION: {
-    if (leftMod->version() != rightMod->version())
-      lt = leftMod->version() < rightMod->version();
+    if (lKey->version != rKey->version)
+      lt = lKey->version < rKey->version;
   } break;
   case ModList::COL_INSTALLTIME: {
-    QDateTime leftTime  = left.data().toDateTime();
-    QDateTime rightTime = right.data().toDateTime();
-    if (leftTime != rightTime)
-      return leftTime < rightTime;
+    if (lKey->installTime != rKey->installTime)
+      return lKey->installTime < rKey->installTime;
   } break;
   case ModList::COL_GAME: {
     if (leftMod->gameName() != rightMod->gameName()) {
@@ -254,9 +238,101 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
   return lt;
 }
 
+const ModListSortProxy::SortKey*
+ModListSortProxy::sortKey(const QModelIndex& index) const
+{
+  const auto row = std::make_pair(index.row(), index.internalId());
+  auto itor      = m_SortRows.constFind(row);
+
+  if (itor == m_SortRows.constEnd()) {
+    bool ok            = false;
+    const int modIndex = index.data(ModList::IndexRole).toInt(&ok);
+    itor               = m_SortRows.insert(row, ok ? modIndex : -1);
+  }
+
+  const int modIndex = *itor;
+  if (modIndex < 0) {
+    return nullptr;
+  }
+
+  if (static_cast<std::size_t>(modIndex) >= m_SortKeys.size()) {
+    m_SortKeys.resize(std::max<std::size_t>(modIndex + 1, ModInfo::getNumMods()));
+  }
+
+  SortKey& key = m_SortKeys[modIndex];
+
+  if (!key.mod) {
+    key.mod      = ModInfo::getByIndex(modIndex);
+    key.priority = index.data(ModList::PriorityRole).toInt();
+    key.column   = -1;
+  }
+
+  if (key.column != index.column()) {
+    computeColumnKey(key, index);
+    key.column = index.column();
+  }
+
+  return &key;
+}
+
+void ModListSortProxy::computeColumnKey(SortKey& key, const QModelIndex& index) const
+{
+  const ModInfo::Ptr& mod = key.mod;
+
+  switch (index.column()) {
+  case ModList::COL_FLAGS: {
+    const auto flags = mod->getFlags();
+    key.count        = flags.size();
+    key.id           = flagsId(flags);
+  } break;
+  case ModList::COL_CONFLICTFLAGS: {
+    const auto flags = mod->getConflictFlags();
+    key.count        = flags.size();
+    key.id           = conflictFlagsId(flags);
+  } break;
+  case ModList::COL_CONTENT: {
+    unsigned int value = 0;
+    m_Organizer->modDataContents().forEachContentIn(
+        mod->getContents(), [&value](auto const& content) {
+          value += 2U << static_cast<unsigned int>(content.id());
+        });
+    key.id = value;
+  } break;
+  case ModList::COL_CATEGORY: {
+    key.category = mod->primaryCategory();
+    key.categoryName.clear();
+
+    if (key.category >= 0) {
+      try {
+        CategoryFactory& categories = CategoryFactory::instance();
+        key.categoryName =
+            categories.getCategoryName(categories.getCategoryIndex(key.category));
+      } catch (const std::exception& e) {
+        log::error("failed to compare categories: {}", e.what());
+      }
+    }
+  } break;
+  case ModList::COL_VERSION: {
+    key.version = mod->version();
+  } break;
+  case ModList::COL_INSTALLTIME: {
+    key.installTime = index.data().toDateTime();
+  } break;
+  default:
+    break;
+  }
+}
+
+void ModListSortProxy::clearSortKeys()
+{
+  m_SortKeys.clear();
+  m_SortRows.clear();
+}
+
 void ModListSortProxy::updateFilter(const QString& filter)
 {
   m_Filter = filter;
+  m_Query  = ModFilterQuery::compile(filter);
   updateFilterActive();
   invalidateFilter();
   emit filterInvalidated();
@@ -453,98 +529,10 @@ bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
     }
   }
 
-  if (!m_Filter.isEmpty()) {
-    bool display       = false;
-    QString filterCopy = QString(m_Filter);
-    filterCopy.replace("||", ";").replace("OR", ";").replace("|", ";");
-    QStringList ORList = filterCopy.split(";", Qt::SkipEmptyParts);
-
-    bool segmentGood = true;
-
-    // split in ORSegments that internally use AND logic
-    for (auto& ORSegment : ORList) {
-      QStringList ANDKeywords = ORSegment.split(" ", Qt::SkipEmptyParts);
-      segmentGood             = true;
-      bool foundKeyword       = false;
-
-      // check each word in the segment for match, each word needs to be matched but
-      // it doesn't matter where.
-      for (auto& currentKeyword : ANDKeywords) {
-        foundKeyword = false;
-
-        // search keyword in name
-        if (m_EnabledColumns[ModList::COL_NAME] &&
-            info->name().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by author
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_AUTHOR] &&
-            info->author().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by uploader
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_UPLOADER] &&
-            info->uploader().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by notes
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_NOTES] &&
-            (info->notes().contains(currentKeyword, Qt::CaseInsensitive) ||
-             info->comments().contains(currentKeyword, Qt::CaseInsensitive))) {
-          foundKeyword = true;
-        }
-
-        // Search by categories
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_CATEGORY]) {
-          for (auto category : info->categories()) {
-            if (category.contains(currentKeyword, Qt::CaseInsensitive)) {
-              foundKeyword = true;
-              break;
-            }
-          }
-        }
-
-        // Search by Nexus ID
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_MODID]) {
-          bool ok;
-          int filterID = currentKeyword.toInt(&ok);
-          if (ok) {
-            int modID = info->nexusId();
-            while (modID > 0) {
-              if (modID == filterID) {
-                foundKeyword = true;
-                break;
-              }
-              modID = (int)(modID / 10);
-            }
-          }
-        }
-
-        if (!foundKeyword) {
-          // currentKeword is missing from everything, AND fails and we need to check
-          // next ORsegment
-          segmentGood = false;
-          break;
-        }
-
-      }  // for ANDKeywords loop
-
-      if (segmentGood) {
-        // the last AND loop didn't break so the ORSegments is true so mod matches
-        // filter
-        display = true;
-        break;
-      }
-
-    }  // for ORList loop
-
-    if (!display) {
-      return false;
-    }
-  }  // if (!m_CurrentFilter.isEmpty())
+  if (!m_Filter.isEmpty() &&
+      !m_SearchIndex.matches(m_Query, info, m_EnabledColumns)) {
+    return false;
+  }
 
   if (m_FilterMode == FilterAnd) {
     return filterMatchesModAnd(info, enabled);
@@ -682,6 +670,24 @@ bool ModListSortProxy::dropMimeData(const QMimeData* data, Qt::DropAction action
 void ModListSortProxy::setSourceModel(QAbstractItemModel* sourceModel)
 {
   QSortFilterProxyModel::setSourceModel(sourceModel);
+  clearSortKeys();
+
+  if (sourceModel) {
+    // the rows of the sort keys are the rows of this model, which can be a
+    // proxy that's rebuilt without the mod list changing; this must be done
+    // before the change since the base class sorts right after it
+    connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this,
+            &ModListSortProxy::clearSortKeys, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::layoutAboutToBeChanged, this,
+            &ModListSortProxy::clearSortKeys, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this,
+            &ModListSortProxy::clearSortKeys, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+            &ModListSortProxy::clearSortKeys, Qt::UniqueConnection);
+    connect(sourceModel, &QAbstractItemModel::rowsAboutToBeMoved, this,
+            &ModListSortProxy::clearSortKeys, Qt::UniqueConnection);
+  }
+
   QAbstractProxyModel* proxy = qobject_cast<QAbstractProxyModel*>(sourceModel);
   if (proxy != nullptr) {
     sourceModel = proxy->sourceModel();
@@ -694,6 +700,34 @@ void ModListSortProxy::setSourceModel(QAbstractItemModel* sourceModel)
   }
 }
 
+void ModListSortProxy::modsChanged(const QModelIndex& topLeft,
+                                   const QModelIndex& bottomRight)
+{
+  // this is emitted by ModList::modInfoChanged() between aboutToChangeData()
+  // and postDataChanged(), and for any edit in the list
+  m_SearchIndex.invalidate(topLeft.row(), bottomRight.row());
+
+  const int last = std::min<int>(bottomRight.row(), int(m_SortKeys.size()) - 1);
+  for (int i = std::max(topLeft.row(), 0); i <= last; ++i) {
+    m_SortKeys[i] = {};
+  }
+}
+
+void ModListSortProxy::modsReset()
+{
+  m_SearchIndex.clear();
+  clearSortKeys();
+}
+
+void ModListSortProxy::conflictsInvalidated()
+{
+  // the flags and conflict flags of any mod may have changed; every column key
+  // is computed again on the next sort, the mods and priorities are kept
+  for (auto& key : m_SortKeys) {
+    key.column = -1;
+  }
+}
+
 void ModListSortProxy::aboutToChangeData()
 {
   // having a filter active when dataChanged is called caused a crash
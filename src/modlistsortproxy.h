@@ -21,8 +21,13 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #define MODLISTSORTPROXY_H
 
 #include "modlist.h"
+#include "modsearchindex.h"
+#include <QDateTime>
+#include <QHash>
 #include <QSortFilterProxyModel>
 #include <bitset>
+#include <utility>
+#include <vector>
 
 class Profile;
 class OrganizerCore;
@@ -128,6 +133,28 @@ protected:
   virtual bool filterAcceptsRow(int row, const QModelIndex& parent) const;
 
 private:
+  // what lessThan() needs from a mod, computed once instead of for every
+  // comparison; the part that depends on the sort column is recomputed when
+  // the column changes
+  //
+  struct SortKey
+  {
+    ModInfo::Ptr mod;
+    int priority = 0;
+
+    // column the fields below were computed for, -1 if none
+    int column = -1;
+
+    // flags, conflict flags or content
+    std::size_t count = 0;
+    unsigned long id  = 0;
+
+    int category = -1;
+    QString categoryName;
+    MOBase::VersionInfo version;
+    QDateTime installTime;
+  };
+
   unsigned long flagsId(const std::vector<ModInfo::EFlag>& flags) const;
   unsigned long conflictFlagsId(const std::vector<ModInfo::EConflictFlag>& flags) const;
   bool hasConflictFlag(const std::vector<ModInfo::EConflictFlag>& flags) const;
@@ -139,10 +166,20 @@ private:
   //
   bool sourceIsByPriorityProxy() const;
 
+  // returns the sort key of the mod at the given row of the source model,
+  // null if the row is not a mod
+  //
+  const SortKey* sortKey(const QModelIndex& index) const;
+  void computeColumnKey(SortKey& key, const QModelIndex& index) const;
+  void clearSortKeys();
+
 private slots:
 
   void aboutToChangeData();
   void postDataChanged();
+  void modsChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
+  void modsReset();
+  void conflictsInvalidated();
 
 private:
   OrganizerCore* m_Organizer;
@@ -150,6 +187,8 @@ private:
   Profile* m_Profile;
   std::vector<Criteria> m_Criteria;
   QString m_Filter;
+  ModFilterQuery m_Query;
+  ModSearchIndex m_SearchIndex;
   std::bitset<ModList::COL_LASTCOLUMN + 1> m_EnabledColumns;
 
   bool m_FilterActive;
@@ -158,6 +197,11 @@ private:
 
   std::vector<Criteria> m_PreChangeCriteria;
 
+  // sort keys by mod index, and the mod index of the rows of the source model
+  // by row and internal id
+  mutable std::vector<SortKey> m_SortKeys;
+  mutable QHash<std::pair<int, quintptr>, int> m_SortRows;
+
   bool optionsMatchMod(ModInfo::Ptr info, bool enabled) const;
   bool criteriaMatchMod(ModInfo::Ptr info, bool enabled, const Criteria& c) const;
   bool categoryMatchesMod(ModInfo::Ptr info, bool enabled, int category) const;
@@ -11,6 +11,7 @@
 #include "ui_mainwindow.h"
 
 #include "copyeventfilter.h"
+#include "directorycloner.h"
 #include "filterlist.h"
 #include "genericicondelegate.h"
 #include "log.h"
@@ -609,9 +610,13 @@ void ModListView::onExternalFolderDropped(const QUrl& url, int priority)
     return;
   }
 
-  // TODO: this is currently a silent copy, which can take some time, but there is
-  // no clean method to do this in uibase
-  if (!copyDir(fileInfo.absoluteFilePath(), newMod->absolutePath(), true)) {
+  QString error;
+  if (!cloneDirectory(this, fileInfo.absoluteFilePath(), newMod->absolutePath(), true,
+                      error)) {
+    if (!error.isEmpty()) {
+      reportError(error);
+    }
+
     return;
   }
 
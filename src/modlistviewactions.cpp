@@ -11,6 +11,7 @@
 
 #include "categories.h"
 #include "csvbuilder.h"
+#include "directorycloner.h"
 #include "directoryrefresher.h"
 #include "downloadmanager.h"
 #include "filedialogmemory.h"
@@ -614,26 +615,7 @@ void ModListViewActions::displayModInformation(ModInfo::Ptr modInfo,
     emit modInfoDisplayed();
   }
 
-  if (m_core.currentProfile()->modEnabled(modIndex) && !modInfo->isForeign()) {
-    FilesOrigin& origin = m_core.directoryStructure()->getOriginByName(modInfo->name());
-    origin.enable(false);
-
-    if (m_core.directoryStructure()->originExists(modInfo->name())) {
-      FilesOrigin& origin =
-          m_core.directoryStructure()->getOriginByName(modInfo->name());
-      origin.enable(false);
-      QString path       = modInfo->absolutePath();
-      QString modDataDir = m_core.managedGame()->modDataDirectory();
-      path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
-      m_core.directoryRefresher()->addModToStructure(
-          m_core.directoryStructure(), modInfo->name(),
-          m_core.currentProfile()->getModPriority(modIndex), path,
-          modInfo->stealFiles(), modInfo->archives());
-      DirectoryRefresher::cleanStructure(m_core.directoryStructure());
-      m_core.directoryStructure()->getFileRegister()->sortOrigins();
-      m_core.refreshLists();
-    }
-  }
+  m_core.reloadModInDirectoryStructure(modIndex);
 }
 
 void ModListViewActions::sendModsToTop(const QModelIndexList& indexes) const
@@ -1043,8 +1025,16 @@ void ModListViewActions::createBackup(const QModelIndex& index) const
   ModInfo::Ptr modInfo = ModInfo::getByIndex(index.data(ModList::IndexRole).toInt());
   QString backupDirectory =
       m_core.installationManager()->generateBackupName(modInfo->absolutePath());
-  if (!copyDir(modInfo->absolutePath(), backupDirectory, false)) {
-    QMessageBox::information(m_parent, tr("Failed"), tr("Failed to create backup."));
+  QString error;
+  if (!cloneDirectory(m_parent, modInfo->absolutePath(), backupDirectory, false,
+                      error)) {
+    // the error is empty if the user cancelled
+    if (!error.isEmpty()) {
+      QMessageBox::information(m_parent, tr("Failed"),
+                               tr("Failed to create backup.") + "\n" + error);
+    }
+
+    return;
   }
   m_core.refresh();
   m_view->updateModCount();
@@ -0,0 +1,70 @@
+#include "modmetacache.h"
+#include <QDataStream>
+#include <QFileInfo>
+#include <QSettings>
+
+namespace
+{
+
+constexpr quint32 Magic = 0x4d4f4d4d;  // "MOMM"
+
+const QString DescriptionKey = QStringLiteral("nexusDescription");
+
+}  // namespace
+
+QDataStream& operator<<(QDataStream& s, const ModMeta& m)
+{
+  return s << m.values;
+}
+
+QDataStream& operator>>(QDataStream& s, ModMeta& m)
+{
+  return s >> m.values;
+}
+
+ModMeta ModMeta::read(const QString& path)
+{
+  ModMeta m;
+
+  if (!QFileInfo::exists(path)) {
+    return m;
+  }
+
+  QSettings s(path, QSettings::IniFormat);
+
+  for (const auto& key : s.allKeys()) {
+    if (key != DescriptionKey) {
+      m.values.insert(key, s.value(key));
+    }
+  }
+
+  return m;
+}
+
+QString ModMeta::readDescription(const QString& path)
+{
+  if (!QFileInfo::exists(path)) {
+    return {};
+  }
+
+  QSettings s(path, QSettings::IniFormat);
+  return s.value(DescriptionKey, "").toString();
+}
+
+ModMetaCache::ModMetaCache(QString name)
+    : FileCache(Magic, FormatVersion, std::move(name))
+{}
+
+std::vector<std::shared_ptr<const ModMeta>>
+ModMetaCache::get(const std::vector<QString>& paths, std::size_t threadCount)
+{
+  return get(stat(paths, threadCount), threadCount);
+}
+
+std::vector<std::shared_ptr<const ModMeta>>
+ModMetaCache::get(const std::vector<Stamp>& files, std::size_t threadCount)
+{
+  return FileCache::get(files, threadCount, [&](std::size_t i) {
+    return std::make_shared<const ModMeta>(ModMeta::read(files[i].path));
+  });
+}
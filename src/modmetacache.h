@@ -0,0 +1,76 @@
+#ifndef MODORGANIZER_MODMETACACHE_INCLUDED
+#define MODORGANIZER_MODMETACACHE_INCLUDED
+
+#include "filecache.h"
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <memory>
+#include <vector>
+
+// values of a meta.ini, as returned by QSettings
+//
+// the nexus description is left out, it's by far the largest value and is only
+// needed by the mod info dialog, see readDescription()
+//
+struct ModMeta
+{
+  // keys are full paths like QSettings::allKeys() returns them, such as
+  // "installedFiles/1/modid"
+  QVariantMap values;
+
+  QVariant value(const QString& key, const QVariant& def = {}) const
+  {
+    return values.value(key, def);
+  }
+
+  bool contains(const QString& key) const { return values.contains(key); }
+
+  // reads the given meta.ini, a file that doesn't exist gives no values
+  //
+  static ModMeta read(const QString& path);
+
+  // reads the nexus description from the given meta.ini
+  //
+  static QString readDescription(const QString& path);
+};
+
+QDataStream& operator<<(QDataStream& s, const ModMeta& m);
+QDataStream& operator>>(QDataStream& s, ModMeta& m);
+
+/**
+ * @brief on-disk cache of the meta.ini of every mod, so the files that haven't
+ * changed don't have to be parsed on startup; also used for the .meta files of
+ * downloads, which have the same format
+ *
+ * this must only be used from one thread at a time
+ **/
+class ModMetaCache : public FileCache<ModMeta>
+{
+public:
+  // bumped every time the format of the file changes, files with a different
+  // version are ignored
+  static constexpr quint32 FormatVersion = 1;
+
+  // the name is only used in the log
+  //
+  explicit ModMetaCache(QString name = QStringLiteral("mod meta cache"));
+
+  /**
+   * @brief returns the values of each of the given meta.ini files, in the same
+   * order, using at most the given number of threads for the ones that must be
+   * read
+   **/
+  std::vector<std::shared_ptr<const ModMeta>> get(const std::vector<QString>& paths,
+                                                  std::size_t threadCount);
+
+  /**
+   * @brief same as above for files whose size and modification time are
+   * already known, such as from a directory listing, so they're not stat'ed
+   * again
+   **/
+  std::vector<std::shared_ptr<const ModMeta>> get(const std::vector<Stamp>& files,
+                                                  std::size_t threadCount);
+};
+
+#endif  // MODORGANIZER_MODMETACACHE_INCLUDED
@@ -0,0 +1,192 @@
+#include "modmetawriter.h"
+#include "modinforegular.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <log.h>
+
+using namespace MOBase;
+using namespace MOShared;
+
+namespace
+{
+
+// time between the first change and the batch being written, further changes
+// during that time are written with the same batch
+constexpr int WriteDelay = 1000;
+
+}  // namespace
+
+ModMetaWriter& ModMetaWriter::instance()
+{
+  static ModMetaWriter* w = new ModMetaWriter;
+  return *w;
+}
+
+ModMetaWriter::ModMetaWriter() : m_Timer(new QTimer(this)), m_Pending(0)
+{
+  // the first mod to queue itself might be created on a worker
+  if (auto* app = QCoreApplication::instance()) {
+    moveToThread(app->thread());
+  }
+
+  m_Timer->setSingleShot(true);
+  m_Timer->setInterval(WriteDelay);
+
+  connect(m_Timer, &QTimer::timeout, this, [this] {
+    writeQueued();
+  });
+}
+
+void ModMetaWriter::queue(QSharedPointer<ModInfo> mod)
+{
+  {
+    auto* regular = static_cast<ModInfoRegular*>(mod.data());
+
+    std::scoped_lock lock(m_Mutex);
+    if (!m_Queued.emplace(regular, std::move(mod)).second) {
+      return;
+    }
+  }
+
+  // the timer can only be started from the main thread, it's not restarted by
+  // further changes so mods that keep changing are still written regularly
+  QMetaObject::invokeMethod(this, [this] {
+    if (!m_Timer->isActive()) {
+      m_Timer->start();
+    }
+  });
+}
+
+void ModMetaWriter::save(ModInfoRegular* mod)
+{
+  // released at the end, in case the queue held the last reference
+  QSharedPointer<ModInfo> queued;
+
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    auto itor = m_Queued.find(mod);
+    if (itor != m_Queued.end()) {
+      queued = std::move(itor->second);
+      m_Queued.erase(itor);
+    }
+  }
+
+  if (m_Pending > 0) {
+    m_Group.wait();
+  }
+
+  if (auto s = mod->takeMetaSnapshot()) {
+    if (write(*s)) {
+      mod->metaWritten(s->generation);
+    }
+  }
+}
+
+void ModMetaWriter::flush()
+{
+  m_Timer->stop();
+
+  if (m_Pending > 0) {
+    m_Group.wait();
+  }
+
+  startWriting(takeQueued());
+  m_Group.wait();
+
+  // the written mods are told on this thread, which must happen before the
+  // mods are destroyed so they're not written again
+  QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+bool ModMetaWriter::write(const Snapshot& s)
+{
+  QSettings metaFile(s.path, QSettings::IniFormat);
+
+  if (metaFile.status() != QSettings::NoError) {
+    log::error("failed to write {}: error {}", s.path, metaFile.status());
+    return false;
+  }
+
+  for (const auto& group : s.removedGroups) {
+    metaFile.remove(group);
+  }
+
+  for (const auto& [key, value] : s.values) {
+    metaFile.setValue(key, value);
+  }
+
+  metaFile.sync();  // sync needs to be called to ensure the file is created
+
+  if (metaFile.status() != QSettings::NoError) {
+    log::error("failed to write {}: error {}", s.path, metaFile.status());
+    return false;
+  }
+
+  return true;
+}
+
+void ModMetaWriter::writeQueued()
+{
+  if (m_Pending > 0) {
+    // still writing the previous batch, the queue is left alone so no file is
+    // written twice at the same time
+    m_Timer->start();
+    return;
+  }
+
+  startWriting(takeQueued());
+}
+
+std::vector<ModMetaWriter::Snapshot> ModMetaWriter::takeQueued()
+{
+  // the mods are owned by the queue, so they can't be destroyed once the lock
+  // is released
+  std::map<ModInfoRegular*, QSharedPointer<ModInfo>> mods;
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    mods.swap(m_Queued);
+  }
+
+  std::vector<Snapshot> snapshots;
+  snapshots.reserve(mods.size());
+
+  for (auto& [mod, ptr] : mods) {
+    if (auto s = mod->takeMetaSnapshot()) {
+      s->mod = std::move(ptr);
+      snapshots.push_back(std::move(*s));
+    }
+  }
+
+  return snapshots;
+}
+
+void ModMetaWriter::startWriting(std::vector<Snapshot> snapshots)
+{
+  if (snapshots.empty()) {
+    return;
+  }
+
+  log::debug("writing meta files of {} mods", snapshots.size());
+
+  m_Pending = snapshots.size();
+
+  for (auto& s : snapshots) {
+    m_Group.run(QStringLiteral("meta.ini"), [this, s = std::move(s)]() mutable {
+      const bool written = write(s);
+
+      // the reference is moved to the main thread, where the mod lives; it
+      // must not be released here, destroying the mod would wait for this
+      // batch
+      QMetaObject::invokeMethod(
+          this, [mod = std::move(s.mod), generation = s.generation, written] {
+            if (written) {
+              static_cast<ModInfoRegular*>(mod.data())->metaWritten(generation);
+            }
+          });
+
+      --m_Pending;
+    });
+  }
+}
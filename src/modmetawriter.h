@@ -0,0 +1,123 @@
+#ifndef MODORGANIZER_MODMETAWRITER_INCLUDED
+#define MODORGANIZER_MODMETAWRITER_INCLUDED
+
+#include "taskscheduler.h"
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVariant>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class ModInfo;
+class ModInfoRegular;
+
+/**
+ * @brief write-behind saving of the meta.ini of mods
+ *
+ * mods queue themselves when their meta information changes; the queue is
+ * written a short while after the first change, so bursts of changes, like
+ * setting the category of many mods or the results of an update check, end up
+ * as a single batch where every mod is written once
+ *
+ * the values of the queued mods are taken on the main thread and the files are
+ * written in parallel on the workers; QSettings replaces the files with a
+ * QSaveFile, so an interrupted write never leaves a truncated meta.ini behind
+ *
+ * only one batch is written at a time, so a file is never written by two
+ * threads at once
+ *
+ * a mod only stops being flagged as changed once its file has been written;
+ * if the write fails, it's written again with the next change, or when the mod
+ * is destroyed
+ **/
+class ModMetaWriter : public QObject
+{
+  Q_OBJECT;
+
+public:
+  // values to write to a meta.ini
+  //
+  struct Snapshot
+  {
+    QString path;
+
+    // groups that are removed before the values are written, for arrays and
+    // other groups that are rewritten entirely
+    QStringList removedGroups;
+
+    // keys are full paths, like "installedFiles/1/modid"
+    std::vector<std::pair<QString, QVariant>> values;
+
+    // changes of the mod included in these values, see
+    // ModInfoRegular::metaWritten()
+    std::uint64_t generation = 0;
+
+    // keeps the mod alive while it's written in the background, null for
+    // mods written by save()
+    QSharedPointer<ModInfo> mod;
+  };
+
+  // the writer lives on the main thread, it's never destroyed so mods can
+  // still be saved while static objects are destroyed
+  //
+  static ModMetaWriter& instance();
+
+  // noncopyable
+  ModMetaWriter(const ModMetaWriter&)            = delete;
+  ModMetaWriter& operator=(const ModMetaWriter&) = delete;
+
+  // queues the given mod, which must be a ModInfoRegular and is kept alive
+  // until it's written with the next batch; a mod is only written once per
+  // batch no matter how many times it's queued, can be called from any thread
+  //
+  void queue(QSharedPointer<ModInfo> mod);
+
+  // writes the given mod now instead of with the next batch, waits for the
+  // batch being written first in case it contains this mod; this is also
+  // called when a mod is destroyed, which removes it from the queue
+  //
+  void save(ModInfoRegular* mod);
+
+  // writes all the queued mods and waits until everything is written, must be
+  // called on the main thread
+  //
+  void flush();
+
+  // writes the values to the file, can be called from any thread
+  //
+  static bool write(const Snapshot& s);
+
+private:
+  QTimer* m_Timer;
+
+  // guards m_Queued
+  std::mutex m_Mutex;
+  std::map<ModInfoRegular*, QSharedPointer<ModInfo>> m_Queued;
+
+  // number of files of the current batch that are not written yet
+  std::atomic<std::size_t> m_Pending;
+
+  MOShared::TaskGroup m_Group;
+
+  ModMetaWriter();
+
+  // takes the values of the queued mods and starts writing them, called by the
+  // timer
+  //
+  void writeQueued();
+
+  // takes the values of the queued mods that have changes, clears the queue
+  //
+  std::vector<Snapshot> takeQueued();
+
+  void startWriting(std::vector<Snapshot> snapshots);
+};
+
+#endif  // MODORGANIZER_MODMETAWRITER_INCLUDED
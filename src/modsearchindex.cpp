@@ -0,0 +1,116 @@
+#include "modsearchindex.h"
+#include <algorithm>
+
+using namespace Qt::StringLiterals;
+
+ModFilterQuery ModFilterQuery::compile(const QString& filter)
+{
+  ModFilterQuery q;
+
+  QString copy = filter;
+  copy.replace("||", ";").replace("OR", ";").replace("|", ";");
+
+  for (const auto& segment : copy.split(";", Qt::SkipEmptyParts)) {
+    auto& keywords = q.alternatives.emplace_back();
+
+    for (const auto& word : segment.split(" ", Qt::SkipEmptyParts)) {
+      Keyword k;
+      k.text = word.toCaseFolded();
+
+      bool ok      = false;
+      const int id = word.toInt(&ok);
+      if (ok && id > 0) {
+        k.nexusId = QString::number(id);
+      }
+
+      keywords.push_back(std::move(k));
+    }
+  }
+
+  return q;
+}
+
+bool ModSearchIndex::matches(const ModFilterQuery& query, const ModInfo::Ptr& info,
+                             const Columns& columns) const
+{
+  const Entry& e = entry(info);
+
+  auto found = [&](const ModFilterQuery::Keyword& k) {
+    if (columns[ModList::COL_NAME] && e.name.contains(k.text)) {
+      return true;
+    }
+
+    if (columns[ModList::COL_AUTHOR] && e.author.contains(k.text)) {
+      return true;
+    }
+
+    if (columns[ModList::COL_UPLOADER] && e.uploader.contains(k.text)) {
+      return true;
+    }
+
+    if (columns[ModList::COL_NOTES] && e.notes.contains(k.text)) {
+      return true;
+    }
+
+    if (columns[ModList::COL_CATEGORY] && e.categories.contains(k.text)) {
+      return true;
+    }
+
+    // the keyword matches if it's the start of the id, so 12 matches 1234
+    if (columns[ModList::COL_MODID] && !k.nexusId.isEmpty() &&
+        e.nexusId.startsWith(k.nexusId)) {
+      return true;
+    }
+
+    return false;
+  };
+
+  for (const auto& keywords : query.alternatives) {
+    if (std::all_of(keywords.begin(), keywords.end(), found)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ModSearchIndex::invalidate(int first, int last)
+{
+  if (m_Entries.empty()) {
+    return;
+  }
+
+  const int count = static_cast<int>(ModInfo::getNumMods());
+
+  for (int i = std::max(first, 0); i <= last && i < count; ++i) {
+    m_Entries.erase(ModInfo::getByIndex(i).get());
+  }
+}
+
+void ModSearchIndex::clear()
+{
+  m_Entries.clear();
+}
+
+const ModSearchIndex::Entry& ModSearchIndex::entry(const ModInfo::Ptr& info) const
+{
+  auto itor = m_Entries.find(info.get());
+
+  if (itor != m_Entries.end() && itor->second.info == info) {
+    return itor->second;
+  }
+
+  Entry e;
+  e.info       = info;
+  e.name       = info->name().toCaseFolded();
+  e.author     = info->author().toCaseFolded();
+  e.uploader   = info->uploader().toCaseFolded();
+  e.notes      = QString(info->notes() % u"\n"_s % info->comments()).toCaseFolded();
+  e.categories = info->categories().join(u"\n"_s).toCaseFolded();
+
+  if (const int id = info->nexusId(); id > 0) {
+    e.nexusId = QString::number(id);
+  }
+
+  return m_Entries.insert_or_assign(info.get(), std::move(e)).first->second;
+}
@@ -0,0 +1,78 @@
+#ifndef MODORGANIZER_MODSEARCHINDEX_INCLUDED
+#define MODORGANIZER_MODSEARCHINDEX_INCLUDED
+
+#include "modinfo.h"
+#include "modlist.h"
+#include <QString>
+#include <bitset>
+#include <unordered_map>
+#include <vector>
+
+// filter text of the mod list, parsed once when it changes instead of for
+// every row
+//
+// the text is split in alternatives on `|`, `||` and `OR`, and each
+// alternative in keywords on spaces; a mod matches if all the keywords of any
+// alternative are found in one of the searched columns
+//
+struct ModFilterQuery
+{
+  struct Keyword
+  {
+    // case folded
+    QString text;
+
+    // the keyword as a nexus id, empty if it's not a positive number
+    QString nexusId;
+  };
+
+  std::vector<std::vector<Keyword>> alternatives;
+
+  static ModFilterQuery compile(const QString& filter);
+};
+
+// case-folded text of the searchable columns of every mod, built the first
+// time a mod is filtered and dropped when the mod list reports a change for it
+//
+class ModSearchIndex
+{
+public:
+  using Columns = std::bitset<ModList::COL_LASTCOLUMN + 1>;
+
+  // whether the mod matches the query in the given columns
+  //
+  bool matches(const ModFilterQuery& query, const ModInfo::Ptr& info,
+               const Columns& columns) const;
+
+  // forgets the mods at the given rows of the mod list
+  //
+  void invalidate(int first, int last);
+
+  void clear();
+
+private:
+  struct Entry
+  {
+    // mod infos are recreated on refresh and a new one could reuse the
+    // address of one that's gone
+    QWeakPointer<ModInfo> info;
+
+    QString name;
+    QString author;
+    QString uploader;
+
+    // notes and comments, and every category, separated by newlines, which
+    // can't be in a keyword
+    QString notes;
+    QString categories;
+
+    // empty if the mod has no nexus id
+    QString nexusId;
+  };
+
+  mutable std::unordered_map<const ModInfo*, Entry> m_Entries;
+
+  const Entry& entry(const ModInfo::Ptr& info) const;
+};
+
+#endif  // MODORGANIZER_MODSEARCHINDEX_INCLUDED
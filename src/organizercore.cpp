@@ -14,7 +14,9 @@
 #include "iplugingame.h"
 #include "iuserinterface.h"
 #include "messagedialog.h"
+#include "modconflicts.h"
 #include "modlistsortproxy.h"
+#include "modmetawriter.h"
 #include "modrepositoryfileinfo.h"
 #include "nexusinterface.h"
 #include "nxmaccessmanager.h"
@@ -28,6 +30,7 @@
 #include "shared/util.h"
 #include "spawn.h"
 #include "syncoverwritedialog.h"
+#include "taskscheduler.h"
 #include "virtualfiletree.h"
 #include <ipluginmodpage.h>
 #include <questionboxmemory.h>
@@ -54,6 +57,7 @@
 #include <QTimer>
 #include <QUrl>
 #include <QWidget>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <QtDebug>
 #include <QtGlobal>  // for qUtf8Printable, etc
@@ -69,6 +73,7 @@
 #include <set>
 #include <string>  //for wstring
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -97,15 +102,22 @@ OrganizerCore::OrganizerCore(Settings& settings)
       m_CurrentProfile(nullptr), m_Settings(settings),
       m_Updater(&NexusInterface::instance()), m_ModList(m_PluginContainer, this),
       m_PluginList(*this),
-      m_DirectoryRefresher(new DirectoryRefresher(this, settings.refreshThreadCount())),
+      m_DirectoryRefresher(new DirectoryRefresher(this)),
       m_DirectoryStructure(new DirectoryEntry("data", nullptr, 0)),
       m_VirtualFileTree([this]() {
         return VirtualFileTree::makeTree(m_DirectoryStructure);
       }),
+      m_ModConflicts([this]() {
+        return computeModConflicts();
+      }),
       m_DownloadManager(&NexusInterface::instance(), this), m_DirectoryUpdate(false),
       m_ArchivesInit(false),
       m_PluginListsWriter(std::bind(&OrganizerCore::savePluginList, this))
 {
+  // used by the refresher and anything else that runs tasks in parallel, this
+  // has to be done before the scheduler is used for the first time
+  TaskScheduler::setGlobalThreadCount(settings.refreshThreadCount());
+
   m_DownloadManager.setOutputDirectory(m_Settings.paths().downloads(), false);
 
   NexusInterface::instance().setCacheDirectory(m_Settings.paths().cache());
@@ -150,10 +162,20 @@ OrganizerCore::OrganizerCore(Settings& settings)
           [this](auto const&... args) {
             m_PluginSettingChanged(args...);
           });
+
+  // files are typically changed outside of MO while it's in the background
+  connect(qApp, &QApplication::applicationStateChanged, this,
+          [this](Qt::ApplicationState state) {
+            if (state == Qt::ApplicationActive) {
+              checkForChanges();
+            }
+          });
 }
 
 OrganizerCore::~OrganizerCore()
 {
+  m_ChangesCheck.waitForFinished();
+
   m_RefresherThread.exit();
   m_RefresherThread.wait();
 
@@ -166,6 +188,9 @@ OrganizerCore::~OrganizerCore()
   // profile has to be cleaned up before the modinfo-buffer is cleared
   m_CurrentProfile.reset();
 
+  // the mods would write their changes one by one when they're destroyed
+  ModMetaWriter::instance().flush();
+
   ModInfo::clear();
   m_ModList.setProfile(nullptr);
   //  NexusInterface::instance()->cleanup();
@@ -475,7 +500,78 @@ void OrganizerCore::createOverwriteDirectories()
 
 void OrganizerCore::prepareVFS()
 {
-  m_USVFS.updateMapping(fileMapping(m_CurrentProfile->name(), QString()));
+  // the token is taken once the mapping is built, which waits for anything
+  // that may change it
+  auto mapping = fileMapping(m_CurrentProfile->name(), QString());
+  m_USVFS.updateMapping(mapping, vfsContentToken());
+}
+
+std::size_t OrganizerCore::vfsContentToken() const
+{
+  // mods and overwrite are covered by the refresher, which also counts the
+  // files added outside of MO since the last refresh when checkForChanges()
+  // notices them; local saves are linked directly from the profile
+  qint64 savesTime = 0;
+
+  if (m_CurrentProfile != nullptr && m_CurrentProfile->localSavesEnabled()) {
+    savesTime = QFileInfo(m_CurrentProfile->absolutePath() + "/saves")
+                    .lastModified()
+                    .toMSecsSinceEpoch();
+  }
+
+  return qHashMulti(0, m_DirectoryRefresher->listingChanges(), savesTime);
+}
+
+void OrganizerCore::checkForChanges()
+{
+  if (m_ChangesCheck.isRunning()) {
+    return;
+  }
+
+  m_ChangesCheck = QtConcurrent::run([r = m_DirectoryRefresher.get()] {
+    r->checkForChanges();
+  });
+}
+
+ModMappingInputs OrganizerCore::mappingInputs(const Profile& profile) const
+{
+  IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+
+  ModMappingInputs in;
+  in.profile        = profile.name();
+  in.overwritePath  = m_Settings.paths().overwrite();
+  in.contentToken   = vfsContentToken();
+
+  const auto dataMaps = game->getModMappings();
+  for (auto&& [from, to] : dataMaps.asKeyValueRange()) {
+    in.dataMaps.emplace_back(from, to);
+  }
+
+  for (const auto& mod : profile.getActiveMods()) {
+    if (std::get<0>(mod).compare("overwrite", Qt::CaseInsensitive) == 0) {
+      continue;
+    }
+
+    ModInfo::Ptr modPtr = ModInfo::getByIndex(ModInfo::getIndex(std::get<0>(mod)));
+    in.mods.push_back({std::get<0>(mod), std::get<1>(mod), modPtr->isRegular()});
+  }
+
+  return in;
+}
+
+void OrganizerCore::precomputeMapping()
+{
+  if (m_CurrentProfile == nullptr) {
+    return;
+  }
+
+  // the links only need QDir::exists(), which is safe on any thread; the
+  // rest of the mapping is cheap or comes from plugins and is built when
+  // it's needed
+  m_PrecomputedMapping =
+      QtConcurrent::run([in = mappingInputs(*m_CurrentProfile)] {
+        return ModMapping::build(in);
+      });
 }
 
 void OrganizerCore::updateVFSParams(log::Levels logLevel,
@@ -614,6 +710,8 @@ void OrganizerCore::setCurrentProfile(const QString& profileName)
           [this](auto&& indexes) {
             modStatusChanged(indexes);
           });
+  // the mapping of the new profile is precomputed once the refresh is done, see
+  // onDirectoryRefreshed()
   refreshDirectoryStructure();
 
   m_CurrentProfile->debugDump();
@@ -974,21 +1072,64 @@ OrganizerCore::findFiles(const QString& path,
                          const std::function<bool(const QString&)>& filter) const
 {
   QStringList result;
-  DirectoryEntry* dir = m_DirectoryStructure;
-  if (!path.isEmpty() && path != ".")
-    dir = dir->findSubDirectoryRecursive(path);
+  DirectoryEntry* dir = findDirectory(path);
   if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr& file : files) {
-      QString fullPath = file->getFullPath();
-      if (filter(file->getName())) {
-        result.append(fullPath);
+    // paths are only built for the files that pass the filter
+    dir->forEachFile([&](const FileEntry& file) {
+      if (filter(file.getName())) {
+        result.append(file.getFullPath());
+      }
+
+      return true;
+    });
+  }
+  return result;
+}
+
+QStringList OrganizerCore::findFiles(const QString& path,
+                                     const QStringList& globFilters) const
+{
+  return findFiles(QStringList{path}, globFilters)[0];
+}
+
+std::vector<QStringList> OrganizerCore::findFiles(const QStringList& paths,
+                                                  const QStringList& globFilters) const
+{
+  const FileQuery query(globFilters);
+  std::vector<QStringList> result(paths.size());
+
+  for (qsizetype i = 0; i < paths.size(); ++i) {
+    const DirectoryEntry* dir = findDirectory(paths[i]);
+    if (dir == nullptr) {
+      continue;
+    }
+
+    const auto indices = dir->findFiles(query);
+    result[i].reserve(static_cast<qsizetype>(indices.size()));
+
+    for (const auto index : indices) {
+      if (auto file = dir->getFileByIndex(index)) {
+        result[i].append(file->getFullPath());
       }
     }
   }
+
   return result;
 }
 
+DirectoryEntry* OrganizerCore::findDirectory(const QString& path) const
+{
+  if (m_DirectoryStructure == nullptr) {
+    return nullptr;
+  }
+
+  if (path.isEmpty() || path == ".") {
+    return m_DirectoryStructure;
+  }
+
+  return m_DirectoryStructure->findSubDirectoryRecursive(path);
+}
+
 QStringList OrganizerCore::getFileOrigins(const QString& fileName) const
 {
   QStringList result;
@@ -1008,27 +1149,35 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerCore::findFileInfos(
     const std::function<bool(const MOBase::IOrganizer::FileInfo&)>& filter) const
 {
   QList<IOrganizer::FileInfo> result;
-  DirectoryEntry* dir = m_DirectoryStructure;
-  if (!path.isEmpty() && path != ".")
-    dir = dir->findSubDirectoryRecursive(path);
+  DirectoryEntry* dir = findDirectory(path);
   if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr file : files) {
+    // the same few origins are looked up for every file
+    std::unordered_map<OriginID, QString> originNames;
+    auto originName = [&](OriginID id) -> const QString& {
+      auto itor = originNames.find(id);
+      if (itor == originNames.end()) {
+        const auto& origin = m_DirectoryStructure->getOriginByID(id);
+        itor               = originNames.emplace(id, origin.getName()).first;
+      }
+      return itor->second;
+    };
+
+    dir->forEachFile([&](const FileEntry& file) {
       IOrganizer::FileInfo info;
-      info.filePath    = file->getFullPath();
+      info.filePath    = file.getFullPath();
       bool fromArchive = false;
-      info.origins.append(
-          m_DirectoryStructure->getOriginByID(file->getOrigin(fromArchive)).getName());
-      info.archive = fromArchive ? file->getArchive().name() : "";
-      for (const auto& idx : file->getAlternatives()) {
-        info.origins.append(
-            m_DirectoryStructure->getOriginByID(idx.originID()).getName());
+      info.origins.append(originName(file.getOrigin(fromArchive)));
+      info.archive = fromArchive ? file.getArchive().name() : "";
+      for (const auto& idx : file.getAlternatives()) {
+        info.origins.append(originName(idx.originID()));
       }
 
       if (filter(info)) {
         result.append(info);
       }
-    }
+
+      return true;
+    });
   }
   return result;
 }
@@ -1300,6 +1449,35 @@ void OrganizerCore::refreshESPList(bool force)
       RefreshCallbackGroup::CORE, RefreshCallbackMode::RUN_NOW_IF_POSSIBLE);
 }
 
+void OrganizerCore::updateESPList(const std::vector<unsigned int>& modIndices)
+{
+  onNextRefresh(
+      [this, modIndices] {
+        TimeThis tt("OrganizerCore::updateESPList()");
+
+        m_CurrentProfile->writeModlist();
+
+        // plugins, their archives and their inis are all at the root of the
+        // data directory
+        const QString modDataDir = managedGame()->modDataDirectory();
+        QStringList files;
+
+        for (auto index : modIndices) {
+          QString path = ModInfo::getByIndex(index)->absolutePath();
+          path         = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
+          files.append(QDir(path).entryList(QDir::Files));
+        }
+
+        try {
+          m_PluginList.update(*m_DirectoryStructure,
+                              m_PluginList.changes(*m_DirectoryStructure, files));
+        } catch (const std::exception& e) {
+          reportError(tr("Failed to refresh list of esps: %1").arg(e.what()));
+        }
+      },
+      RefreshCallbackGroup::CORE, RefreshCallbackMode::RUN_NOW_IF_POSSIBLE);
+}
+
 void OrganizerCore::refreshBSAList()
 {
   TimeThis tt("OrganizerCore::refreshBSAList()");
@@ -1344,6 +1522,14 @@ void OrganizerCore::refreshLists()
      // tree
 }
 
+void OrganizerCore::updateLists(const std::vector<unsigned int>& modIndices)
+{
+  if ((m_CurrentProfile != nullptr) && m_DirectoryStructure->isPopulated()) {
+    updateESPList(modIndices);
+    refreshBSAList();
+  }
+}
+
 void OrganizerCore::updateModActiveState(int index, bool active)
 {
   QList<unsigned int> modsToUpdate;
@@ -1440,7 +1626,8 @@ void OrganizerCore::updateModsInDirectoryStructure(
 
   DirectoryRefresher::cleanStructure(m_DirectoryStructure);
   // need to refresh plugin list now so we can activate esps
-  refreshESPList(true);
+  const auto indices = modInfo.keys();
+  updateESPList({indices.begin(), indices.end()});
   // activate all esps of the specified mod so the bsas get activated along with
   // it
   m_PluginList.blockSignals(true);
@@ -1468,6 +1655,37 @@ void OrganizerCore::updateModsInDirectoryStructure(
   }
 }
 
+void OrganizerCore::reloadModInDirectoryStructure(unsigned int index)
+{
+  ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+
+  if (!m_CurrentProfile->modEnabled(index) || modInfo->isForeign() ||
+      !m_DirectoryStructure->originExists(modInfo->name())) {
+    return;
+  }
+
+  // drops the files of this origin only, other origins become the primary
+  // origin of the files that this mod was providing
+  FilesOrigin& origin = m_DirectoryStructure->getOriginByName(modInfo->name());
+  origin.enable(false);
+
+  QString path       = modInfo->absolutePath();
+  QString modDataDir = managedGame()->modDataDirectory();
+  path               = modDataDir.isEmpty() ? path : path + "/" + modDataDir;
+
+  // priorities in the directory structure are one higher because data is 0
+  m_DirectoryRefresher->addModToStructure(
+      m_DirectoryStructure, modInfo->name(),
+      m_CurrentProfile->getModPriority(index) + 1, path, modInfo->stealFiles(),
+      modInfo->archives());
+
+  DirectoryRefresher::cleanStructure(m_DirectoryStructure);
+  m_DirectoryStructure->getFileRegister()->sortOrigins({origin.getID()});
+
+  updateLists({index});
+  clearCaches();
+}
+
 void OrganizerCore::loggedInAction(QWidget* parent, std::function<void()> f)
 {
   if (NexusInterface::instance().getAccessManager()->validated()) {
@@ -1625,10 +1843,7 @@ void OrganizerCore::onDirectoryRefreshed()
   });
 
   log::debug("clearing caches");
-  for (int i = 0; i < m_ModList.rowCount(); ++i) {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-    modInfo->clearCaches();
-  }
+  clearCaches();
 
   // needs to be done before post refresh tasks
   m_DirectoryUpdate = false;
@@ -1642,72 +1857,85 @@ void OrganizerCore::onDirectoryRefreshed()
     refreshLists();
   }
 
+  precomputeMapping();
+
   emit directoryStructureReady();
 
   log::debug("refresh done");
 }
 
-void OrganizerCore::clearCaches(std::vector<unsigned int> const& indices) const
+std::shared_ptr<const ModConflicts> OrganizerCore::modConflicts() const
 {
-  const auto insert = [](auto& dest, const auto& from) {
-    dest.insert(from.begin(), from.end());
-  };
-  std::set<unsigned int> allIndices;
-  for (const auto index : indices) {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+  return m_ModConflicts.value();
+}
 
-    if (m_CurrentProfile->modEnabled(index)) {
-      // if the mod is enabled, we need to first clear its cache so that
-      // getModOverwrite(), ..., returns the newly conflicting mods (in case
-      // the mod just got enabled)
-      modInfo->clearCaches();
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-    } else {
-      // if the mod is disabled, we need to first fetch the conflicting
-      // mods, and then clear the cache
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-      modInfo->clearCaches();
-    }
+std::shared_ptr<const ModConflicts> OrganizerCore::computeModConflicts() const
+{
+  QStringList dataOrigins = {"data"};
+  if (managedGame() != nullptr) {
+    dataOrigins.append(managedGame()->secondaryDataDirectories().keys());
   }
 
-  for (auto& index : allIndices) {
-    ModInfo::getByIndex(index)->clearCaches();
+  return ModConflicts::compute(*m_DirectoryStructure, dataOrigins,
+                               TaskScheduler::global().threadCount());
+}
+
+void OrganizerCore::clearCaches()
+{
+  // the conflicts of all the mods are computed together, so a change in one mod
+  // can change the conflicts of any other; nothing is computed here, the next
+  // mod that is asked for its conflicts computes them again for everybody
+  m_ModConflicts.invalidate();
+
+  for (int i = 0; i < m_ModList.rowCount(); ++i) {
+    ModInfo::getByIndex(i)->clearCaches();
   }
+
+  emit modConflictsInvalidated();
 }
 
-void OrganizerCore::modPrioritiesChanged(const QModelIndexList& indices)
+void OrganizerCore::updateOriginPriorities(std::vector<unsigned int> const& indices)
 {
-  for (unsigned int i = 0; i < currentProfile()->numMods(); ++i) {
-    int priority = currentProfile()->getModPriority(i);
-    if (currentProfile()->modEnabled(i)) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      // priorities in the directory structure are one higher because data is 0
-      directoryStructure()
-          ->getOriginByName(modInfo->internalName())
-          .setPriority(priority + 1);
+  for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
+
+    if (m_DirectoryStructure->originExists(modInfo->internalName())) {
+      // priorities in the directory structure are one higher because data is
+      // 0
+      m_DirectoryStructure->getOriginByName(modInfo->internalName())
+          .setPriority(m_CurrentProfile->getModPriority(i) + 1);
     }
   }
-  refreshBSAList();
-  currentProfile()->writeModlist();
-  directoryStructure()->getFileRegister()->sortOrigins();
 
+  // mods that were not given keep the same priority relative to each other, so
+  // files that are not provided by any of the given mods are still sorted
+  std::set<OriginID> origins;
+
+  for (auto index : indices) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+
+    if (m_DirectoryStructure->originExists(modInfo->internalName())) {
+      origins.insert(
+          m_DirectoryStructure->getOriginByName(modInfo->internalName()).getID());
+    }
+  }
+
+  m_DirectoryStructure->getFileRegister()->sortOrigins(origins);
+}
+
+void OrganizerCore::modPrioritiesChanged(const QModelIndexList& indices)
+{
   std::vector<unsigned int> vindices;
 
   for (auto& idx : indices) {
     vindices.push_back(idx.data(ModList::IndexRole).toInt());
   }
 
-  clearCaches(vindices);
+  updateOriginPriorities(vindices);
+  refreshBSAList();
+  currentProfile()->writeModlist();
+
+  clearCaches();
 }
 
 void OrganizerCore::modStatusChanged(unsigned int index)
@@ -1727,20 +1955,10 @@ void OrganizerCore::modStatusChanged(unsigned int index)
       }
     }
 
-    for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      int priority         = m_CurrentProfile->getModPriority(i);
-      if (m_DirectoryStructure->originExists(modInfo->name())) {
-        // priorities in the directory structure are one higher because data is
-        // 0
-        m_DirectoryStructure->getOriginByName(modInfo->name())
-            .setPriority(priority + 1);
-      }
-    }
-    m_DirectoryStructure->getFileRegister()->sortOrigins();
+    updateOriginPriorities({index});
 
-    refreshLists();
-    clearCaches({index});
+    updateLists({index});
+    clearCaches();
     m_ModList.notifyModStateChanged({index});
 
   } catch (const std::exception& e) {
@@ -1779,20 +1997,10 @@ void OrganizerCore::modStatusChanged(QList<unsigned int> index)
       }
     }
 
-    for (unsigned int i = 0; i < m_CurrentProfile->numMods(); ++i) {
-      ModInfo::Ptr modInfo = ModInfo::getByIndex(i);
-      int priority         = m_CurrentProfile->getModPriority(i);
-      if (m_DirectoryStructure->originExists(modInfo->name())) {
-        // priorities in the directory structure are one higher because data is
-        // 0
-        m_DirectoryStructure->getOriginByName(modInfo->name())
-            .setPriority(priority + 1);
-      }
-    }
-    m_DirectoryStructure->getFileRegister()->sortOrigins();
+    updateOriginPriorities(vindices);
 
-    refreshLists();
-    clearCaches(vindices);
+    updateLists(vindices);
+    clearCaches();
     m_ModList.notifyModStateChanged(index);
 
   } catch (const std::exception& e) {
@@ -2012,7 +2220,8 @@ bool OrganizerCore::beforeRun(
   }
 
   try {
-    m_USVFS.updateMapping(fileMapping(profileName, customOverwrite));
+    auto mapping = fileMapping(profileName, customOverwrite);
+    m_USVFS.updateMapping(mapping, vfsContentToken());
     m_USVFS.updateForcedLibraries(forcedLibraries);
   } catch (const UsvfsConnectorException& e) {
     log::debug("{}", e.what());
@@ -2040,7 +2249,9 @@ void OrganizerCore::afterRun(const QFileInfo& binary, DWORD exitCode)
     QFile::remove(m_CurrentProfile->getLoadOrderFileName());
   }
 
-  refreshDirectoryStructure();
+  if (!updateDirectoryStructureAfterRun()) {
+    refreshDirectoryStructure();
+  }
 
   refreshESPList(true);
   savePluginList();
@@ -2050,6 +2261,54 @@ void OrganizerCore::afterRun(const QFileInfo& binary, DWORD exitCode)
   m_FinishedRun(binary.absoluteFilePath(), exitCode);
 }
 
+bool OrganizerCore::updateDirectoryStructureAfterRun()
+{
+  if (m_DirectoryUpdate || m_CurrentProfile == nullptr) {
+    return false;
+  }
+
+  // the load order depends on the time of the plugins, which can change
+  // without the listings changing
+  if (managedGame()->loadOrderMechanism() ==
+      IPluginGame::LoadOrderMechanism::FileTime) {
+    return false;
+  }
+
+  TimeThis tt("OrganizerCore::updateDirectoryStructureAfterRun()");
+
+  const auto changes =
+      m_DirectoryRefresher->changesSinceRefresh(m_CurrentProfile->getActiveMods());
+
+  if (!changes) {
+    return false;
+  }
+
+  if (changes->empty()) {
+    log::debug("no files were added or removed while running");
+  } else {
+    try {
+      if (!m_DirectoryRefresher->applyChanges(m_DirectoryStructure, *changes)) {
+        return false;
+      }
+    } catch (const std::exception& e) {
+      log::error("failed to update the directory structure: {}", e.what());
+      return false;
+    }
+
+    // a file added to or removed from one mod can change the conflicts of any
+    // other, so the conflicts of every mod are invalidated, not only the ones
+    // of the changed mods
+    m_VirtualFileTree.invalidate();
+    clearCaches();
+  }
+
+  precomputeMapping();
+
+  emit directoryStructureReady();
+
+  return true;
+}
+
 ProcessRunner::Results OrganizerCore::waitForAllUSVFSProcesses(UILocker::Reasons reason)
 {
   return processRunner().waitForAllUSVFSProcessesWithLock(reason);
@@ -2058,55 +2317,44 @@ ProcessRunner::Results OrganizerCore::waitForAllUSVFSProcesses(UILocker::Reasons
 std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
                                                 const QString& customOverwrite)
 {
-  // need to wait until directory structure is ready
-  if (m_DirectoryUpdate) {
-    QEventLoop loop;
-    connect(this, &OrganizerCore::directoryStructureReady, &loop, &QEventLoop::quit,
-            Qt::ConnectionType::QueuedConnection);
-    loop.exec();
-  }
+  // a check started when MO was brought back to the front may still be
+  // running, its result decides whether the precomputed links can be used
+  m_ChangesCheck.waitForFinished();
 
-  IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
-  Profile profile(QDir(m_Settings.paths().profiles() + "/" + profileName), game,
-                  gameFeatures());
-
-  MappingType result;
-
-  auto dataMaps = game->getModMappings();
-
-  bool overwriteActive = false;
-
-  for (const auto& mod : profile.getActiveMods()) {
-    if (std::get<0>(mod).compare("overwrite", Qt::CaseInsensitive) == 0) {
-      continue;
-    }
+  // the current profile is already loaded, any other one is read from disk
+  std::unique_ptr<Profile> otherProfile;
+  const Profile* profile = m_CurrentProfile.get();
 
-    unsigned int modIndex = ModInfo::getIndex(std::get<0>(mod));
-    ModInfo::Ptr modPtr   = ModInfo::getByIndex(modIndex);
+  if (profile == nullptr || profile->name() != profileName) {
+    IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+    otherProfile      = std::make_unique<Profile>(
+        QDir(m_Settings.paths().profiles() + "/" + profileName), game, gameFeatures());
+    profile = otherProfile.get();
+  }
 
-    bool createTarget = customOverwrite == std::get<0>(mod);
-    QDir modDir       = QDir(std::get<1>(mod));
+  const ModMappingInputs inputs = mappingInputs(*profile);
+  ModMapping mods;
 
-    overwriteActive |= createTarget;
+  // the mapping is normally built in the background after every refresh, it
+  // can only be used if nothing has changed since; it only depends on the
+  // mods, not on the directory structure, so a refresh that's still running
+  // doesn't need to be waited for
+  if (m_PrecomputedMapping.isValid()) {
+    mods = m_PrecomputedMapping.result();
+  }
 
-    if (modPtr->isRegular()) {
-      for (auto dataMap : dataMaps.asKeyValueRange()) {
-        auto mapDir = QDir(modDir.absoluteFilePath(dataMap.first));
-        if (mapDir.exists()) {
-          for (auto dir : dataMap.second) {
-            result.insert(result.end(),
-                          {mapDir.absolutePath(), dir, true, createTarget});
-          }
-        }
-      }
-    }
+  if (mods.token != inputs.token()) {
+    log::debug("mod mapping is out of date, building it now");
+    mods = ModMapping::build(inputs);
   }
 
-  if (!overwriteActive && !customOverwrite.isEmpty()) {
+  if (!mods.setWriteTarget(customOverwrite)) {
     throw MyException(
         tr("The designated write target \"%1\" is not enabled.").arg(customOverwrite));
   }
 
+  MappingType result = std::move(mods.modLinks);
+
   if (m_CurrentProfile->localSavesEnabled()) {
     auto localSaves = gameFeatures().gameFeature<LocalSavegames>();
     if (localSaves != nullptr) {
@@ -2119,16 +2367,7 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
     }
   }
 
-  QDir overwriteDir(m_Settings.paths().overwrite());
-  for (auto dataMap : dataMaps.asKeyValueRange()) {
-    auto overwriteSubpath = overwriteDir.absoluteFilePath(dataMap.first);
-    if (QDir(overwriteSubpath).exists()) {
-      for (auto dir : dataMap.second) {
-        result.insert(result.end(),
-                      {overwriteSubpath, dir, true, customOverwrite.isEmpty()});
-      }
-    }
-  }
+  result.insert(result.end(), mods.overwriteLinks.begin(), mods.overwriteLinks.end());
 
   for (MOBase::IPluginFileMapper* mapper :
        m_PluginContainer->plugins<MOBase::IPluginFileMapper>()) {
@@ -3,6 +3,7 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QFuture>
 #include <QList>
 #include <QObject>
 #include <QSettings>
@@ -36,6 +37,7 @@
 #include "selfupdater.h"
 #include "settings.h"
 #include "uilocker.h"
+#include "vfsmapping.h"
 
 #ifdef _WIN32
 #include "win32/usvfsconnector.h"
@@ -50,6 +52,7 @@ class IUserInterface;
 class GameFeatures;
 class PluginContainer;
 class DirectoryRefresher;
+class ModConflicts;
 
 #include <memory>
 #include <vector>
@@ -269,6 +272,11 @@ public:
   InstallationManager* installationManager();
   MOShared::DirectoryEntry* directoryStructure() { return m_DirectoryStructure; }
   DirectoryRefresher* directoryRefresher() { return m_DirectoryRefresher.get(); }
+
+  // conflicts of every mod, computed on first use after the directory
+  // structure changes
+  //
+  std::shared_ptr<const ModConflicts> modConflicts() const;
   ExecutablesList* executablesList() { return &m_ExecutablesList; }
   void setExecutablesList(const ExecutablesList& executablesList)
   {
@@ -325,10 +333,24 @@ public:
   void refreshESPList(bool force = false);
   void refreshBSAList();
 
+  // updates the plugins of the given mods in the plugin list instead of
+  // refreshing the whole list, used when mods are enabled, disabled or reloaded
+  //
+  void updateESPList(const std::vector<unsigned int>& modIndices);
+
+  // same as refreshLists(), but only updates the plugins of the given mods
+  //
+  void updateLists(const std::vector<unsigned int>& modIndices);
+
   void refreshDirectoryStructure();
   void updateModInDirectoryStructure(unsigned int index, ModInfo::Ptr modInfo);
   void updateModsInDirectoryStructure(QMap<unsigned int, ModInfo::Ptr> modInfos);
 
+  // removes the files of the given mod from the directory structure and adds
+  // them back from disk, leaving the rest of the structure untouched
+  //
+  void reloadModInDirectoryStructure(unsigned int index);
+
   void doAfterLogin(const std::function<void()>& function)
   {
     m_PostLoginTasks.append(function);
@@ -397,6 +419,18 @@ public:
   QStringList listDirectories(const QString& directoryName) const;
   QStringList findFiles(const QString& path,
                         const std::function<bool(const QString&)>& filter) const;
+
+  // files directly in the given directory that match any of the glob patterns,
+  // looked up in the indices of the directory structure
+  //
+  QStringList findFiles(const QString& path, const QStringList& globFilters) const;
+
+  // same as above for several directories, the patterns are only prepared once;
+  // returns one list per path
+  //
+  std::vector<QStringList> findFiles(const QStringList& paths,
+                                     const QStringList& globFilters) const;
+
   QStringList getFileOrigins(const QString& fileName) const;
   QList<MOBase::IOrganizer::FileInfo> findFileInfos(
       const QString& path,
@@ -498,6 +532,11 @@ signals:
   // Notify of a general UI refresh
   void refreshTriggered();
 
+  // emitted when the conflicts of the mods have to be computed again, which
+  // can change the conflicts of any mod, not only the ones that changed
+  //
+  void modConflictsInvalidated();
+
 private:
   std::pair<unsigned int, ModInfo::Ptr> doInstall(const QString& archivePath,
                                                   MOBase::GuessedValue<QString> modName,
@@ -510,10 +549,37 @@ private:
   void updateModActiveState(int index, bool active);
   void updateModsActiveState(const QList<unsigned int>& modIndices, bool active);
 
-  // clear the conflict caches of all the given mods, and the mods in conflict
-  // with the given mods
+  // forgets the conflicts of every mod, they're computed again in one pass the
+  // next time they're needed
   //
-  void clearCaches(std::vector<unsigned int> const& indices) const;
+  // this used to only clear the caches of the given mods and of the mods in
+  // conflict with them, but finding the latter meant computing the new
+  // conflicts right away; a single lazy pass over every mod is cheaper than
+  // that, so every change invalidates everything
+  //
+  void clearCaches();
+
+  // computes the conflicts of every mod for the current directory structure
+  //
+  std::shared_ptr<const ModConflicts> computeModConflicts() const;
+
+  // the given directory of the structure, "" and "." are the root
+  //
+  MOShared::DirectoryEntry* findDirectory(const QString& path) const;
+
+  // adds and removes the loose files that were created or deleted while a
+  // program was running instead of rebuilding the whole structure, only the
+  // origins whose directories have changed are listed again
+  //
+  // returns false if the structure must be refreshed instead
+  //
+  bool updateDirectoryStructureAfterRun();
+
+  // updates the priority of the origins of all mods from the current profile
+  // and re-sorts the files provided by the given mods, which are the only ones
+  // whose alternatives can be out of order
+  //
+  void updateOriginPriorities(std::vector<unsigned int> const& indices);
 
   bool createDirectory(const QString& path);
 
@@ -530,6 +596,27 @@ private:
                                    const MOShared::DirectoryEntry* directoryEntry,
                                    int createDestination);
 
+  // changes whenever the files behind the mapping may have changed on disk
+  // without the mapping itself changing
+  //
+  std::size_t vfsContentToken() const;
+
+  // captures what the links of the mods and overwrite depend on for the given
+  // profile
+  //
+  ModMappingInputs mappingInputs(const Profile& profile) const;
+
+  // starts building the links of the mods and overwrite for the current
+  // profile in the background, so they're ready when a program is started
+  //
+  void precomputeMapping();
+
+  // checks in the background whether the directories of the last refresh
+  // changed on disk, such as when files are added to a mod outside of MO, so
+  // vfsContentToken() doesn't have to
+  //
+  void checkForChanges();
+
 private slots:
 
   void onDirectoryRefreshed();
@@ -580,8 +667,11 @@ private:
   QStringList m_ActiveArchives;
 
   std::unique_ptr<DirectoryRefresher> m_DirectoryRefresher;
+  QFuture<ModMapping> m_PrecomputedMapping;
+  QFuture<void> m_ChangesCheck;
   MOShared::DirectoryEntry* m_DirectoryStructure;
   MOBase::MemoizedLocked<std::shared_ptr<const MOBase::IFileTree>> m_VirtualFileTree;
+  mutable MOBase::MemoizedLocked<std::shared_ptr<const ModConflicts>> m_ModConflicts;
 
   DownloadManager m_DownloadManager;
   InstallationManager m_InstallationManager;
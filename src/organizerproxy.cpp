@@ -3,7 +3,6 @@
 #include "downloadmanagerproxy.h"
 #include "executableslistproxy.h"
 #include "gamefeaturesproxy.h"
-#include "glob_matching.h"
 #include "instancemanager.h"
 #include "instancemanagerproxy.h"
 #include "modlistproxy.h"
@@ -325,18 +324,7 @@ OrganizerProxy::findFiles(const QString& path,
 QStringList OrganizerProxy::findFiles(const QString& path,
                                       const QStringList& globFilters) const
 {
-  QList<GlobPattern<QChar>> patterns;
-  for (auto& gfilter : globFilters) {
-    patterns.append(GlobPattern(gfilter));
-  }
-  return findFiles(path, [&patterns](const QString& filename) {
-    for (auto& p : patterns) {
-      if (p.match(filename)) {
-        return true;
-      }
-    }
-    return false;
-  });
+  return m_Proxied->findFiles(path, globFilters);
 }
 
 QStringList OrganizerProxy::getFileOrigins(const QString& fileName) const
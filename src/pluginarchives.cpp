@@ -0,0 +1,57 @@
+#include "pluginarchives.h"
+#include <algorithm>
+
+DataFileType dataFileType(QStringView name)
+{
+  // all the extensions have three characters
+  if (name.size() < 4 || name[name.size() - 4] != u'.') {
+    return DataFileType::Other;
+  }
+
+  const QStringView ext = name.last(3);
+
+  auto is = [&](QStringView e) {
+    return ext.compare(e, Qt::CaseInsensitive) == 0;
+  };
+
+  if (is(u"esp") || is(u"esm") || is(u"esl")) {
+    return DataFileType::Plugin;
+  } else if (is(u"bsa") || is(u"ba2")) {
+    return DataFileType::Archive;
+  }
+
+  return DataFileType::Other;
+}
+
+ArchivePrefixIndex::ArchivePrefixIndex(const QStringList& archives)
+{
+  m_Archives.reserve(archives.size());
+
+  for (const auto& a : archives) {
+    m_Archives.push_back({a.toCaseFolded(), a});
+  }
+
+  std::sort(m_Archives.begin(), m_Archives.end(), [](auto&& a, auto&& b) {
+    return a.folded < b.folded;
+  });
+}
+
+std::set<QString> ArchivePrefixIndex::withPrefix(QStringView prefix) const
+{
+  const QString folded = prefix.toString().toCaseFolded();
+
+  // every name starting with the prefix sorts after the prefix itself and
+  // before the first name that doesn't start with it
+  auto itor = std::lower_bound(m_Archives.begin(), m_Archives.end(), folded,
+                               [](auto&& a, const QString& p) {
+                                 return a.folded < p;
+                               });
+
+  std::set<QString> result;
+
+  for (; itor != m_Archives.end() && itor->folded.startsWith(folded); ++itor) {
+    result.insert(itor->name);
+  }
+
+  return result;
+}
@@ -0,0 +1,50 @@
+#ifndef MODORGANIZER_PLUGINARCHIVES_INCLUDED
+#define MODORGANIZER_PLUGINARCHIVES_INCLUDED
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <set>
+#include <vector>
+
+// files in the data directory the plugin list cares about
+//
+enum class DataFileType
+{
+  Other,
+
+  // .esp, .esm and .esl
+  Plugin,
+
+  // .bsa and .ba2
+  Archive
+};
+
+// classifies the file from its extension, case insensitive
+//
+DataFileType dataFileType(QStringView name);
+
+// archives of the data directory sorted by their case-folded name, so the
+// archives loaded by a plugin, which are the ones whose name starts with the
+// name of the plugin, are a range that's found with a binary search
+//
+class ArchivePrefixIndex
+{
+public:
+  explicit ArchivePrefixIndex(const QStringList& archives);
+
+  // archives whose name starts with the given prefix, case insensitive
+  //
+  std::set<QString> withPrefix(QStringView prefix) const;
+
+private:
+  struct Archive
+  {
+    QString folded;
+    QString name;
+  };
+
+  std::vector<Archive> m_Archives;
+};
+
+#endif  // MODORGANIZER_PLUGINARCHIVES_INCLUDED
@@ -0,0 +1,79 @@
+#include "pluginheadercache.h"
+#include "taskscheduler.h"
+#include <QDataStream>
+#include <esptk/espfile.h>
+#include <utility.h>
+
+using namespace MOBase;
+using namespace MOShared;
+
+namespace
+{
+
+constexpr quint32 Magic = 0x4d4f5048;  // "MOPH"
+
+}  // namespace
+
+QDataStream& operator<<(QDataStream& s, const PluginHeader& h)
+{
+  return s << h.isMaster << h.isMedium << h.isBlueprint << h.isDummy << h.isLight
+           << h.isLightWithMedium << h.formVersion << h.headerVersion << h.author
+           << h.description << h.masters;
+}
+
+QDataStream& operator>>(QDataStream& s, PluginHeader& h)
+{
+  return s >> h.isMaster >> h.isMedium >> h.isBlueprint >> h.isDummy >> h.isLight >>
+         h.isLightWithMedium >> h.formVersion >> h.headerVersion >> h.author >>
+         h.description >> h.masters;
+}
+
+PluginHeader PluginHeader::read(const QString& path)
+{
+  ESP::File file(ToWString(path));
+
+  PluginHeader h;
+  h.isMaster          = file.isMaster();
+  h.isMedium          = file.isMedium();
+  h.isBlueprint       = file.isBlueprint();
+  h.isDummy           = file.isDummy();
+  h.isLight           = file.isLight(false);
+  h.isLightWithMedium = file.isLight(true);
+  h.formVersion       = file.formVersion();
+  h.headerVersion     = file.headerVersion();
+  h.author            = QString::fromLatin1(file.author().c_str());
+  h.description       = QString::fromLatin1(file.description().c_str());
+
+  for (auto&& m : file.masters()) {
+    h.masters.append(QString::fromStdString(m));
+  }
+
+  return h;
+}
+
+PluginHeaderCache::PluginHeaderCache()
+    : FileCache(Magic, FormatVersion, QStringLiteral("plugin header cache"))
+{}
+
+std::vector<PluginHeaderCache::Result>
+PluginHeaderCache::get(const std::vector<QString>& paths)
+{
+  std::vector<Result> results(paths.size());
+
+  const auto headers = FileCache::get(
+      paths, TaskScheduler::global().threadCount(),
+      [&](std::size_t i) -> std::shared_ptr<const PluginHeader> {
+        try {
+          return std::make_shared<PluginHeader>(PluginHeader::read(paths[i]));
+        } catch (const std::exception& e) {
+          results[i].error = QString::fromStdString(e.what());
+          return {};
+        }
+      });
+
+  for (std::size_t i = 0; i < paths.size(); ++i) {
+    results[i].header = headers[i];
+  }
+
+  return results;
+}
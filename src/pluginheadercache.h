@@ -0,0 +1,69 @@
+#ifndef MODORGANIZER_PLUGINHEADERCACHE_INCLUDED
+#define MODORGANIZER_PLUGINHEADERCACHE_INCLUDED
+
+#include "filecache.h"
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+// what the plugin list needs from the header of a plugin
+//
+struct PluginHeader
+{
+  bool isMaster    = false;
+  bool isMedium    = false;
+  bool isBlueprint = false;
+  bool isDummy     = false;
+
+  // whether the light flag is set, depending on whether the game supports
+  // medium plugins, which use the same bits
+  bool isLight           = false;
+  bool isLightWithMedium = false;
+
+  int formVersion     = 0;
+  float headerVersion = 0;
+
+  QString author;
+  QString description;
+  QStringList masters;
+
+  // parses the header of the given file, throws on failure
+  //
+  static PluginHeader read(const QString& path);
+};
+
+QDataStream& operator<<(QDataStream& s, const PluginHeader& h);
+QDataStream& operator>>(QDataStream& s, PluginHeader& h);
+
+/**
+ * @brief on-disk cache of the headers of plugins, so plugins that haven't
+ * changed don't have to be opened when the plugin list is refreshed
+ *
+ * plugins that fail to parse are not cached, they're reported every time
+ *
+ * this must only be used from one thread at a time
+ **/
+class PluginHeaderCache : public FileCache<PluginHeader>
+{
+public:
+  // bumped every time the format of the file changes, files with a different
+  // version are ignored
+  static constexpr quint32 FormatVersion = 1;
+
+  struct Result
+  {
+    // null if the plugin couldn't be parsed
+    std::shared_ptr<const PluginHeader> header;
+    QString error;
+  };
+
+  PluginHeaderCache();
+
+  /**
+   * @brief returns the header of each of the given plugins, in the same order
+   **/
+  std::vector<Result> get(const std::vector<QString>& paths);
+};
+
+#endif  // MODORGANIZER_PLUGINHEADERCACHE_INCLUDED
@@ -20,6 +20,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
 #include <ctime>
+#include <numeric>
 #include <stdexcept>
 
 #include <QApplication>
@@ -37,7 +38,6 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QString>
 #include <QtDebug>
 
-#include <esptk/espfile.h>
 #include <uibase/iplugingame.h>
 #include <uibase/report.h>
 #include <uibase/safewritefile.h>
@@ -48,6 +48,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modinfo.h"
 #include "modlist.h"
 #include "organizercore.h"
+#include "pluginarchives.h"
 #include "settings.h"
 #include "shared/directoryentry.h"
 #include "shared/fileentry.h"
@@ -216,21 +217,11 @@ void PluginList::refresh(const QString& profileName,
 
   ChangeBracket<PluginList> layoutChange(this);
 
-  QStringList primaryPlugins = m_GamePlugin->primaryPlugins();
-  QStringList enabledPlugins = m_GamePlugin->enabledPlugins();
-  auto gamePlugins           = m_Organizer.gameFeatures().gameFeature<GamePlugins>();
-  const bool lightPluginsAreSupported =
-      gamePlugins ? gamePlugins->lightPluginsAreSupported() : false;
-  const bool mediumPluginsAreSupported =
-      gamePlugins ? gamePlugins->mediumPluginsAreSupported() : false;
-  const bool blueprintPluginsAreSupported =
-      gamePlugins ? gamePlugins->blueprintPluginsAreSupported() : false;
-  const bool loadOrderMechanismNone =
-      m_GamePlugin->loadOrderMechanism() == IPluginGame::LoadOrderMechanism::None;
-  const QString& blueprintPrefix = m_GamePlugin->blueprintPrefix();
+  const GameSupport game = gameSupport();
+  auto gamePlugins       = m_Organizer.gameFeatures().gameFeature<GamePlugins>();
 
   m_CurrentProfile   = profileName;
-  m_BlueprintPlugins = blueprintPluginsAreSupported;
+  m_BlueprintPlugins = game.blueprintPlugins;
 
   std::unordered_map<QString, FileEntryPtr> availablePlugins;
   QStringList archiveCandidates;
@@ -241,60 +232,55 @@ void PluginList::refresh(const QString& profileName,
     }
     const QString& filename = current->getName();
 
-    if (filename.endsWith(".esp", Qt::CaseInsensitive) ||
-        filename.endsWith(".esm", Qt::CaseInsensitive) ||
-        filename.endsWith(".esl", Qt::CaseInsensitive)) {
+    switch (dataFileType(filename)) {
+    case DataFileType::Plugin:
       availablePlugins.insert(std::make_pair(filename, current));
-    } else if (filename.endsWith(".bsa", Qt::CaseInsensitive) ||
-               filename.endsWith("ba2", Qt::CaseInsensitive)) {
+      break;
+
+    case DataFileType::Archive:
       archiveCandidates.append(filename);
+      break;
+
+    case DataFileType::Other:
+      break;
     }
   }
 
+  const ArchivePrefixIndex archiveIndex(archiveCandidates);
+
+  // plugins that are not in the list yet, their headers are read in one go
+  std::vector<FileEntryPtr> newPlugins;
+  std::vector<QString> newPaths;
+
   for (const auto& [filename, current] : availablePlugins) {
     if (m_ESPsByName.contains(filename)) {
       continue;
     }
 
-    bool forceLoaded   = Settings::instance().game().forceEnableCoreFiles() &&
-                         primaryPlugins.contains(filename, Qt::CaseInsensitive);
-    bool forceEnabled  = enabledPlugins.contains(filename, Qt::CaseInsensitive);
-    bool forceDisabled = loadOrderMechanismNone && !forceLoaded && !forceEnabled;
-    if (!lightPluginsAreSupported && filename.endsWith(".esl")) {
-      forceDisabled = true;
-    }
+    newPlugins.push_back(current);
+    newPaths.push_back(current->getFullPath());
+  }
 
-    bool archive = false;
-    try {
-      FilesOrigin& origin = baseDirectory.getOriginByID(current->getOrigin(archive));
+  const auto headers = readHeaders(newPaths);
 
-      // name without extension
-      QString baseName = QFileInfo(filename).completeBaseName();
+  if (force) {
+    // every plugin was asked for
+    m_HeaderCache.removeUnseen();
+  }
 
-      QString iniPath = baseName + ".ini";
-      bool hasIni     = baseDirectory.findFile(iniPath).get() != nullptr;
-      std::set<QString> loadedArchives;
-      for (const auto& archiveName : archiveCandidates) {
-        if (archiveName.startsWith(baseName, Qt::CaseInsensitive)) {
-          loadedArchives.insert(archiveName);
-        }
-      }
+  m_HeaderCache.save(headerCachePath());
 
-      QString originName    = origin.getName();
-      unsigned int modIndex = ModInfo::getIndex(originName);
-      if (modIndex != UINT_MAX) {
-        ModInfo::Ptr modInfo = ModInfo::getByIndex(modIndex);
-        originName           = modInfo->name();
-      }
+  for (std::size_t i = 0; i < newPlugins.size(); ++i) {
+    const auto& current = newPlugins[i];
 
-      m_ESPs.emplace_back(filename, forceLoaded, forceEnabled, forceDisabled,
-                          originName, current->getFullPath(), hasIni, loadedArchives,
-                          lightPluginsAreSupported, mediumPluginsAreSupported,
-                          blueprintPluginsAreSupported, blueprintPrefix);
+    try {
+      m_ESPs.push_back(
+          createInfo(game, baseDirectory, current, archiveIndex, headers[i]));
       m_ESPs.rbegin()->priority = -1;
     } catch (const std::exception& e) {
+      bool archive = false;
       reportError(tr("failed to update esp info for file %1 (source id: %2), error: %3")
-                      .arg(filename)
+                      .arg(current->getName())
                       .arg(current->getOrigin(archive))
                       .arg(e.what()));
     }
@@ -338,6 +324,267 @@ void PluginList::refresh(const QString& profileName,
   m_Refreshed();
 }
 
+PluginList::Changes PluginList::changes(const DirectoryEntry& baseDirectory,
+                                        const QStringList& files) const
+{
+  Changes changes;
+
+  // plugins that are in one of the lists, a plugin is only listed once
+  std::set<QString, FileNameComparator> listed;
+
+  for (const auto& file : files) {
+    if (dataFileType(file) != DataFileType::Plugin || listed.contains(file)) {
+      continue;
+    }
+
+    const FileEntryPtr entry = baseDirectory.findFile(file);
+    const auto iter          = m_ESPsByName.find(file);
+
+    if (iter == m_ESPsByName.end()) {
+      if (entry.get() != nullptr) {
+        changes.added.append(entry->getName());
+        listed.insert(file);
+      }
+    } else if (entry.get() == nullptr) {
+      changes.removed.append(m_ESPs[iter->second].name);
+      listed.insert(file);
+    } else if (entry->getFullPath() != m_ESPs[iter->second].fullPath) {
+      changes.changed.append(m_ESPs[iter->second].name);
+      listed.insert(file);
+    }
+  }
+
+  // the archives loaded by a plugin start with its name and its ini has the
+  // same name, so these plugins might have changed even if their file hasn't
+  for (const auto& file : files) {
+    const bool archive = (dataFileType(file) == DataFileType::Archive);
+    if (!archive && !file.endsWith(".ini", Qt::CaseInsensitive)) {
+      continue;
+    }
+
+    // extensions of plugins, archives and inis all have three letters
+    const QStringView fileBase = QStringView(file).chopped(4);
+
+    for (const auto& esp : m_ESPs) {
+      const QStringView espBase = QStringView(esp.name).chopped(4);
+
+      const bool affected =
+          archive ? fileBase.startsWith(espBase, Qt::CaseInsensitive)
+                  : (fileBase.compare(espBase, Qt::CaseInsensitive) == 0);
+
+      if (affected && listed.insert(esp.name).second) {
+        changes.changed.append(esp.name);
+      }
+    }
+  }
+
+  return changes;
+}
+
+void PluginList::update(const DirectoryEntry& baseDirectory, const Changes& changes)
+{
+  if (changes.empty()) {
+    return;
+  }
+
+  TimeThis tt("PluginList::update()");
+
+  // priority and mod index of each row before the update, the rows where they
+  // change are updated in the views along with the affected plugins
+  std::vector<std::pair<int, QString>> before;
+  before.reserve(m_ESPs.size());
+
+  for (const auto& esp : m_ESPs) {
+    before.emplace_back(esp.priority, esp.index);
+  }
+
+  // all the plugins in the changes, the plugins that have one of them as a
+  // master are affected too
+  std::set<QString, FileNameComparator> names;
+
+  for (const auto& name : changes.removed) {
+    names.insert(name);
+
+    const auto iter = m_ESPsByName.find(name);
+    if (iter == m_ESPsByName.end()) {
+      continue;
+    }
+
+    const int row      = iter->second;
+    const int priority = m_ESPs[row].priority;
+
+    beginRemoveRows(QModelIndex(), row, row);
+
+    m_ESPs.erase(m_ESPs.begin() + row);
+    before.erase(before.begin() + row);
+
+    // closes the gap in the priorities
+    for (auto& esp : m_ESPs) {
+      if (esp.priority > priority) {
+        --esp.priority;
+      }
+    }
+
+    updateLookups();
+    endRemoveRows();
+  }
+
+  // added and changed plugins, their headers are read in one go
+  std::vector<FileEntryPtr> files;
+  std::vector<QString> paths;
+
+  for (const auto* list : {&changes.added, &changes.changed}) {
+    for (const auto& name : *list) {
+      names.insert(name);
+
+      const FileEntryPtr file = baseDirectory.findFile(name);
+      if (file.get() != nullptr) {
+        files.push_back(file);
+        paths.push_back(file->getFullPath());
+      }
+    }
+  }
+
+  // rows whose position and masters are checked
+  std::vector<int> rows;
+  std::vector<ESPInfo> created;
+
+  if (!files.empty()) {
+    const auto headers = readHeaders(paths);
+    m_HeaderCache.save(headerCachePath());
+
+    QStringList archiveNames;
+    for (const auto index : baseDirectory.findFiles(FileQuery({"*.bsa", "*.ba2"}))) {
+      if (const FileEntryPtr file = baseDirectory.getFileByIndex(index)) {
+        archiveNames.append(file->getName());
+      }
+    }
+
+    const ArchivePrefixIndex archiveIndex(archiveNames);
+    const GameSupport game = gameSupport();
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      const auto& file = files[i];
+
+      try {
+        ESPInfo info = createInfo(game, baseDirectory, file, archiveIndex, headers[i]);
+
+        const auto iter = m_ESPsByName.find(info.name);
+        if (iter == m_ESPsByName.end()) {
+          created.push_back(std::move(info));
+          continue;
+        }
+
+        // still the same plugin as far as the profile is concerned
+        ESPInfo& esp = m_ESPs[iter->second];
+
+        info.enabled = info.forceLoaded || info.forceEnabled ||
+                       (esp.enabled && !info.forceDisabled);
+        info.priority                 = esp.priority;
+        info.loadOrder                = esp.loadOrder;
+        info.index                    = esp.index;
+        info.modSelected              = esp.modSelected;
+        info.isMasterOfSelectedPlugin = esp.isMasterOfSelectedPlugin;
+
+        esp = std::move(info);
+        rows.push_back(iter->second);
+      } catch (const std::exception& e) {
+        bool archive = false;
+        reportError(
+            tr("failed to update esp info for file %1 (source id: %2), error: %3")
+                .arg(file->getName())
+                .arg(file->getOrigin(archive))
+                .arg(e.what()));
+      }
+    }
+  }
+
+  if (!created.empty()) {
+    const int first = static_cast<int>(m_ESPs.size());
+    beginInsertRows(QModelIndex(), first,
+                    first + static_cast<int>(created.size()) - 1);
+
+    // at the bottom, until the lists of the profile are read
+    for (auto& info : created) {
+      info.priority = static_cast<int>(m_ESPs.size());
+      rows.push_back(info.priority);
+      m_ESPs.push_back(std::move(info));
+      before.emplace_back(-1, QString());
+    }
+
+    updateLookups();
+    endInsertRows();
+
+    // new plugins get their state and position from the lists of the profile,
+    // like in a refresh
+    auto gamePlugins = m_Organizer.gameFeatures().gameFeature<GamePlugins>();
+    if (gamePlugins) {
+      gamePlugins->readPluginLists(m_Organizer.managedGameOrganizer()->pluginList());
+    }
+  }
+
+  // plugins that have one of the changed plugins as a master
+  for (int i = 0; i < static_cast<int>(m_ESPs.size()); ++i) {
+    for (const auto& master : m_ESPs[i].masters) {
+      if (names.contains(master)) {
+        rows.push_back(i);
+        break;
+      }
+    }
+  }
+
+  std::ranges::sort(rows);
+  rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+  if (!created.empty()) {
+    fixPrimaryPlugins();
+  }
+
+  fixPluginRelationships(rows);
+  testMasters(rows);
+
+  updateIndices();
+
+  syncLoadOrder();
+  if (applyLockedOrder()) {
+    emit writePluginsList();
+  }
+
+  // the affected rows and the rows whose priority or mod index changed
+  std::vector<bool> dirty(m_ESPs.size(), false);
+
+  for (const int row : rows) {
+    dirty[row] = true;
+  }
+
+  for (std::size_t i = 0; i < m_ESPs.size(); ++i) {
+    if (before[i].first != m_ESPs[i].priority || before[i].second != m_ESPs[i].index) {
+      dirty[i] = true;
+    }
+  }
+
+  for (int i = 0; i < static_cast<int>(dirty.size());) {
+    if (!dirty[i]) {
+      ++i;
+      continue;
+    }
+
+    int last = i;
+    while (last + 1 < static_cast<int>(dirty.size()) && dirty[last + 1]) {
+      ++last;
+    }
+
+    emit dataChanged(index(i, 0), index(last, columnCount() - 1));
+    i = last + 1;
+  }
+
+  log::debug("plugin list updated: {} added, {} removed, {} changed, {} rows checked",
+             created.size(), changes.removed.size(), changes.changed.size(),
+             rows.size());
+
+  m_Refreshed();
+}
+
 void PluginList::fixPrimaryPlugins()
 {
   if (!m_Organizer.settings().game().forceEnableCoreFiles()) {
@@ -349,7 +596,7 @@ void PluginList::fixPrimaryPlugins()
   int prio                   = 0;
   int prioBlueprint          = 0;
   bool somethingChanged      = false;
-  for (auto esp : m_ESPs) {
+  for (const auto& esp : m_ESPs) {
     if (!esp.isBlueprintFlagged)
       prioBlueprint++;
   }
@@ -383,6 +630,14 @@ void PluginList::fixPrimaryPlugins()
 }
 
 void PluginList::fixPluginRelationships()
+{
+  std::vector<int> rows(m_ESPs.size());
+  std::iota(rows.begin(), rows.end(), 0);
+
+  fixPluginRelationships(rows);
+}
+
+void PluginList::fixPluginRelationships(const std::vector<int>& rows)
 {
   TimeThis timer("PluginList::fixPluginRelationships");
 
@@ -390,7 +645,7 @@ void PluginList::fixPluginRelationships()
   int standardCount        = 0;
   int masterCount          = 0;
   int blueprintMasterCount = 0;
-  for (auto plugin : m_ESPs) {
+  for (const auto& plugin : m_ESPs) {
     if (plugin.hasLightExtension || plugin.hasMasterExtension ||
         plugin.isMasterFlagged) {
       if (plugin.isBlueprintFlagged) {
@@ -405,7 +660,7 @@ void PluginList::fixPluginRelationships()
   }
 
   // Ensure masters are up top and normal plugins are down below
-  for (int i = 0; i < m_ESPs.size(); i++) {
+  for (const int i : rows) {
     ESPInfo& plugin = m_ESPs[i];
     if (plugin.hasLightExtension || plugin.hasMasterExtension ||
         plugin.isMasterFlagged) {
@@ -436,7 +691,7 @@ void PluginList::fixPluginRelationships()
   }
 
   // Ensure master/child relationships are observed
-  for (int i = 0; i < m_ESPs.size(); i++) {
+  for (const int i : rows) {
     ESPInfo& plugin = m_ESPs[i];
     int newPriority = plugin.priority;
     for (auto master : plugin.masters) {
@@ -926,6 +1181,13 @@ void PluginList::refreshLoadOrder()
 {
   ChangeBracket<PluginList> layoutChange(this);
   syncLoadOrder();
+  if (applyLockedOrder()) {
+    emit writePluginsList();
+  }
+}
+
+bool PluginList::applyLockedOrder()
+{
   // set priorities according to locked load order
   std::map<int, QString> lockedLoadOrder;
   std::ranges::for_each(m_LockedOrder,
@@ -961,9 +1223,7 @@ void PluginList::refreshLoadOrder()
       }
     }
   }
-  if (savePluginsList) {
-    emit writePluginsList();
-  }
+  return savePluginsList;
 }
 
 void PluginList::disconnectSlots()
@@ -1264,6 +1524,12 @@ PluginList::onPluginMoved(const std::function<void(const QString&, int, int)>& f
 }
 
 void PluginList::updateIndices()
+{
+  updateLookups();
+  generatePluginIndexes();
+}
+
+void PluginList::updateLookups()
 {
   m_ESPsByName.clear();
   m_ESPsByPriority.clear();
@@ -1279,8 +1545,6 @@ void PluginList::updateIndices()
     m_ESPsByName[m_ESPs[i].name]                                 = i;
     m_ESPsByPriority.at(static_cast<size_t>(m_ESPs[i].priority)) = i;
   }
-
-  generatePluginIndexes();
 }
 
 void PluginList::generatePluginIndexes()
@@ -1365,6 +1629,25 @@ void PluginList::testMasters()
   }
 }
 
+void PluginList::testMasters(const std::vector<int>& rows)
+{
+  for (const int row : rows) {
+    auto& esp = m_ESPs[row];
+
+    esp.masterUnset.clear();
+    if (!esp.enabled) {
+      continue;
+    }
+
+    for (const auto& master : esp.masters) {
+      const auto iter = m_ESPsByName.find(master);
+      if (iter == m_ESPsByName.end() || !m_ESPs[iter->second].enabled) {
+        esp.masterUnset.insert(master);
+      }
+    }
+  }
+}
+
 QVariant PluginList::data(const QModelIndex& modelIndex, int role) const
 {
   int index = modelIndex.row();
@@ -1940,7 +2223,7 @@ void PluginList::setPluginPriority(int row, int& newPriority, bool isForced)
     newPriorityTemp = static_cast<int>(m_ESPsByPriority.size()) - 1;
 
   int blueprintStartPos = 0;
-  for (auto esp : m_ESPs) {
+  for (const auto& esp : m_ESPs) {
     if (!esp.isBlueprintFlagged) {
       blueprintStartPos++;
     }
@@ -2134,27 +2417,28 @@ PluginList::ESPInfo::ESPInfo(const QString& name, bool forceLoaded, bool forceEn
                              const QString& fullPath, bool hasIni,
                              std::set<QString> archives, bool lightSupported,
                              bool mediumSupported, bool blueprintSupported,
-                             const QString& blueprintPrefix)
+                             const QString& blueprintPrefix,
+                             const PluginHeaderCache::Result& header)
     : name(name), fullPath(fullPath), enabled(forceLoaded), forceLoaded(forceLoaded),
       forceEnabled(forceEnabled), forceDisabled(forceDisabled), priority(0),
       loadOrder(-1), originName(originName), modSelected(false),
       isMasterOfSelectedPlugin(false), hasIni(hasIni),
       archives(archives.begin(), archives.end())
 {
-  try {
-    ESP::File file(ToWString(fullPath));
+  if (const auto& file = header.header) {
     auto extension     = name.right(3).toLower();
     hasMasterExtension = (extension == "esm");
     hasLightExtension  = (extension == "esl");
-    isMasterFlagged    = file.isMaster();
-    isLightFlagged     = lightSupported && file.isLight(mediumSupported);
-    isMediumFlagged    = mediumSupported && file.isMedium();
+    isMasterFlagged    = file->isMaster;
+    isLightFlagged =
+        lightSupported && (mediumSupported ? file->isLightWithMedium : file->isLight);
+    isMediumFlagged    = mediumSupported && file->isMedium;
     isBlueprintFlagged = blueprintSupported &&
                          (isMasterFlagged || hasMasterExtension || hasLightExtension) &&
-                         file.isBlueprint();
+                         file->isBlueprint;
     isBlueprintPrefixed =
         blueprintSupported && name.startsWith(blueprintPrefix, Qt::CaseInsensitive);
-    hasNoRecords = file.isDummy();
+    hasNoRecords = file->isDummy;
 
     if (blueprintSupported) {
       if ((isBlueprintFlagged || isBlueprintPrefixed) && !this->forceEnabled) {
@@ -2162,18 +2446,16 @@ PluginList::ESPInfo::ESPInfo(const QString& name, bool forceLoaded, bool forceEn
       }
     }
 
-    hasNoRecords = file.isDummy();
-
-    formVersion   = file.formVersion();
-    headerVersion = file.headerVersion();
-    author        = QString::fromLatin1(file.author().c_str());
-    description   = QString::fromLatin1(file.description().c_str());
+    formVersion   = file->formVersion;
+    headerVersion = file->headerVersion;
+    author        = file->author;
+    description   = file->description;
 
-    for (auto&& m : file.masters()) {
-      masters.insert(QString::fromStdString(m));
+    for (auto&& m : file->masters) {
+      masters.insert(m);
     }
-  } catch (const std::exception& e) {
-    log::error("failed to parse plugin file {}: {}", fullPath, e.what());
+  } else {
+    log::error("failed to parse plugin file {}: {}", fullPath, header.error);
     hasMasterExtension = false;
     hasLightExtension  = false;
     isMasterFlagged    = false;
@@ -2184,6 +2466,85 @@ PluginList::ESPInfo::ESPInfo(const QString& name, bool forceLoaded, bool forceEn
   }
 }
 
+PluginList::GameSupport PluginList::gameSupport() const
+{
+  auto gamePlugins = m_Organizer.gameFeatures().gameFeature<GamePlugins>();
+
+  GameSupport game;
+
+  game.primaryPlugins       = m_GamePlugin->primaryPlugins();
+  game.enabledPlugins       = m_GamePlugin->enabledPlugins();
+  game.forceEnableCoreFiles = Settings::instance().game().forceEnableCoreFiles();
+  game.lightPlugins  = gamePlugins ? gamePlugins->lightPluginsAreSupported() : false;
+  game.mediumPlugins = gamePlugins ? gamePlugins->mediumPluginsAreSupported() : false;
+  game.blueprintPlugins =
+      gamePlugins ? gamePlugins->blueprintPluginsAreSupported() : false;
+  game.loadOrderMechanismNone =
+      m_GamePlugin->loadOrderMechanism() == IPluginGame::LoadOrderMechanism::None;
+  game.blueprintPrefix = m_GamePlugin->blueprintPrefix();
+
+  return game;
+}
+
+PluginList::ESPInfo
+PluginList::createInfo(const GameSupport& game, const DirectoryEntry& baseDirectory,
+                       const FileEntryPtr& file, const ArchivePrefixIndex& archives,
+                       const PluginHeaderCache::Result& header) const
+{
+  const QString& filename = file->getName();
+
+  bool forceLoaded   = game.forceEnableCoreFiles &&
+                       game.primaryPlugins.contains(filename, Qt::CaseInsensitive);
+  bool forceEnabled  = game.enabledPlugins.contains(filename, Qt::CaseInsensitive);
+  bool forceDisabled = game.loadOrderMechanismNone && !forceLoaded && !forceEnabled;
+  if (!game.lightPlugins && filename.endsWith(".esl")) {
+    forceDisabled = true;
+  }
+
+  bool archive        = false;
+  FilesOrigin& origin = baseDirectory.getOriginByID(file->getOrigin(archive));
+
+  // name without extension
+  QString baseName = QFileInfo(filename).completeBaseName();
+
+  QString iniPath = baseName + ".ini";
+  bool hasIni     = baseDirectory.findFile(iniPath).get() != nullptr;
+  std::set<QString> loadedArchives = archives.withPrefix(baseName);
+
+  QString originName    = origin.getName();
+  unsigned int modIndex = ModInfo::getIndex(originName);
+  if (modIndex != UINT_MAX) {
+    ModInfo::Ptr modInfo = ModInfo::getByIndex(modIndex);
+    originName           = modInfo->name();
+  }
+
+  return ESPInfo(filename, forceLoaded, forceEnabled, forceDisabled, originName,
+                 file->getFullPath(), hasIni, loadedArchives, game.lightPlugins,
+                 game.mediumPlugins, game.blueprintPlugins, game.blueprintPrefix,
+                 header);
+}
+
+std::vector<PluginHeaderCache::Result>
+PluginList::readHeaders(const std::vector<QString>& paths)
+{
+  if (!m_HeaderCacheLoaded) {
+    m_HeaderCache.load(headerCachePath());
+    m_HeaderCacheLoaded = true;
+  }
+
+  auto headers = m_HeaderCache.get(paths);
+
+  log::debug("plugin headers: {} cached, {} parsed", m_HeaderCache.hits(),
+             m_HeaderCache.misses());
+
+  return headers;
+}
+
+QString PluginList::headerCachePath()
+{
+  return Settings::instance().paths().cache() + "/plugins.headers";
+}
+
 void PluginList::managedGameChanged(const IPluginGame* gamePlugin)
 {
   m_GamePlugin = gamePlugin;
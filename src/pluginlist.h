@@ -21,7 +21,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #define PLUGINLIST_H
 
 #include "loot.h"
+#include "pluginarchives.h"
+#include "pluginheadercache.h"
 #include "profile.h"
+#include "shared/fileregisterfwd.h"
 #include <ifiletree.h>
 #include <ipluginlist.h>
 
@@ -133,6 +136,50 @@ public:
                const MOShared::DirectoryEntry& baseDirectory,
                const QString& lockedOrderFile, bool refresh);
 
+  // plugins whose entries are outdated after files at the root of the data
+  // directory were added, removed or moved to another origin
+  //
+  struct Changes
+  {
+    // plugins in the data directory that are not in the list
+    QStringList added;
+
+    // plugins in the list that are not in the data directory anymore
+    QStringList removed;
+
+    // plugins that are in both, but are provided by another file or whose ini
+    // or archives might have changed
+    QStringList changed;
+
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+  };
+
+  /**
+   * @brief finds the plugins affected by changes to the given files
+   *
+   * @param baseDirectory the root directory structure representing the virtual data
+   *directory, already updated
+   * @param files names of files at the root of the data directory that were added,
+   *removed or moved to another origin, files that are not plugins, archives or inis
+   *are ignored
+   **/
+  Changes changes(const MOShared::DirectoryEntry& baseDirectory,
+                  const QStringList& files) const;
+
+  /**
+   * @brief updates the entries of the given plugins instead of refreshing the whole
+   *list
+   *
+   * only the given plugins and the plugins that have one of them as a master are
+   *updated; views are only notified of the rows that were inserted, removed or
+   *changed
+   *
+   * @param baseDirectory the root directory structure representing the virtual data
+   *directory
+   * @param changes plugins to update, from changes()
+   **/
+  void update(const MOShared::DirectoryEntry& baseDirectory, const Changes& changes);
+
   /**
    * @brief enable a plugin based on its name
    *
@@ -332,7 +379,7 @@ private:
             bool forceDisabled, const QString& originName, const QString& fullPath,
             bool hasIni, std::set<QString> archives, bool lightSupported,
             bool mediumSupported, bool blueprintSupported,
-            const QString& blueprintPrefix);
+            const QString& blueprintPrefix, const PluginHeaderCache::Result& header);
 
     QString name;
     QString fullPath;
@@ -373,10 +420,50 @@ private:
     Loot::Plugin loot;
   };
 
+  // what the managed game supports, used to create the entries of plugins
+  //
+  struct GameSupport
+  {
+    QStringList primaryPlugins;
+    QStringList enabledPlugins;
+    bool forceEnableCoreFiles;
+    bool lightPlugins;
+    bool mediumPlugins;
+    bool blueprintPlugins;
+    bool loadOrderMechanismNone;
+    QString blueprintPrefix;
+  };
+
 private:
+  GameSupport gameSupport() const;
+
+  // creates the entry of a plugin of the data directory, throws if the origin
+  // of the file doesn't exist
+  //
+  ESPInfo createInfo(const GameSupport& game,
+                     const MOShared::DirectoryEntry& baseDirectory,
+                     const MOShared::FileEntryPtr& file,
+                     const ArchivePrefixIndex& archives,
+                     const PluginHeaderCache::Result& header) const;
+
+  // headers of the given plugins, from the cache when they haven't changed
+  //
+  std::vector<PluginHeaderCache::Result> readHeaders(const std::vector<QString>& paths);
+
   void syncLoadOrder();
+
+  // moves the locked plugins to their priority, returns whether any moved
+  //
+  bool applyLockedOrder();
+
+  // rebuilds the name and priority lookups and the mod indices
+  //
   void updateIndices();
 
+  // rebuilds the name and priority lookups only
+  //
+  void updateLookups();
+
   void writeLockedOrder(const QString& fileName) const;
 
   void readLockedOrderFrom(const QString& fileName);
@@ -384,10 +471,12 @@ private:
   void changePluginPriority(std::vector<int> rows, int newPriority);
 
   void testMasters();
+  void testMasters(const std::vector<int>& rows);
 
   void fixPrimaryPlugins();
   void fixPriorities();
   void fixPluginRelationships();
+  void fixPluginRelationships(const std::vector<int>& rows);
 
   int findPluginByPriority(int priority);
 
@@ -429,6 +518,12 @@ private:
   const MOBase::IPluginGame* m_GamePlugin;
   bool m_BlueprintPlugins = false;
 
+  // loaded on the first refresh
+  PluginHeaderCache m_HeaderCache;
+  bool m_HeaderCacheLoaded = false;
+
+  static QString headerCachePath();
+
   QVariant displayData(const QModelIndex& modelIndex) const;
   QVariant checkstateData(const QModelIndex& modelIndex) const;
   QVariant foregroundData(const QModelIndex& modelIndex) const;
@@ -824,6 +824,13 @@ ProcessRunner::waitForAllUSVFSProcessesWithLock(UILocker::Reasons reason)
   for (;;) {
     withLock([&](auto& ls) {
       const auto processes = getRunningUSVFSProcesses();
+
+      // closes the handles once the wait is over
+      std::vector<env::HandlePtr> owned;
+      for (auto h : processes) {
+        owned.emplace_back(h);
+      }
+
       if (processes.empty()) {
         r = Completed;
         return;
@@ -603,7 +603,7 @@ void Profile::updateIndices()
   }
 }
 
-std::vector<std::tuple<QString, QString, int>> Profile::getActiveMods()
+std::vector<std::tuple<QString, QString, int>> Profile::getActiveMods() const
 {
   std::vector<std::tuple<QString, QString, int>> result;
   for (const auto& [priority, index] : m_ModIndexByPriority) {
@@ -0,0 +1,614 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "archiveindex.h"
+#include "../taskscheduler.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <bsatk/bsatk.h>
+#include <cstring>
+#include <log.h>
+#include <utility.h>
+
+using namespace MOBase;
+
+namespace MOShared
+{
+
+namespace
+{
+
+// "MOAI"
+constexpr quint32 Magic = 0x4D4F4149;
+
+// magic, version, count and table offset, padded so the first index is
+// aligned
+constexpr qint64 FileHeaderSize = 24;
+
+// alignment of each index in the file
+constexpr qint64 IndexAlignment = 8;
+
+qint64 align(qint64 offset)
+{
+  return (offset + IndexAlignment - 1) / IndexAlignment * IndexAlignment;
+}
+
+// a subtree of an archive, converted on its own and appended to the index
+// once done
+//
+struct Builder
+{
+  std::vector<ArchiveIndex::Folder> folders;
+  std::vector<ArchiveIndex::File> files;
+  QString strings;
+
+  quint32 addString(const std::string& utf8)
+  {
+    const auto offset = static_cast<quint32>(strings.size());
+    strings += ToQString(utf8);
+    return offset;
+  }
+
+  // adds the folder, its files and all its subfolders; returns the index of
+  // the folder
+  //
+  std::size_t addFolder(const BSA::Folder::Ptr& f, bool recurse = true)
+  {
+    const std::size_t index = folders.size();
+
+    ArchiveIndex::Folder folder = {};
+    folder.name                 = addString(f->getName());
+    folder.nameSize             = static_cast<quint32>(strings.size()) - folder.name;
+    folder.firstFile            = static_cast<quint32>(files.size());
+    folder.fileCount            = f->getNumFiles();
+    folder.subFolderCount       = f->getNumSubFolders();
+
+    folders.push_back(folder);
+
+    for (unsigned int i = 0; i < f->getNumFiles(); ++i) {
+      const BSA::File::Ptr file = f->getFile(i);
+
+      ArchiveIndex::File af = {};
+      af.name               = addString(file->getName());
+      af.nameSize           = static_cast<quint32>(strings.size()) - af.name;
+      af.size               = static_cast<quint32>(file->getFileSize());
+      af.uncompressedSize   = static_cast<quint32>(file->getUncompressedFileSize());
+
+      files.push_back(af);
+    }
+
+    if (recurse) {
+      for (unsigned int i = 0; i < f->getNumSubFolders(); ++i) {
+        addFolder(f->getSubFolder(i));
+      }
+    }
+
+    folders[index].subtreeSize = static_cast<quint32>(folders.size() - index);
+
+    return index;
+  }
+
+  // appends a subtree that was built separately
+  //
+  void append(const Builder& part)
+  {
+    const auto stringBase = static_cast<quint32>(strings.size());
+    const auto fileBase   = static_cast<quint32>(files.size());
+
+    for (auto f : part.folders) {
+      f.name += stringBase;
+      f.firstFile += fileBase;
+      folders.push_back(f);
+    }
+
+    for (auto f : part.files) {
+      f.name += stringBase;
+      files.push_back(f);
+    }
+
+    strings += part.strings;
+  }
+};
+
+}  // namespace
+
+ArchiveIndex::ArchiveIndex(std::span<const std::byte> bytes,
+                           std::shared_ptr<const void> owner)
+    : m_Owner(std::move(owner)), m_Bytes(bytes)
+{
+  if (bytes.size() < sizeof(Header)) {
+    return;
+  }
+
+  const auto* h = reinterpret_cast<const Header*>(bytes.data());
+
+  const std::size_t folders = sizeof(Header);
+  const std::size_t files   = folders + h->folderCount * sizeof(Folder);
+  const std::size_t strings = files + h->fileCount * sizeof(File);
+  const std::size_t end     = strings + h->stringSize * sizeof(char16_t);
+
+  if (end > bytes.size()) {
+    return;
+  }
+
+  m_Folders = {reinterpret_cast<const Folder*>(bytes.data() + folders), h->folderCount};
+  m_Files   = {reinterpret_cast<const File*>(bytes.data() + files), h->fileCount};
+  m_Strings = QStringView(reinterpret_cast<const char16_t*>(bytes.data() + strings),
+                          h->stringSize);
+}
+
+bool ArchiveIndex::isValid() const
+{
+  if (m_Folders.empty()) {
+    return false;
+  }
+
+  const auto stringSize = static_cast<std::size_t>(m_Strings.size());
+
+  for (const auto& f : m_Files) {
+    if (std::size_t(f.name) + f.nameSize > stringSize) {
+      return false;
+    }
+  }
+
+  for (std::size_t i = 0; i < m_Folders.size(); ++i) {
+    const Folder& f = m_Folders[i];
+
+    if (std::size_t(f.name) + f.nameSize > stringSize ||
+        std::size_t(f.firstFile) + f.fileCount > m_Files.size() ||
+        f.subtreeSize == 0 || i + f.subtreeSize > m_Folders.size()) {
+      return false;
+    }
+
+    // the subtrees of the children must add up, forEachSubFolder() relies on
+    // it
+    std::size_t child = i + 1;
+
+    for (quint32 n = 0; n < f.subFolderCount; ++n) {
+      if (child >= i + f.subtreeSize) {
+        return false;
+      }
+
+      child += m_Folders[child].subtreeSize;
+    }
+
+    if (child != i + f.subtreeSize) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndex::read(const QFileInfo& archiveInfo)
+{
+  const QString path = archiveInfo.absoluteFilePath();
+
+  BSA::Archive archive;
+  BSA::EErrorCode res = BSA::ERROR_NONE;
+
+  try {
+    // read() can return an error, but it can also throw if the file is not a
+    // valid bsa
+    res = archive.read(archiveInfo.filesystemAbsoluteFilePath(), false);
+  } catch (std::exception& e) {
+    log::error("invalid bsa '{}', error {}", path, e.what());
+    return {};
+  }
+
+  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
+    log::error("invalid bsa '{}', error {}", path, res);
+    return {};
+  }
+
+  // reading the archive cannot be split, but converting the names of large
+  // archives takes about as long; each top-level folder is converted on its
+  // own
+  const BSA::Folder::Ptr root = archive.getRoot();
+  std::vector<Builder> parts(root->getNumSubFolders());
+
+  {
+    TaskGroup group;
+
+    for (unsigned int i = 0; i < root->getNumSubFolders(); ++i) {
+      group.run(path, [&parts, &root, i] {
+        parts[i].addFolder(root->getSubFolder(i));
+      });
+    }
+
+    group.wait();
+  }
+
+  Builder index;
+  index.addFolder(root, false);
+
+  for (const auto& p : parts) {
+    index.append(p);
+  }
+
+  index.folders[0].subtreeSize = static_cast<quint32>(index.folders.size());
+
+  // serialized in a single buffer, which is also what ends up in the cache
+  const Header h = {static_cast<quint32>(index.folders.size()),
+                    static_cast<quint32>(index.files.size()),
+                    static_cast<quint32>(index.strings.size()), 0};
+
+  const std::size_t size = sizeof(Header) + index.folders.size() * sizeof(Folder) +
+                           index.files.size() * sizeof(File) +
+                           index.strings.size() * sizeof(char16_t);
+
+  auto buffer = std::make_shared<std::vector<std::byte>>(size);
+  std::byte* p = buffer->data();
+
+  auto copy = [&](const void* data, std::size_t n) {
+    std::memcpy(p, data, n);
+    p += n;
+  };
+
+  copy(&h, sizeof(h));
+  copy(index.folders.data(), index.folders.size() * sizeof(Folder));
+  copy(index.files.data(), index.files.size() * sizeof(File));
+  copy(index.strings.utf16(), index.strings.size() * sizeof(char16_t));
+
+  const std::span<const std::byte> bytes(buffer->data(), buffer->size());
+
+  return std::shared_ptr<const ArchiveIndex>(
+      new ArchiveIndex(bytes, std::move(buffer)));
+}
+
+std::shared_ptr<const ArchiveIndex>
+ArchiveIndex::view(std::span<const std::byte> bytes, std::shared_ptr<const void> owner)
+{
+  std::shared_ptr<const ArchiveIndex> index(new ArchiveIndex(bytes, std::move(owner)));
+
+  if (!index->isValid()) {
+    return {};
+  }
+
+  return index;
+}
+
+// the cache file, mapped in memory for as long as an index or the cache uses
+// it
+//
+// on Windows, a file that's mapped cannot be replaced, and the indices handed
+// out keep their mapping alive for as long as they're used; the file is read
+// in memory instead so save() can always replace it
+//
+struct ArchiveIndexCache::Mapping
+{
+  QFile file;
+  uchar* data = nullptr;
+  qint64 size = 0;
+
+#ifdef _WIN32
+  QByteArray contents;
+#endif
+
+  ~Mapping()
+  {
+#ifndef _WIN32
+    if (data) {
+      file.unmap(data);
+    }
+#endif
+  }
+};
+
+ArchiveIndexCache::ArchiveIndexCache() : m_Dirty(false), m_Hits(0), m_Misses(0) {}
+
+ArchiveIndexCache::~ArchiveIndexCache() = default;
+
+bool ArchiveIndexCache::load(const QString& file)
+{
+  std::map<QString, Entry> entries;
+  auto m = open(file, entries);
+
+  const bool loaded = (m != nullptr);
+
+  std::unique_lock lock(m_EntriesMutex);
+  m_Entries = std::move(entries);
+  m_Mapping = std::move(m);
+  m_Dirty   = false;
+
+  return loaded;
+}
+
+std::shared_ptr<ArchiveIndexCache::Mapping>
+ArchiveIndexCache::open(const QString& file, std::map<QString, Entry>& entries)
+{
+  entries.clear();
+
+  auto m = std::make_shared<Mapping>();
+  m->file.setFileName(file);
+
+  if (!m->file.open(QIODevice::ReadOnly)) {
+    // not necessarily a problem, the file may just not exist (yet)
+    return {};
+  }
+
+  m->size = m->file.size();
+
+#ifdef _WIN32
+  if (m->size > FileHeaderSize) {
+    m->contents = m->file.readAll();
+
+    if (m->contents.size() == m->size) {
+      m->data = reinterpret_cast<uchar*>(m->contents.data());
+    }
+  }
+
+  m->file.close();
+#else
+  m->data = m->size > FileHeaderSize ? m->file.map(0, m->size) : nullptr;
+#endif
+
+  if (!m->data) {
+    log::debug("ignoring archive index cache '{}', cannot map it", file);
+    return {};
+  }
+
+  const auto all = QByteArray::fromRawData(reinterpret_cast<const char*>(m->data),
+                                           static_cast<qsizetype>(m->size));
+
+  QDataStream header(all);
+
+  quint32 magic = 0, version = 0, count = 0;
+  quint64 tableOffset = 0;
+
+  header >> magic >> version >> count >> tableOffset;
+
+  if (magic != Magic || version != FormatVersion ||
+      tableOffset < static_cast<quint64>(FileHeaderSize) ||
+      tableOffset > static_cast<quint64>(m->size)) {
+    log::debug("ignoring archive index cache '{}', unknown format", file);
+    return {};
+  }
+
+  QDataStream s(all.sliced(static_cast<qsizetype>(tableOffset)));
+
+  for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i) {
+    QString path;
+    Entry e;
+    quint64 offset = 0, length = 0;
+
+    s >> path >> e.size >> e.lastModified >> offset >> length;
+
+    if (s.status() != QDataStream::Ok || offset % IndexAlignment != 0 ||
+        offset + length > tableOffset) {
+      s.setStatus(QDataStream::ReadCorruptData);
+      break;
+    }
+
+    e.bytes = {reinterpret_cast<const std::byte*>(m->data) + offset, length};
+    entries.emplace(std::move(path), std::move(e));
+  }
+
+  if (s.status() != QDataStream::Ok) {
+    log::error("archive index cache '{}' is corrupted, ignoring", file);
+    entries.clear();
+    return {};
+  }
+
+  log::debug("loaded archive index cache with {} archives", entries.size());
+  return m;
+}
+
+bool ArchiveIndexCache::save(const QString& file)
+{
+  if (!m_Dirty) {
+    return true;
+  }
+
+  QSaveFile f(file);
+  if (!f.open(QIODevice::WriteOnly)) {
+    log::error("failed to save archive index cache to '{}': {}", file, f.errorString());
+    return false;
+  }
+
+  // the entries are only read here, get() can still use them while the file is
+  // written
+  {
+    std::shared_lock lock(m_EntriesMutex);
+
+    QDataStream s(&f);
+
+    // every index is aligned, the table of archives comes after them
+    std::vector<qint64> offsets;
+    offsets.reserve(m_Entries.size());
+
+    qint64 tableOffset = FileHeaderSize;
+
+    for (const auto& [path, e] : m_Entries) {
+      const auto bytes = e.index ? e.index->bytes() : e.bytes;
+
+      tableOffset = align(tableOffset);
+      offsets.push_back(tableOffset);
+      tableOffset += static_cast<qint64>(bytes.size());
+    }
+
+    s << Magic << FormatVersion << static_cast<quint32>(m_Entries.size())
+      << static_cast<quint64>(tableOffset);
+
+    std::size_t i = 0;
+
+    for (const auto& [path, e] : m_Entries) {
+      const auto bytes = e.index ? e.index->bytes() : e.bytes;
+
+      // padding
+      const QByteArray zeroes(offsets[i] - f.pos(), '\0');
+      f.write(zeroes);
+
+      f.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<qint64>(bytes.size()));
+
+      ++i;
+    }
+
+    i = 0;
+
+    for (const auto& [path, e] : m_Entries) {
+      const auto bytes = e.index ? e.index->bytes() : e.bytes;
+
+      s << path << e.size << e.lastModified << static_cast<quint64>(offsets[i])
+        << static_cast<quint64>(bytes.size());
+
+      ++i;
+    }
+
+    if (s.status() != QDataStream::Ok || f.error() != QFileDevice::NoError) {
+      log::error("failed to save archive index cache to '{}': {}", file,
+                 f.errorString());
+      f.cancelWriting();
+      return false;
+    }
+  }
+
+  if (!f.commit()) {
+    log::error("failed to save archive index cache to '{}': {}", file, f.errorString());
+    return false;
+  }
+
+  // the indices that were read during the refresh are in memory, they're
+  // switched to the new file so that memory can be released
+  std::map<QString, Entry> saved;
+  auto m = open(file, saved);
+
+  std::unique_lock lock(m_EntriesMutex);
+
+  if (!m) {
+    m_Dirty = false;
+    return true;
+  }
+
+  // entries may have changed since the file was written, those stay as they
+  // are and will be saved next time
+  bool dirty = (saved.size() != m_Entries.size());
+
+  for (auto it = m_Entries.begin(); it != m_Entries.end();) {
+    Entry& e  = it->second;
+    auto itor = saved.find(it->first);
+
+    if (itor != saved.end() && itor->second.size == e.size &&
+        itor->second.lastModified == e.lastModified) {
+      e.index.reset();
+      e.bytes = itor->second.bytes;
+    } else {
+      dirty = true;
+
+      // the bytes are in the previous mapping, which the index keeps alive
+      if (!e.index) {
+        e.index = ArchiveIndex::view(e.bytes, m_Mapping);
+
+        if (!e.index) {
+          it = m_Entries.erase(it);
+          continue;
+        }
+      }
+    }
+
+    ++it;
+  }
+
+  // indices that are still in use keep the previous mapping alive
+  m_Mapping = std::move(m);
+  m_Dirty   = dirty;
+
+  return true;
+}
+
+void ArchiveIndexCache::commit()
+{
+  std::scoped_lock lock(m_EntriesMutex, m_RecordedMutex);
+
+  // archives that were not used during the refresh are forgotten
+  if (m_Entries.size() != m_Recorded.size()) {
+    m_Dirty = true;
+  }
+
+  m_Entries = std::move(m_Recorded);
+  m_Recorded.clear();
+}
+
+void ArchiveIndexCache::discardRecorded()
+{
+  std::scoped_lock lock(m_RecordedMutex);
+  m_Recorded.clear();
+
+  m_Hits   = 0;
+  m_Misses = 0;
+}
+
+std::shared_ptr<const ArchiveIndex> ArchiveIndexCache::get(const QFileInfo& archive,
+                                                           bool* hit)
+{
+  const QString path        = archive.absoluteFilePath();
+  const qint64 size         = archive.size();
+  const qint64 lastModified = archive.lastModified().toMSecsSinceEpoch();
+
+  if (hit) {
+    *hit = false;
+  }
+
+  {
+    std::shared_lock lock(m_EntriesMutex);
+    auto itor = m_Entries.find(path);
+
+    if (itor != m_Entries.end() && itor->second.size == size &&
+        itor->second.lastModified == lastModified) {
+      const Entry& e = itor->second;
+      auto index     = e.index ? e.index : ArchiveIndex::view(e.bytes, m_Mapping);
+
+      if (index) {
+        if (hit) {
+          *hit = true;
+        }
+
+        ++m_Hits;
+
+        // still up to date, keep it for the next commit
+        record(path, {size, lastModified, index, {}});
+        return index;
+      }
+
+      log::warn("archive index for '{}' is corrupted in the cache", path);
+    }
+  }
+
+  ++m_Misses;
+
+  auto index = ArchiveIndex::read(archive);
+  if (!index) {
+    return {};
+  }
+
+  m_Dirty = true;
+  record(path, {size, lastModified, index, {}});
+
+  return index;
+}
+
+void ArchiveIndexCache::record(const QString& path, Entry e)
+{
+  std::scoped_lock lock(m_RecordedMutex);
+  m_Recorded.insert_or_assign(path, std::move(e));
+}
+
+}  // namespace MOShared
@@ -0,0 +1,254 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MO_REGISTER_ARCHIVEINDEX_INCLUDED
+#define MO_REGISTER_ARCHIVEINDEX_INCLUDED
+
+#include <QFileInfo>
+#include <QString>
+#include <QStringView>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+namespace MOShared
+{
+
+// listing of the folders and files of a bsa or ba2, in a flat layout that can
+// be used directly from a memory-mapped file
+//
+// folders are stored in pre-order: the first child of a folder comes right
+// after it and its next sibling comes after its whole subtree, the root is
+// always the first folder; the files of a folder are contiguous; names are
+// utf-16 and are not nul-terminated
+//
+class ArchiveIndex
+{
+public:
+  struct Folder
+  {
+    quint32 name;
+    quint32 nameSize;
+    quint32 firstFile;
+    quint32 fileCount;
+    quint32 subFolderCount;
+
+    // number of folders in this subtree, including this one
+    quint32 subtreeSize;
+  };
+
+  struct File
+  {
+    quint32 name;
+    quint32 nameSize;
+    quint32 size;
+
+    // 0 if the file is not compressed
+    quint32 uncompressedSize;
+  };
+
+  // reads the archive and builds its index, the top-level folders are
+  // converted in parallel; returns null and logs an error if the archive
+  // cannot be read
+  //
+  static std::shared_ptr<const ArchiveIndex> read(const QFileInfo& archive);
+
+  // uses the given bytes as an index, they must stay valid as long as `owner`
+  // is alive; returns null if the bytes are not a valid index
+  //
+  static std::shared_ptr<const ArchiveIndex> view(std::span<const std::byte> bytes,
+                                                  std::shared_ptr<const void> owner);
+
+  // the index, as it's stored on disk
+  //
+  std::span<const std::byte> bytes() const { return m_Bytes; }
+
+  std::size_t folderCount() const { return m_Folders.size(); }
+  std::size_t fileCount() const { return m_Files.size(); }
+
+  const Folder& folder(std::size_t i) const { return m_Folders[i]; }
+
+  std::span<const File> files(const Folder& f) const
+  {
+    return m_Files.subspan(f.firstFile, f.fileCount);
+  }
+
+  QStringView name(const Folder& f) const
+  {
+    return m_Strings.sliced(f.name, f.nameSize);
+  }
+
+  QStringView name(const File& f) const
+  {
+    return m_Strings.sliced(f.name, f.nameSize);
+  }
+
+  // calls f() with the index of each direct subfolder of the given folder
+  //
+  template <class F>
+  void forEachSubFolder(std::size_t i, F&& f) const
+  {
+    std::size_t child = i + 1;
+
+    for (quint32 n = 0; n < m_Folders[i].subFolderCount; ++n) {
+      f(child);
+      child += m_Folders[child].subtreeSize;
+    }
+  }
+
+private:
+  struct Header
+  {
+    quint32 folderCount;
+    quint32 fileCount;
+
+    // in utf-16 code units
+    quint32 stringSize;
+
+    quint32 reserved;
+  };
+
+  // either the buffer the index was built in or the file it was loaded from
+  std::shared_ptr<const void> m_Owner;
+
+  std::span<const std::byte> m_Bytes;
+  std::span<const Folder> m_Folders;
+  std::span<const File> m_Files;
+  QStringView m_Strings;
+
+  ArchiveIndex(std::span<const std::byte> bytes, std::shared_ptr<const void> owner);
+
+  bool isValid() const;
+};
+
+/**
+ * @brief on-disk cache of the index of every archive that was added to the
+ * directory structure
+ *
+ * an archive is only read again when its size or modification time has
+ * changed; the cache is a single file that is memory-mapped when loaded, so
+ * indices that are never used are never read from disk
+ *
+ * this works like DirectorySnapshot: archives are recorded during a refresh
+ * and the ones that were not recorded are forgotten on commit()
+ *
+ * all functions can be called from multiple threads
+ **/
+class ArchiveIndexCache
+{
+public:
+  // bumped every time the format of the file changes, files with a different
+  // version are ignored
+  static constexpr quint32 FormatVersion = 1;
+
+  ArchiveIndexCache();
+  ~ArchiveIndexCache();
+
+  // noncopyable
+  ArchiveIndexCache(const ArchiveIndexCache&)            = delete;
+  ArchiveIndexCache& operator=(const ArchiveIndexCache&) = delete;
+
+  /**
+   * @brief maps the given file, replacing anything that was loaded before
+   *
+   * @return false if the file does not exist or is invalid, in which case the
+   * cache is empty
+   **/
+  bool load(const QString& file);
+
+  /**
+   * @brief saves the archives that were committed to the given file and maps
+   * it, does nothing if they are the same as the ones that were loaded
+   *
+   * the entries stay available while the file is written, the ones that are
+   * still current are moved to the new file once it's in place
+   **/
+  bool save(const QString& file);
+
+  /**
+   * @brief makes the archives recorded since the last call the current ones
+   **/
+  void commit();
+
+  /**
+   * @brief forgets the archives recorded since the last commit()
+   **/
+  void discardRecorded();
+
+  /**
+   * @brief returns the index of the given archive, reading it only if it's not
+   * in the cache or has changed on disk, and records it for the next commit()
+   *
+   * @param hit set to true if the index came from the cache
+   * @return null if the archive cannot be read
+   **/
+  std::shared_ptr<const ArchiveIndex> get(const QFileInfo& archive,
+                                          bool* hit = nullptr);
+
+  // number of archives that were found in the cache and that had to be read
+  // since the last discardRecorded()
+  //
+  std::size_t hits() const { return m_Hits; }
+  std::size_t misses() const { return m_Misses; }
+
+private:
+  struct Mapping;
+
+  struct Entry
+  {
+    qint64 size         = 0;
+    qint64 lastModified = 0;
+
+    // set once the index has been used, the bytes are in the mapping until
+    // then
+    std::shared_ptr<const ArchiveIndex> index;
+    std::span<const std::byte> bytes;
+  };
+
+  // archives that were loaded or committed
+  std::map<QString, Entry> m_Entries;
+  std::shared_ptr<Mapping> m_Mapping;
+  mutable std::shared_mutex m_EntriesMutex;
+
+  // archives recorded during the current refresh
+  std::map<QString, Entry> m_Recorded;
+  mutable std::mutex m_RecordedMutex;
+
+  // whether the entries are different from what's in the file
+  std::atomic<bool> m_Dirty;
+
+  std::atomic<std::size_t> m_Hits, m_Misses;
+
+  void record(const QString& path, Entry e);
+
+  // maps the given file and fills `entries` with the archives it contains;
+  // returns null if the file cannot be used, `entries` is empty in that case
+  //
+  static std::shared_ptr<Mapping> open(const QString& file,
+                                       std::map<QString, Entry>& entries);
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_ARCHIVEINDEX_INCLUDED
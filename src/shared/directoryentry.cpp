@@ -19,6 +19,8 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "directoryentry.h"
 #include "../envfs.h"
+#include "../glob_matching.h"
+#include "archiveindex.h"
 #include "fileentry.h"
 #include "filesorigin.h"
 #include "originconnection.h"
@@ -41,6 +43,11 @@ const QString newLine = QStringLiteral("\n");
 const QString newLine = QStringLiteral("\r\n");
 #endif
 
+bool isWildcard(QChar c)
+{
+  return (c == '*' || c == '?' || c == '[');
+}
+
 }  // namespace
 
 namespace MOShared
@@ -101,8 +108,10 @@ void DirectoryEntry::clear()
     delete *itor;
   }
 
-  m_Files.clear();
   m_FilesLookup.clear();
+  m_SortedFiles.reset();
+  m_QueryIndex.reset();
+  m_SortedFilesDirty = false;
   m_SubDirectories.clear();
   m_SubDirectoriesLookup.clear();
 }
@@ -110,8 +119,8 @@ void DirectoryEntry::clear()
 void DirectoryEntry::addFromOrigin(const QString& originName, const QString& directory,
                                    int priority, DirectoryStats& stats)
 {
-  env::DirectoryWalker walker;
-  addFromOrigin(walker, originName, directory, priority, stats);
+  addFromOrigin(env::DirectoryWalker::forThisThread(), originName, directory, priority,
+                stats);
 }
 
 void DirectoryEntry::addFromOrigin(env::DirectoryWalker& walker,
@@ -131,8 +140,6 @@ void DirectoryEntry::addFromList(const QString& originName, const QString& direc
                                  env::Directory& root, int priority,
                                  DirectoryStats& stats)
 {
-  stats = {};
-
   FilesOrigin& origin = createOrigin(originName, directory, priority, stats);
   addDir(origin, root, stats);
 }
@@ -149,7 +156,7 @@ void DirectoryEntry::addDir(FilesOrigin& origin, env::Directory& d,
 
   elapsed(stats.fileTimes, [&] {
     for (auto& f : d.files) {
-      insert(f, origin, {}, -1, stats);
+      insert(f, origin, {}, stats);
     }
   });
 
@@ -159,7 +166,8 @@ void DirectoryEntry::addDir(FilesOrigin& origin, env::Directory& d,
 void DirectoryEntry::addFromAllBSAs(const QString& originName, const QString& directory,
                                     int priority, const QStringList& archives,
                                     const std::set<QString>& enabledArchives,
-                                    const QStringList& loadOrder, DirectoryStats& stats)
+                                    const QStringList& loadOrder, DirectoryStats& stats,
+                                    ArchiveIndexCache* cache)
 {
   for (const auto& archive : archives) {
     const QFileInfo archiveInfo(archive);
@@ -185,37 +193,28 @@ void DirectoryEntry::addFromAllBSAs(const QString& originName, const QString& di
       }
     }
 
-    addFromBSA(originName, directory, archiveInfo.filePath(), priority, order, stats);
+    addFromBSA(originName, directory, archiveInfo.filePath(), priority, order, stats,
+               cache);
   }
 }
 
 void DirectoryEntry::addFromBSA(const QString& originName, const QString& directory,
                                 const QString& archivePath, int priority, int order,
-                                DirectoryStats& stats)
+                                DirectoryStats& stats, ArchiveIndexCache* cache)
 {
   FilesOrigin& origin = createOrigin(originName, directory, priority, stats);
   QFileInfo archiveInfo(archivePath);
-  const auto archiveName              = archiveInfo.fileName();
-  std::filesystem::path archiveFsPath = archiveInfo.filesystemAbsoluteFilePath();
+  const auto archiveName = archiveInfo.fileName();
 
   if (containsArchive(archiveName)) {
     return;
   }
 
-  BSA::Archive archive;
-  BSA::EErrorCode res = BSA::ERROR_NONE;
-
-  try {
-    // read() can return an error, but it can also throw if the file is not a
-    // valid bsa
-    res = archive.read(archiveFsPath, false);
-  } catch (std::exception& e) {
-    log::error("invalid bsa '{}', error {}", archivePath, e.what());
-    return;
-  }
+  // the archive is only opened if it's not in the cache or has changed
+  const auto index = cache ? cache->get(archiveInfo) : ArchiveIndex::read(archiveInfo);
 
-  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
-    log::error("invalid bsa '{}', error {}", archivePath, res);
+  if (!index) {
+    // already logged
     return;
   }
 
@@ -224,7 +223,8 @@ void DirectoryEntry::addFromBSA(const QString& originName, const QString& direct
   if (!ft.isValid()) {
     log::warn("failed to get last modified date for '{}'", archivePath);
   }
-  addFiles(origin, archive.getRoot(), ft, archiveName, order, stats);
+  // the archive name is interned once for all its files
+  addFiles(origin, *index, 0, ft, DataArchiveOrigin(archiveName, order), stats);
 
   m_Populated = true;
 }
@@ -261,12 +261,19 @@ const FilesOrigin* DirectoryEntry::findOriginByID(int ID) const
   return m_OriginConnection->findByID(ID);
 }
 
+std::vector<const FilesOrigin*> DirectoryEntry::getOrigins() const
+{
+  return m_OriginConnection->getAll();
+}
+
 int DirectoryEntry::anyOrigin() const
 {
   bool ignore;
 
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
-    FileEntryPtr entry = m_FileRegister->getFile(iter->second);
+  const auto files = sortedFiles();
+
+  for (auto index : *files) {
+    FileEntryPtr entry = m_FileRegister->getFile(index);
     if ((entry.get() != nullptr) && !entry->isFromArchive()) {
       return entry->getOrigin(ignore);
     }
@@ -286,11 +293,13 @@ int DirectoryEntry::anyOrigin() const
 
 std::vector<FileEntryPtr> DirectoryEntry::getFiles() const
 {
+  const auto files = sortedFiles();
+
   std::vector<FileEntryPtr> result;
-  result.reserve(m_Files.size());
+  result.reserve(files->size());
 
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
-    result.push_back(m_FileRegister->getFile(iter->second));
+  for (auto index : *files) {
+    result.push_back(m_FileRegister->getFile(index));
   }
 
   return result;
@@ -351,12 +360,12 @@ const FileEntryPtr DirectoryEntry::findFile(const DirectoryEntryFileKey& key) co
 
 bool DirectoryEntry::hasFile(const QString& name) const
 {
-  return m_Files.contains(name.toLower());
+  return m_FilesLookup.contains(DirectoryEntryFileKey(name.toLower()));
 }
 
 bool DirectoryEntry::containsArchive(QString archiveName)
 {
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
+  for (auto iter = m_FilesLookup.begin(); iter != m_FilesLookup.end(); ++iter) {
     FileEntryPtr entry = m_FileRegister->getFile(iter->second);
     if (entry->isFromArchive(archiveName)) {
       return true;
@@ -386,9 +395,9 @@ const FileEntryPtr DirectoryEntry::searchFile(const QString& path,
 
   if (len == -1) {
     // no more path components
-    auto iter = m_Files.find(path.toLower());
+    auto iter = m_FilesLookup.find(DirectoryEntryFileKey(path.toLower()));
 
-    if (iter != m_Files.end()) {
+    if (iter != m_FilesLookup.end()) {
       return m_FileRegister->getFile(iter->second);
     } else if (directory != nullptr) {
       DirectoryEntry* temp = findSubDirectory(path);
@@ -472,10 +481,10 @@ bool DirectoryEntry::remove(const QString& fileName, int* origin)
 {
   const auto lcFileName = ToLowerCopy(fileName);
 
-  auto iter = m_Files.find(lcFileName);
+  auto iter = m_FilesLookup.find(DirectoryEntryFileKey(lcFileName));
   bool b    = false;
 
-  if (iter != m_Files.end()) {
+  if (iter != m_FilesLookup.end()) {
     if (origin != nullptr) {
       FileEntryPtr entry = m_FileRegister->getFile(iter->second);
       if (entry.get() != nullptr) {
@@ -517,7 +526,8 @@ void DirectoryEntry::removeFiles(const std::set<FileIndex>& indices)
 }
 
 FileEntryPtr DirectoryEntry::insert(QStringView fileName, FilesOrigin& origin,
-                                    QDateTime fileTime, QStringView archive, int order,
+                                    QDateTime fileTime,
+                                    const DataArchiveOrigin& archive,
                                     DirectoryStats& stats)
 {
   QString fileNameLower = ToLowerCopy(fileName);
@@ -551,7 +561,7 @@ FileEntryPtr DirectoryEntry::insert(QStringView fileName, FilesOrigin& origin,
   }
 
   elapsed(stats.addOriginToFileTimes, [&] {
-    fe->addOrigin(origin.getID(), fileTime, archive, order);
+    fe->addOrigin(origin.getID(), fileTime, archive);
   });
 
   elapsed(stats.addFileToOriginTimes, [&] {
@@ -562,7 +572,7 @@ FileEntryPtr DirectoryEntry::insert(QStringView fileName, FilesOrigin& origin,
 }
 
 FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
-                                    QStringView archive, int order,
+                                    const DataArchiveOrigin& archive,
                                     DirectoryStats& stats)
 {
   FileEntryPtr fe;
@@ -570,13 +580,13 @@ FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
   {
     std::unique_lock lock(m_FilesMutex);
 
-    FilesMap::iterator itor;
+    FilesLookup::iterator itor;
 
     elapsed(stats.filesLookupTimes, [&] {
-      itor = m_Files.find(file.lcname);
+      itor = m_FilesLookup.find(DirectoryEntryFileKey(file.lcname));
     });
 
-    if (itor != m_Files.end()) {
+    if (itor != m_FilesLookup.end()) {
       lock.unlock();
       ++stats.fileExists;
       fe = m_FileRegister->getFile(itor->second);
@@ -594,7 +604,7 @@ FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
   }
 
   elapsed(stats.addOriginToFileTimes, [&] {
-    fe->addOrigin(origin.getID(), file.lastModified, archive, order);
+    fe->addOrigin(origin.getID(), file.lastModified, archive);
   });
 
   elapsed(stats.addFileToOriginTimes, [&] {
@@ -654,41 +664,34 @@ void DirectoryEntry::onDirectoryEnd(Context* cx, QStringView path)
 void DirectoryEntry::onFile(Context* cx, QStringView path, QDateTime ft)
 {
   elapsed(cx->stats.fileTimes, [&] {
-    cx->current.top()->insert(path, cx->origin, ft, {}, -1, cx->stats);
+    cx->current.top()->insert(path, cx->origin, ft, {}, cx->stats);
   });
 }
 
-void DirectoryEntry::addFiles(FilesOrigin& origin, const BSA::Folder::Ptr archiveFolder,
-                              QDateTime fileTime, const QString& archiveName, int order,
-                              DirectoryStats& stats)
+void DirectoryEntry::addFiles(FilesOrigin& origin, const ArchiveIndex& index,
+                              std::size_t folder, QDateTime fileTime,
+                              const DataArchiveOrigin& archive, DirectoryStats& stats)
 {
   // add files
-  const auto fileCount = archiveFolder->getNumFiles();
-  for (unsigned int i = 0; i < fileCount; ++i) {
-    const BSA::File::Ptr file = archiveFolder->getFile(i);
-
-    auto f =
-        insert(ToQString(file->getName()), origin, fileTime, archiveName, order, stats);
+  for (const auto& file : index.files(index.folder(folder))) {
+    auto f = insert(index.name(file), origin, fileTime, archive, stats);
 
     if (f) {
-      if (file->getUncompressedFileSize() > 0) {
-        f->setFileSize(file->getFileSize(), file->getUncompressedFileSize());
+      if (file.uncompressedSize > 0) {
+        f->setFileSize(file.size, file.uncompressedSize);
       } else {
-        f->setFileSize(file->getFileSize(), FileEntry::NoFileSize);
+        f->setFileSize(file.size, FileEntry::NoFileSize);
       }
     }
   }
 
   // recurse into subdirectories
-  const auto dirCount = archiveFolder->getNumSubFolders();
-  for (unsigned int i = 0; i < dirCount; ++i) {
-    const BSA::Folder::Ptr folder = archiveFolder->getSubFolder(i);
+  index.forEachSubFolder(folder, [&](std::size_t sub) {
+    DirectoryEntry* folderEntry = getSubDirectoryRecursive(
+        index.name(index.folder(sub)).toString(), true, stats, origin.getID());
 
-    DirectoryEntry* folderEntry = getSubDirectoryRecursive(ToQString(folder->getName()),
-                                                           true, stats, origin.getID());
-
-    folderEntry->addFiles(origin, folder, fileTime, archiveName, order, stats);
-  }
+    folderEntry->addFiles(origin, index, sub, fileTime, archive, stats);
+  });
 }
 
 DirectoryEntry* DirectoryEntry::getSubDirectory(QStringView name, bool create,
@@ -789,11 +792,13 @@ DirectoryEntry* DirectoryEntry::getSubDirectoryRecursive(const QString& path,
 
 void DirectoryEntry::removeDirRecursive()
 {
-  while (!m_Files.empty()) {
-    m_FileRegister->removeFile(m_Files.begin()->second);
+  while (!m_FilesLookup.empty()) {
+    m_FileRegister->removeFile(m_FilesLookup.begin()->second);
   }
 
-  m_FilesLookup.clear();
+  m_SortedFiles.reset();
+  m_QueryIndex.reset();
+  m_SortedFilesDirty = false;
 
   for (DirectoryEntry* entry : m_SubDirectories) {
     entry->removeDirRecursive();
@@ -853,19 +858,11 @@ void DirectoryEntry::removeFileFromList(FileIndex index)
   };
 
   removeFrom(m_FilesLookup);
-  removeFrom(m_Files);
+  m_SortedFilesDirty = true;
 }
 
 void DirectoryEntry::removeFilesFromList(const std::set<FileIndex>& indices)
 {
-  for (auto iter = m_Files.begin(); iter != m_Files.end();) {
-    if (indices.contains(iter->second)) {
-      iter = m_Files.erase(iter);
-    } else {
-      ++iter;
-    }
-  }
-
   for (auto iter = m_FilesLookup.begin(); iter != m_FilesLookup.end();) {
     if (indices.contains(iter->second)) {
       iter = m_FilesLookup.erase(iter);
@@ -873,13 +870,188 @@ void DirectoryEntry::removeFilesFromList(const std::set<FileIndex>& indices)
       ++iter;
     }
   }
+
+  m_SortedFilesDirty = true;
 }
 
 void DirectoryEntry::addFileToList(QString fileNameLower, FileIndex index)
 {
-  m_FilesLookup.emplace(fileNameLower, index);
-  m_Files.emplace(std::move(fileNameLower), index);
+  m_FilesLookup.emplace(std::move(fileNameLower), index);
   // fileNameLower has been moved from this point
+
+  m_SortedFilesDirty = true;
+}
+
+std::shared_ptr<const std::vector<FileIndex>> DirectoryEntry::sortedFiles() const
+{
+  static const auto empty = std::make_shared<const std::vector<FileIndex>>();
+
+  std::scoped_lock lock(m_FilesMutex);
+  updateSortedFiles();
+
+  return m_SortedFiles ? m_SortedFiles : empty;
+}
+
+void DirectoryEntry::updateSortedFiles() const
+{
+  if (!m_SortedFilesDirty) {
+    return;
+  }
+
+  std::vector<std::pair<const QString*, FileIndex>> files;
+  files.reserve(m_FilesLookup.size());
+
+  for (auto&& [key, index] : m_FilesLookup) {
+    files.emplace_back(&key.value, index);
+  }
+
+  std::ranges::sort(files, [](auto&& a, auto&& b) {
+    return *a.first < *b.first;
+  });
+
+  auto sorted = std::make_shared<std::vector<FileIndex>>();
+  sorted->reserve(files.size());
+
+  for (auto&& f : files) {
+    sorted->push_back(f.second);
+  }
+
+  if (sorted->empty()) {
+    m_SortedFiles.reset();
+  } else {
+    m_SortedFiles = std::move(sorted);
+  }
+
+  m_QueryIndex.reset();
+  m_SortedFilesDirty = false;
+}
+
+const DirectoryEntry::QueryIndex& DirectoryEntry::queryIndex() const
+{
+  updateSortedFiles();
+
+  if (m_QueryIndex) {
+    return *m_QueryIndex;
+  }
+
+  // the keys are unique, so sorting them again gives the same order as the
+  // sorted files
+  std::vector<const QString*> names;
+  names.reserve(m_FilesLookup.size());
+
+  for (auto&& [key, index] : m_FilesLookup) {
+    names.push_back(&key.value);
+  }
+
+  std::ranges::sort(names, [](auto&& a, auto&& b) {
+    return *a < *b;
+  });
+
+  auto qi = std::make_unique<QueryIndex>();
+  qi->names.reserve(names.size());
+
+  for (const QString* name : names) {
+    const auto dot = name->lastIndexOf('.');
+
+    if (dot != -1) {
+      qi->extensions[name->sliced(dot + 1)].push_back(qi->names.size());
+    }
+
+    qi->names.push_back(*name);
+  }
+
+  m_QueryIndex = std::move(qi);
+  return *m_QueryIndex;
+}
+
+std::vector<FileIndex> DirectoryEntry::findFiles(const FileQuery& query) const
+{
+  std::scoped_lock lock(m_FilesMutex);
+  const QueryIndex& qi = queryIndex();
+
+  // positions in the sorted list, sorted at the end so the files are in the
+  // same order as the other functions return them
+  std::vector<std::size_t> found;
+
+  for (const auto& p : query.m_Patterns) {
+    if (p.kind == FileQuery::Kind::Extension) {
+      auto itor = qi.extensions.find(p.literal);
+      if (itor != qi.extensions.end()) {
+        found.insert(found.end(), itor->second.begin(), itor->second.end());
+      }
+
+      continue;
+    }
+
+    // names starting with the literal part are contiguous in the sorted list
+    const auto begin = std::lower_bound(qi.names.begin(), qi.names.end(), p.literal);
+
+    if (p.kind == FileQuery::Kind::Name) {
+      if (begin != qi.names.end() && *begin == p.literal) {
+        found.push_back(begin - qi.names.begin());
+      }
+
+      continue;
+    }
+
+    GlobPattern<QChar> glob(p.pattern);
+
+    for (auto itor = begin; itor != qi.names.end(); ++itor) {
+      if (!itor->startsWith(p.literal)) {
+        break;
+      }
+
+      if (p.kind == FileQuery::Kind::Prefix || glob.match(*itor)) {
+        found.push_back(itor - qi.names.begin());
+      }
+    }
+  }
+
+  // a single pattern finds the files in order
+  if (query.m_Patterns.size() > 1) {
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+  }
+
+  std::vector<FileIndex> result;
+  result.reserve(found.size());
+
+  for (const auto i : found) {
+    result.push_back((*m_SortedFiles)[i]);
+  }
+
+  return result;
+}
+
+FileQuery::FileQuery(const QStringList& globs)
+{
+  m_Patterns.reserve(globs.size());
+
+  for (const auto& glob : globs) {
+    Pattern p;
+    p.pattern = glob.toLower();
+
+    const auto wildcard =
+        std::find_if(p.pattern.constBegin(), p.pattern.constEnd(), isWildcard);
+    const auto length = wildcard - p.pattern.constBegin();
+    const QStringView rest(p.pattern.constData() + length, p.pattern.size() - length);
+
+    p.literal = p.pattern.first(length);
+
+    if (rest.isEmpty()) {
+      p.kind = Kind::Name;
+    } else if (rest == u"*") {
+      p.kind = Kind::Prefix;
+    } else if (length == 0 && rest.startsWith(u"*.") && rest.count('.') == 1 &&
+               std::none_of(rest.begin() + 1, rest.end(), isWildcard)) {
+      p.kind    = Kind::Extension;
+      p.literal = rest.sliced(2).toString();
+    } else {
+      p.kind = Kind::Glob;
+    }
+
+    m_Patterns.push_back(std::move(p));
+  }
 }
 
 struct DumpFailed : public std::runtime_error
@@ -906,11 +1078,13 @@ void DirectoryEntry::dump(const QString& file) const
 void DirectoryEntry::dump(QFile* f, const QString& parentPath) const
 {
   {
+    const auto files = sortedFiles();
+
     std::scoped_lock lock(m_FilesMutex);
     QDataStream stream(f);
 
-    for (auto&& index : m_Files) {
-      const auto file = m_FileRegister->getFile(index.second);
+    for (auto&& index : *files) {
+      const auto file = m_FileRegister->getFile(index);
       if (!file) {
         continue;
       }
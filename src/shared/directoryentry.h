@@ -22,6 +22,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QDateTime>
 #include <bsatk/bsatk.h>
+#include <memory>
 
 #include "fileregister.h"
 
@@ -48,11 +49,56 @@ struct hash<MOShared::DirectoryEntryFileKey>
 namespace MOShared
 {
 
+class ArchiveIndex;
+class ArchiveIndexCache;
+
 struct DirCompareByName
 {
   bool operator()(const DirectoryEntry* a, const DirectoryEntry* b) const;
 };
 
+// glob patterns prepared once so they can be used on any number of
+// directories with DirectoryEntry::findFiles(), see GlobPattern for the syntax
+//
+// patterns are looked up in the indices of the directory when possible: names
+// without wildcards by name, "*.ext" by extension and "prefix*" by a range of
+// the sorted names; other patterns are only matched against the names that
+// start with the literal part before their first wildcard
+//
+class FileQuery
+{
+public:
+  FileQuery(const QStringList& globs);
+
+private:
+  friend class DirectoryEntry;
+
+  enum class Kind
+  {
+    // no wildcards, `literal` is the name
+    Name,
+
+    // "*.ext", `literal` is the extension without the dot
+    Extension,
+
+    // "prefix*", `literal` is the prefix
+    Prefix,
+
+    // anything else, `literal` is the part before the first wildcard
+    Glob
+  };
+
+  struct Pattern
+  {
+    Kind kind;
+    QString pattern;
+    QString literal;
+  };
+
+  // lowercase
+  std::vector<Pattern> m_Patterns;
+};
+
 class DirectoryEntry
 {
 public:
@@ -76,9 +122,9 @@ public:
 
   bool isTopLevel() const { return m_TopLevel; }
 
-  bool isEmpty() const { return m_Files.empty() && m_SubDirectories.empty(); }
+  bool isEmpty() const { return m_FilesLookup.empty() && m_SubDirectories.empty(); }
 
-  bool hasFiles() const { return !m_Files.empty(); }
+  bool hasFiles() const { return !m_FilesLookup.empty(); }
 
   const DirectoryEntry* getParent() const { return m_Parent; }
 
@@ -90,14 +136,17 @@ public:
   void addFromOrigin(env::DirectoryWalker& walker, const QString& originName,
                      const QString& directory, int priority, DirectoryStats& stats);
 
+  // archives are only read if they're not in the given cache, or every time
+  // if there's no cache
   void addFromAllBSAs(const QString& originName, const QString& directory, int priority,
                       const QStringList& archives,
                       const std::set<QString>& enabledArchives,
-                      const QStringList& loadOrder, DirectoryStats& stats);
+                      const QStringList& loadOrder, DirectoryStats& stats,
+                      ArchiveIndexCache* cache = nullptr);
 
   void addFromBSA(const QString& originName, const QString& directory,
                   const QString& archivePath, int priority, int order,
-                  DirectoryStats& stats);
+                  DirectoryStats& stats, ArchiveIndexCache* cache = nullptr);
 
   void addFromList(const QString& originName, const QString& directory,
                    env::Directory& root, int priority, DirectoryStats& stats);
@@ -113,6 +162,10 @@ public:
   FilesOrigin& getOriginByName(const QString& name) const;
   const FilesOrigin* findOriginByID(OriginID ID) const;
 
+  // every origin of the structure, including the disabled ones
+  //
+  std::vector<const FilesOrigin*> getOrigins() const;
+
   OriginID anyOrigin() const;
 
   std::vector<FileEntryPtr> getFiles() const;
@@ -132,8 +185,10 @@ public:
   template <class F>
   void forEachFile(F&& f) const
   {
-    for (auto&& p : m_Files) {
-      if (auto file = m_FileRegister->getFile(p.second)) {
+    const auto files = sortedFiles();
+
+    for (auto&& index : *files) {
+      if (auto file = m_FileRegister->getFile(index)) {
         if (!f(*file)) {
           break;
         }
@@ -144,8 +199,10 @@ public:
   template <class F>
   void forEachFileIndex(F&& f) const
   {
-    for (auto&& p : m_Files) {
-      if (!f(p.second)) {
+    const auto files = sortedFiles();
+
+    for (auto&& index : *files) {
+      if (!f(index)) {
         break;
       }
     }
@@ -156,6 +213,11 @@ public:
     return m_FileRegister->getFile(index);
   }
 
+  // files directly in this directory that match any of the patterns of the
+  // query, sorted by name
+  //
+  std::vector<FileIndex> findFiles(const FileQuery& query) const;
+
   DirectoryEntry* findSubDirectory(const QString& name,
                                    bool alreadyLowerCase = false) const;
 
@@ -204,7 +266,8 @@ public:
   void dump(const QString& file) const;
 
 private:
-  using FilesMap             = std::map<QString, FileIndex>;
+  friend class DirectoryMerge;
+
   using FilesLookup          = std::unordered_map<DirectoryEntryFileKey, FileIndex>;
   using SubDirectoriesLookup = std::unordered_map<QString, DirectoryEntry*>;
 
@@ -212,8 +275,27 @@ private:
   boost::shared_ptr<OriginConnection> m_OriginConnection;
 
   QString m_Name;
-  FilesMap m_Files;
   FilesLookup m_FilesLookup;
+
+  // lowercase names of the sorted files, and the positions in that list of the
+  // files for each extension, used by findFiles()
+  //
+  struct QueryIndex
+  {
+    std::vector<QString> names;
+    std::unordered_map<QString, std::vector<std::size_t>> extensions;
+  };
+
+  // indices of the files sorted by name; only rebuilt when needed after files
+  // were added or removed. the sorted files are never modified once built, a
+  // new list replaces them, so they can be used by sortedFiles() callers
+  // without copying them; null when there are no files
+  mutable std::shared_ptr<const std::vector<FileIndex>> m_SortedFiles;
+  mutable bool m_SortedFilesDirty = false;
+
+  // only built for the few directories that are queried, null until then and
+  // whenever the sorted files are rebuilt
+  mutable std::unique_ptr<QueryIndex> m_QueryIndex;
   SubDirectories m_SubDirectories;
   SubDirectoriesLookup m_SubDirectoriesLookup;
 
@@ -226,16 +308,17 @@ private:
   mutable std::mutex m_OriginsMutex;
 
   FileEntryPtr insert(QStringView fileName, FilesOrigin& origin, QDateTime fileTime,
-                      QStringView archive, int order, DirectoryStats& stats);
+                      const DataArchiveOrigin& archive, DirectoryStats& stats);
 
-  FileEntryPtr insert(env::File& file, FilesOrigin& origin, QStringView archive,
-                      int order, DirectoryStats& stats);
+  FileEntryPtr insert(env::File& file, FilesOrigin& origin,
+                      const DataArchiveOrigin& archive, DirectoryStats& stats);
 
   void addFiles(env::DirectoryWalker& walker, FilesOrigin& origin, const QString& path,
                 DirectoryStats& stats);
 
-  void addFiles(FilesOrigin& origin, BSA::Folder::Ptr archiveFolder, QDateTime fileTime,
-                const QString& archiveName, int order, DirectoryStats& stats);
+  void addFiles(FilesOrigin& origin, const ArchiveIndex& index, std::size_t folder,
+                QDateTime fileTime, const DataArchiveOrigin& archive,
+                DirectoryStats& stats);
 
   void addDir(FilesOrigin& origin, env::Directory& d, DirectoryStats& stats);
 
@@ -255,6 +338,20 @@ private:
   void addDirectoryToList(DirectoryEntry* e, QString nameLc);
   void removeDirectoryFromList(SubDirectories::iterator itor);
 
+  // the sorted files, taken under the lock; the list stays valid for as long as
+  // the pointer is held even if it's replaced by another thread, never null
+  //
+  std::shared_ptr<const std::vector<FileIndex>> sortedFiles() const;
+
+  // rebuilds the sorted files if they're dirty, m_FilesMutex must be locked
+  //
+  void updateSortedFiles() const;
+
+  // builds the query index if it's null, after updating the sorted files;
+  // m_FilesMutex must be locked
+  //
+  const QueryIndex& queryIndex() const;
+
   void addFileToList(QString fileNameLower, FileIndex index);
   void removeFileFromList(FileIndex index);
   void removeFilesFromList(const std::set<FileIndex>& indices);
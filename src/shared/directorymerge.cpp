@@ -0,0 +1,224 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "directorymerge.h"
+#include "../envfs.h"
+#include "../taskscheduler.h"
+#include "directoryentry.h"
+#include "fileentry.h"
+#include "filesorigin.h"
+#include <log.h>
+
+using namespace MOBase;
+
+namespace MOShared
+{
+
+DirectoryMerge::DirectoryMerge(DirectoryEntry& root)
+    : m_Root(root), m_Register(root.getFileRegister())
+{}
+
+void DirectoryMerge::add(FilesOrigin& origin, const env::Directory& listing)
+{
+  m_Sources.push_back({&origin, &listing});
+}
+
+void DirectoryMerge::run()
+{
+  if (m_Sources.empty()) {
+    return;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  TaskGroup group;
+
+  group.run(m_Root.getName(), [&] {
+    runShard(group, m_Root, m_Sources, 0);
+  });
+
+  group.wait();
+  group.logTimings("merge");
+
+  m_Stats.mergeTimes += std::chrono::steady_clock::now() - start;
+}
+
+void DirectoryMerge::runShard(TaskGroup& group, DirectoryEntry& target,
+                              const std::vector<Source>& sources, int depth)
+{
+  Shard shard;
+  mergeDirectory(group, shard, target, sources, depth);
+
+  // a single lock on the register and on each origin for the whole shard
+  m_Register->registerFiles(shard.files);
+  shard.stats.filesInsertedInRegister += shard.files.size();
+
+  for (const auto& [origin, indices] : shard.originFiles) {
+    origin->addFiles(indices);
+  }
+
+  ++shard.stats.mergeShards;
+  shard.stats.sharedLocksAvoided -= 1 + shard.originFiles.size();
+
+  std::scoped_lock lock(m_StatsMutex);
+  m_Stats += shard.stats;
+}
+
+void DirectoryMerge::mergeDirectory(TaskGroup& group, Shard& shard,
+                                    DirectoryEntry& target,
+                                    const std::vector<Source>& sources, int depth)
+{
+  // a source only has this directory if it also has all of its parents, so
+  // the origins don't need to be propagated
+  {
+    std::scoped_lock lock(target.m_OriginsMutex);
+    for (const auto& s : sources) {
+      target.m_Origins.insert(s.origin->getID());
+    }
+  }
+
+  --shard.stats.sharedLocksAvoided;
+
+  mergeFiles(shard, target, sources, depth);
+  mergeSubDirectories(group, shard, target, sources, depth);
+
+  target.m_Populated = true;
+}
+
+void DirectoryMerge::mergeFiles(Shard& shard, DirectoryEntry& target,
+                                const std::vector<Source>& sources, int depth)
+{
+  if (sources.size() == 1) {
+    // most directories are only provided by a single origin
+    for (const auto& f : sources[0].dir->files) {
+      const FileSource fs = {sources[0].origin, &f};
+      mergeFile(shard, target, f.lcname, {&fs, 1}, depth);
+    }
+
+    return;
+  }
+
+  // files grouped by name, in the order of the sources
+  std::unordered_map<QString, std::vector<FileSource>> files;
+
+  for (const auto& s : sources) {
+    for (const auto& f : s.dir->files) {
+      files[f.lcname].push_back({s.origin, &f});
+    }
+  }
+
+  for (const auto& [lcname, fs] : files) {
+    mergeFile(shard, target, lcname, fs, depth);
+  }
+}
+
+void DirectoryMerge::mergeFile(Shard& shard, DirectoryEntry& target,
+                               const QString& lcname,
+                               std::span<const FileSource> sources, int depth)
+{
+  FileIndex existing = InvalidFileIndex;
+
+  {
+    std::scoped_lock lock(target.m_FilesMutex);
+
+    auto itor = target.m_FilesLookup.find(DirectoryEntryFileKey(lcname));
+    if (itor != target.m_FilesLookup.end()) {
+      existing = itor->second;
+    }
+  }
+
+  if (existing != InvalidFileIndex) {
+    // the file comes from an origin that's not part of this merge, its
+    // priority has to be compared with each new origin
+    ++shard.stats.fileExists;
+
+    if (auto fe = m_Register->getFile(existing)) {
+      for (const auto& s : sources) {
+        fe->addOrigin(s.origin->getID(), s.file->lastModified, {}, -1);
+        shard.originFiles[s.origin].push_back(existing);
+        ++shard.stats.filesMergedExisting;
+      }
+    }
+
+    return;
+  }
+
+  ++shard.stats.fileCreate;
+
+  // the name is taken from the origin with the lowest priority, like it would
+  // be if the origins were added one by one
+  FileEntryPtr fe = m_Register->makeFile(sources.front().file->name, &target);
+
+  std::vector<OriginID> origins;
+  origins.reserve(sources.size());
+
+  for (const auto& s : sources) {
+    origins.push_back(s.origin->getID());
+    shard.originFiles[s.origin].push_back(fe->getIndex());
+  }
+
+  fe->setOrigins(origins, sources.back().file->lastModified);
+
+  {
+    std::scoped_lock lock(target.m_FilesMutex);
+    target.addFileToList(lcname, fe->getIndex());
+  }
+
+  shard.files.push_back(std::move(fe));
+
+  // adding the origins one by one would have locked the register once, then
+  // the origin and every parent directory for each origin, plus the origin
+  // connection twice to compare priorities for every origin after the first
+  const auto n = static_cast<int64_t>(sources.size());
+
+  shard.stats.filesMerged += n;
+  shard.stats.sharedLocksAvoided += 1 + n * (depth + 2) + (n - 1) * 2;
+}
+
+void DirectoryMerge::mergeSubDirectories(TaskGroup& group, Shard& shard,
+                                         DirectoryEntry& target,
+                                         const std::vector<Source>& sources,
+                                         int depth)
+{
+  // subdirectories grouped by name, in the order of the sources
+  std::unordered_map<QString, std::vector<Source>> dirs;
+
+  for (const auto& s : sources) {
+    for (const auto& d : s.dir->dirs) {
+      dirs[d.lcname].push_back({s.origin, &d});
+    }
+  }
+
+  for (auto& [lcname, ds] : dirs) {
+    const auto& first = ds.front();
+
+    DirectoryEntry* child = target.getSubDirectory(first.dir->name, true, shard.stats,
+                                                   first.origin->getID());
+
+    if (depth < ShardDepth) {
+      group.run(child->getName(), [this, &group, child, ds = std::move(ds), depth] {
+        runShard(group, *child, ds, depth + 1);
+      });
+    } else {
+      mergeDirectory(group, shard, *child, ds, depth + 1);
+    }
+  }
+}
+
+}  // namespace MOShared
@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of Mod Organizer.
+
+Mod Organizer is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Mod Organizer is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MO_REGISTER_DIRECTORYMERGE_INCLUDED
+#define MO_REGISTER_DIRECTORYMERGE_INCLUDED
+
+#include "fileregisterfwd.h"
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace env
+{
+struct Directory;
+struct File;
+}  // namespace env
+
+namespace MOShared
+{
+
+class TaskGroup;
+
+/**
+ * @brief adds the listings of multiple origins to a directory structure in
+ * parallel
+ *
+ * the listings are merged in priority order, one directory at a time: all the
+ * files of a directory are created with their final list of origins instead of
+ * adding origins one by one, which would have to look up priorities and
+ * propagate origins up the tree for every file
+ *
+ * the work is sharded by directory: the top-level directories and their own
+ * subdirectories are each merged by a separate task. a shard is the only one
+ * touching its directories, so the per-directory locks are never contended, and
+ * the locks shared by the whole structure (file register, origins) are only
+ * taken once per shard instead of once per file
+ **/
+class DirectoryMerge
+{
+public:
+  // directories up to this depth are merged by their own task, deeper ones are
+  // merged by the task of their parent
+  static constexpr int ShardDepth = 2;
+
+  DirectoryMerge(DirectoryEntry& root);
+
+  // noncopyable
+  DirectoryMerge(const DirectoryMerge&)            = delete;
+  DirectoryMerge& operator=(const DirectoryMerge&) = delete;
+
+  /**
+   * @brief adds a listing to be merged, must be called by ascending priority
+   *
+   * the origin must have been created with DirectoryEntry::createOrigin(), the
+   * listing must stay alive until run() returns
+   **/
+  void add(FilesOrigin& origin, const env::Directory& listing);
+
+  /**
+   * @brief merges all the listings, blocks until done
+   *
+   * files that already exist in the structure, such as the files of the data
+   * directory, get the new origins added the slow way
+   **/
+  void run();
+
+  // stats of all the shards, only complete after run()
+  //
+  const DirectoryStats& stats() const { return m_Stats; }
+
+private:
+  struct Source
+  {
+    FilesOrigin* origin;
+    const env::Directory* dir;
+  };
+
+  struct FileSource
+  {
+    FilesOrigin* origin;
+    const env::File* file;
+  };
+
+  // state of a task, flushed to the structure once the task is done
+  struct Shard
+  {
+    DirectoryStats stats;
+    std::vector<FileEntryPtr> files;
+    std::unordered_map<FilesOrigin*, std::vector<FileIndex>> originFiles;
+  };
+
+  DirectoryEntry& m_Root;
+  boost::shared_ptr<FileRegister> m_Register;
+  std::vector<Source> m_Sources;
+
+  std::mutex m_StatsMutex;
+  DirectoryStats m_Stats;
+
+  void runShard(TaskGroup& group, DirectoryEntry& target,
+                const std::vector<Source>& sources, int depth);
+
+  void mergeDirectory(TaskGroup& group, Shard& shard, DirectoryEntry& target,
+                      const std::vector<Source>& sources, int depth);
+
+  void mergeFiles(Shard& shard, DirectoryEntry& target,
+                  const std::vector<Source>& sources, int depth);
+
+  void mergeFile(Shard& shard, DirectoryEntry& target, const QString& lcname,
+                 std::span<const FileSource> sources, int depth);
+
+  void mergeSubDirectories(TaskGroup& group, Shard& shard, DirectoryEntry& target,
+                           const std::vector<Source>& sources, int depth);
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_DIRECTORYMERGE_INCLUDED
@@ -7,20 +7,23 @@ using namespace Qt::StringLiterals;
 namespace MOShared
 {
 
-FileEntry::FileEntry()
-    : m_Index(InvalidFileIndex), m_Name(), m_Origin(-1), m_Parent(nullptr),
-      m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
-{}
-
-FileEntry::FileEntry(FileIndex index, QString name, DirectoryEntry* parent)
-    : m_Index(index), m_Name(std::move(name)), m_Origin(-1), m_Archive("", -1),
-      m_Parent(parent), m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
+FileEntry::FileEntry(FileIndex index, QString name, DirectoryEntry* parent,
+                     std::mutex& originsMutex)
+    : m_Index(index), m_Origin(-1), m_Name(StringPool::names().intern(name)),
+      m_Archive(), m_Parent(parent), m_FileSize(NoFileSize),
+      m_CompressedFileSize(NoFileSize), m_OriginsMutex(&originsMutex)
 {}
 
 void FileEntry::addOrigin(OriginID origin, QDateTime fileTime, QStringView archive,
                           int order)
 {
-  std::scoped_lock lock(m_OriginsMutex);
+  addOrigin(origin, std::move(fileTime), DataArchiveOrigin(archive, order));
+}
+
+void FileEntry::addOrigin(OriginID origin, QDateTime fileTime,
+                          const DataArchiveOrigin& archive)
+{
+  std::scoped_lock lock(originsMutex());
 
   if (m_Parent != nullptr) {
     m_Parent->propagateOrigin(origin);
@@ -31,11 +34,11 @@ void FileEntry::addOrigin(OriginID origin, QDateTime fileTime, QStringView archi
     // alternatives
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(archive.toString(), order);
+    m_Archive  = archive;
   } else if ((m_Parent != nullptr) &&
              ((m_Parent->getOriginByID(origin).getPriority() >
                m_Parent->getOriginByID(m_Origin).getPriority()) ||
-              (archive.size() == 0 && m_Archive.isValid()))) {
+              (!archive.isValid() && m_Archive.isValid()))) {
     // If this mod has a higher priority than the origin mod OR
     // this mod has a loose file and the origin mod has an archived file,
     // this mod is now the origin and the previous origin is the first alternative
@@ -50,7 +53,7 @@ void FileEntry::addOrigin(OriginID origin, QDateTime fileTime, QStringView archi
 
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(archive.toString(), order);
+    m_Archive  = archive;
   } else {
     // This mod is just an alternative
     bool found = false;
@@ -69,21 +72,41 @@ void FileEntry::addOrigin(OriginID origin, QDateTime fileTime, QStringView archi
       if ((m_Parent != nullptr) &&
           (m_Parent->getOriginByID(iter->originID()).getPriority() <
            m_Parent->getOriginByID(origin).getPriority())) {
-        m_Alternatives.insert(iter, {origin, {archive.toString(), order}});
+        m_Alternatives.insert(iter, {origin, archive});
         found = true;
         break;
       }
     }
 
     if (!found) {
-      m_Alternatives.push_back({origin, {archive.toString(), order}});
+      m_Alternatives.push_back({origin, archive});
     }
   }
 }
 
+void FileEntry::setOrigins(const std::vector<OriginID>& origins, QDateTime fileTime)
+{
+  if (origins.empty()) {
+    return;
+  }
+
+  std::scoped_lock lock(originsMutex());
+
+  m_Origin   = origins.back();
+  m_FileTime = fileTime;
+  m_Archive  = DataArchiveOrigin();
+
+  m_Alternatives.clear();
+  m_Alternatives.reserve(origins.size() - 1);
+
+  for (std::size_t i = 0; i + 1 < origins.size(); ++i) {
+    m_Alternatives.push_back({origins[i], {}});
+  }
+}
+
 bool FileEntry::removeOrigin(OriginID origin)
 {
-  std::scoped_lock lock(m_OriginsMutex);
+  std::scoped_lock lock(originsMutex());
 
   if (m_Origin == origin) {
     if (!m_Alternatives.empty()) {
@@ -121,20 +144,22 @@ bool FileEntry::removeOrigin(OriginID origin)
       m_Origin = currentID;
     } else {
       m_Origin  = -1;
-      m_Archive = DataArchiveOrigin("", -1);
+      m_Archive = DataArchiveOrigin();
       return true;
     }
   } else {
-    std::erase_if(m_Alternatives, [&](auto& i) {
+    auto [first, last] = std::ranges::remove_if(m_Alternatives, [&](auto& i) {
       return i.originID() == origin;
     });
+
+    m_Alternatives.erase(first, last);
   }
   return false;
 }
 
 void FileEntry::sortOrigins()
 {
-  std::scoped_lock lock(m_OriginsMutex);
+  std::scoped_lock lock(originsMutex());
 
   m_Alternatives.push_back({m_Origin, m_Archive});
 
@@ -178,9 +203,14 @@ void FileEntry::sortOrigins()
   }
 }
 
+std::mutex& FileEntry::originsMutex() const
+{
+  return *m_OriginsMutex;
+}
+
 bool FileEntry::isFromArchive(QString archiveName) const
 {
-  std::scoped_lock lock(m_OriginsMutex);
+  std::scoped_lock lock(originsMutex());
 
   if (archiveName.length() == 0) {
     return m_Archive.isValid();
@@ -201,7 +231,7 @@ bool FileEntry::isFromArchive(QString archiveName) const
 
 QString FileEntry::getFullPath(OriginID originID) const
 {
-  std::scoped_lock lock(m_OriginsMutex);
+  std::scoped_lock lock(originsMutex());
 
   if (originID == InvalidOriginID) {
     bool ignore = false;
@@ -219,7 +249,7 @@ QString FileEntry::getFullPath(OriginID originID) const
   // all intermediate directories
   recurseParents(result, m_Parent);
 
-  return result % "/"_L1 % m_Name;
+  return result % "/"_L1 % getName();
 }
 
 QString FileEntry::getRelativePath() const
@@ -229,7 +259,7 @@ QString FileEntry::getRelativePath() const
   // all intermediate directories
   recurseParents(result, m_Parent);
 
-  return result % "/"_L1 % m_Name;
+  return result % "/"_L1 % getName();
 }
 
 bool FileEntry::recurseParents(QString& path, const DirectoryEntry* parent) const
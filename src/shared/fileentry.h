@@ -13,8 +13,11 @@ class FileEntry
 public:
   static constexpr uint64_t NoFileSize = std::numeric_limits<uint64_t>::max();
 
-  FileEntry();
-  FileEntry(FileIndex index, QString name, DirectoryEntry* parent);
+  // the mutex guards the origins, it's given by the register, see
+  // FileRegister::originsMutex()
+  //
+  FileEntry(FileIndex index, QString name, DirectoryEntry* parent,
+            std::mutex& originsMutex);
 
   // noncopyable
   FileEntry(const FileEntry&)            = delete;
@@ -23,6 +26,12 @@ public:
   FileIndex getIndex() const { return m_Index; }
 
   void addOrigin(OriginID origin, QDateTime fileTime, QStringView archive, int order);
+  void addOrigin(OriginID origin, QDateTime fileTime, const DataArchiveOrigin& archive);
+
+  // sets the loose origins of a file that has none yet, sorted by ascending
+  // priority; the last one becomes the primary origin. unlike addOrigin(), this
+  // doesn't propagate the origins to the parent directories
+  void setOrigins(const std::vector<OriginID>& origins, QDateTime fileTime);
 
   // remove the specified origin from the list of origins that contain this
   // file. if no origin is left, the file is effectively deleted and true is
@@ -36,7 +45,7 @@ public:
   // (ascending)
   const AlternativesVector& getAlternatives() const { return m_Alternatives; }
 
-  const QString& getName() const { return m_Name; }
+  const QString& getName() const { return StringPool::names().get(m_Name); }
 
   OriginID getOrigin() const { return m_Origin; }
 
@@ -75,14 +84,19 @@ public:
 
 private:
   FileIndex m_Index;
-  QString m_Name;
   OriginID m_Origin;
+  StringId m_Name;
   DataArchiveOrigin m_Archive;
   AlternativesVector m_Alternatives;
   DirectoryEntry* m_Parent;
   mutable QDateTime m_FileTime;
   uint64_t m_FileSize, m_CompressedFileSize;
-  mutable std::mutex m_OriginsMutex;
+
+  // guards the origins and alternatives, shared with other files of the same
+  // register
+  std::mutex* m_OriginsMutex;
+
+  std::mutex& originsMutex() const;
 
   bool recurseParents(QString& path, const DirectoryEntry* parent) const;
 };
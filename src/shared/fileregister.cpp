@@ -3,6 +3,7 @@
 #include "fileentry.h"
 #include "filesorigin.h"
 #include "originconnection.h"
+#include <boost/make_shared.hpp>
 #include <log.h>
 
 namespace MOShared
@@ -29,7 +30,8 @@ FileEntryPtr FileRegister::createFile(QString name, DirectoryEntry* parent,
                                       DirectoryStats& stats)
 {
   const auto index = generateIndex();
-  auto p           = FileEntryPtr(new FileEntry(index, std::move(name), parent));
+  auto p           = boost::make_shared<FileEntry>(index, std::move(name), parent,
+                                                    originsMutex(index));
 
   {
     std::scoped_lock lock(m_Mutex);
@@ -44,6 +46,36 @@ FileEntryPtr FileRegister::createFile(QString name, DirectoryEntry* parent,
   return p;
 }
 
+FileEntryPtr FileRegister::makeFile(QString name, DirectoryEntry* parent)
+{
+  // a single allocation for the entry and the reference count
+  const auto index = generateIndex();
+  return boost::make_shared<FileEntry>(index, std::move(name), parent,
+                                       originsMutex(index));
+}
+
+void FileRegister::registerFiles(const std::vector<FileEntryPtr>& files)
+{
+  if (files.empty()) {
+    return;
+  }
+
+  FileIndex highest = 0;
+  for (auto&& f : files) {
+    highest = std::max(highest, f->getIndex());
+  }
+
+  std::scoped_lock lock(m_Mutex);
+
+  if (highest >= m_Files.size()) {
+    m_Files.resize(highest + 1);
+  }
+
+  for (auto&& f : files) {
+    m_Files[f->getIndex()] = f;
+  }
+}
+
 FileIndex FileRegister::generateIndex()
 {
   return m_NextIndex++;
@@ -60,6 +92,12 @@ FileEntryPtr FileRegister::getFile(FileIndex index) const
   }
 }
 
+std::vector<FileEntryPtr> FileRegister::getFiles() const
+{
+  std::scoped_lock lock(m_Mutex);
+  return {m_Files.begin(), m_Files.end()};
+}
+
 bool FileRegister::removeFile(FileIndex index)
 {
   std::scoped_lock lock(m_Mutex);
@@ -161,6 +199,35 @@ void FileRegister::sortOrigins()
   }
 }
 
+void FileRegister::sortOrigins(const std::set<OriginID>& origins)
+{
+  std::set<FileIndex> indices;
+
+  for (const auto id : origins) {
+    if (const auto* o = m_OriginConnection->findByID(id)) {
+      const auto v = o->getFileIndices();
+      indices.insert(v.begin(), v.end());
+    }
+  }
+
+  std::vector<FileEntryPtr> files;
+  files.reserve(indices.size());
+
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    for (const auto index : indices) {
+      if (index < m_Files.size() && m_Files[index]) {
+        files.push_back(m_Files[index]);
+      }
+    }
+  }
+
+  for (auto&& f : files) {
+    f->sortOrigins();
+  }
+}
+
 void FileRegister::unregisterFile(FileEntryPtr file)
 {
   bool ignore;
@@ -2,10 +2,12 @@
 #define MO_REGISTER_FILESREGISTER_INCLUDED
 
 #include "fileregisterfwd.h"
+#include <array>
 #include <boost/shared_ptr.hpp>
 #include <deque>
 #include <mutex>
 #include <set>
+#include <vector>
 
 namespace MOShared
 {
@@ -23,8 +25,22 @@ public:
 
   FileEntryPtr createFile(QString name, DirectoryEntry* parent, DirectoryStats& stats);
 
+  // creates a file with a new index without adding it to the register, it
+  // must be added with registerFiles() before getFile() can find it
+  //
+  FileEntryPtr makeFile(QString name, DirectoryEntry* parent);
+
+  // adds files created by makeFile(), taking the lock only once
+  //
+  void registerFiles(const std::vector<FileEntryPtr>& files);
+
   FileEntryPtr getFile(FileIndex index) const;
 
+  // every file of the register, indexed by FileIndex; files that were removed
+  // are null
+  //
+  std::vector<FileEntryPtr> getFiles() const;
+
   size_t highestCount() const
   {
     std::scoped_lock lock(m_Mutex);
@@ -37,6 +53,20 @@ public:
 
   void sortOrigins();
 
+  // only sorts the origins of the files provided by the given origins; when
+  // the priority of some origins change, these are the only files whose
+  // alternatives can be out of order
+  void sortOrigins(const std::set<OriginID>& origins);
+
+  // files don't have a mutex of their own, the files of a register share these
+  // based on their index; a file's mutex is never held while locking another
+  // file
+  //
+  std::mutex& originsMutex(FileIndex index)
+  {
+    return m_OriginsMutexes[index % m_OriginsMutexes.size()];
+  }
+
 private:
   using FileMap = std::deque<FileEntryPtr>;
 
@@ -44,6 +74,7 @@ private:
   FileMap m_Files;
   boost::shared_ptr<OriginConnection> m_OriginConnection;
   std::atomic<FileIndex> m_NextIndex;
+  std::array<std::mutex, 256> m_OriginsMutexes;
 
   void unregisterFile(FileEntryPtr file);
   FileIndex generateIndex();
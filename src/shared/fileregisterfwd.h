@@ -1,8 +1,10 @@
 #ifndef MO_REGISTER_FILEREGISTERFWD_INCLUDED
 #define MO_REGISTER_FILEREGISTERFWD_INCLUDED
 
+#include "stringpool.h"
 #include <QHash>
 #include <QString>
+#include <boost/container/small_vector.hpp>
 #include <boost/shared_ptr.hpp>
 #include <chrono>
 #include <climits>
@@ -45,18 +47,26 @@ constexpr OriginID InvalidOriginID   = -1;
 // is the order of the associated plugin in the plugins list
 // is a file is not in an archive, archiveName is empty and order is usually
 // -1
+//
+// archive names are interned in StringPool::instance(), every file of an
+// archive refers to the same string
 class DataArchiveOrigin
 {
-  QString name_;
-  int order_ = -1;
+  StringId name_ = StringPool::Empty;
+  int order_     = -1;
 
 public:
   int order() const { return order_; }
-  const QString& name() const { return name_; }
+  const QString& name() const { return StringPool::instance().get(name_); }
+  StringId nameId() const { return name_; }
 
-  bool isValid() const { return name_.size() > 0; }
+  bool isValid() const { return name_ != StringPool::Empty; }
 
-  DataArchiveOrigin(QString name, int order) : name_(std::move(name)), order_(order) {}
+  DataArchiveOrigin(QStringView name, int order)
+      : name_(StringPool::instance().intern(name)), order_(order)
+  {}
+
+  DataArchiveOrigin(StringId name, int order) : name_(name), order_(order) {}
 
   DataArchiveOrigin() = default;
 };
@@ -79,7 +89,8 @@ public:
   {}
 };
 
-using AlternativesVector = std::vector<FileAlternative>;
+// most files have at most one alternative, which is stored inline
+using AlternativesVector = boost::container::small_vector<FileAlternative, 1>;
 
 struct DirectoryStats
 {
@@ -99,6 +110,7 @@ struct DirectoryStats
   std::chrono::nanoseconds addOriginToFileTimes;
   std::chrono::nanoseconds addFileToOriginTimes;
   std::chrono::nanoseconds addFileToRegisterTimes;
+  std::chrono::nanoseconds mergeTimes;
 
   int64_t originExists;
   int64_t originCreate;
@@ -112,6 +124,17 @@ struct DirectoryStats
   int64_t filesInsertedInRegister;
   int64_t filesAssignedInRegister;
 
+  // file/origin pairs added by DirectoryMerge to new files, without taking any
+  // lock shared with other directories, and to files that already existed
+  int64_t filesMerged;
+  int64_t filesMergedExisting;
+  int64_t mergeShards;
+
+  // estimate of the locks shared by the whole structure that would have been
+  // taken by adding the merged origins one file at a time, minus the ones
+  // taken by the merge
+  int64_t sharedLocksAvoided;
+
   DirectoryStats();
 
   DirectoryStats& operator+=(const DirectoryStats& o);
@@ -61,6 +61,12 @@ std::vector<FileEntryPtr> FilesOrigin::getFiles() const
   return result;
 }
 
+std::vector<FileIndex> FilesOrigin::getFileIndices() const
+{
+  std::scoped_lock lock(m_Mutex);
+  return {m_Files.begin(), m_Files.end()};
+}
+
 FileEntryPtr FilesOrigin::findFile(FileIndex index) const
 {
   return m_FileRegister.lock()->getFile(index);
@@ -5,6 +5,7 @@
 #include <boost/smart_ptr/weak_ptr.hpp>
 #include <mutex>
 #include <set>
+#include <vector>
 
 namespace MOShared
 {
@@ -39,6 +40,10 @@ public:
   std::vector<FileEntryPtr> getFiles() const;
   FileEntryPtr findFile(FileIndex index) const;
 
+  // indices of the files provided by this origin, without looking them up in
+  // the register
+  std::vector<FileIndex> getFileIndices() const;
+
   void enable(bool enabled, DirectoryStats& stats);
   void enable(bool enabled);
 
@@ -50,6 +55,12 @@ public:
     m_Files.insert(index);
   }
 
+  void addFiles(const std::vector<FileIndex>& indices)
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Files.insert(indices.begin(), indices.end());
+  }
+
   void removeFile(FileIndex index);
 
   bool containsArchive(QString archiveName);
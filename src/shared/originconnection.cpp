@@ -85,6 +85,20 @@ FilesOrigin& OriginConnection::getByName(const QString& name)
   }
 }
 
+std::vector<const FilesOrigin*> OriginConnection::getAll() const
+{
+  std::scoped_lock lock(m_Mutex);
+
+  std::vector<const FilesOrigin*> v;
+  v.reserve(m_Origins.size());
+
+  for (const auto& [id, origin] : m_Origins) {
+    v.push_back(&origin);
+  }
+
+  return v;
+}
+
 void OriginConnection::changeNameLookup(const QString& oldName, const QString& newName)
 {
   std::scoped_lock lock(m_Mutex);
@@ -34,6 +34,10 @@ public:
   const FilesOrigin* findByID(OriginID ID) const;
   FilesOrigin& getByName(const QString& name);
 
+  // every origin, including the disabled ones
+  //
+  std::vector<const FilesOrigin*> getAll() const;
+
   void changePriorityLookup(int oldPriority, int newPriority);
 
   void changeNameLookup(const QString& oldName, const QString& newName);
@@ -0,0 +1,292 @@
+#include "registermemory.h"
+#include "../envfs.h"
+#include "directoryentry.h"
+#include "directorymerge.h"
+#include "fileentry.h"
+#include "filesorigin.h"
+#include <QDateTime>
+#include <map>
+#include <mutex>
+
+using namespace Qt::StringLiterals;
+
+namespace MOShared
+{
+
+namespace
+{
+
+// what the structure looked like before, only used for sizeof()
+struct LegacyArchiveOrigin
+{
+  QString name;
+  int order;
+};
+
+struct LegacyAlternative
+{
+  OriginID originID;
+  LegacyArchiveOrigin archive;
+};
+
+struct LegacyFileEntry
+{
+  FileIndex index;
+  QString name;
+  OriginID origin;
+  LegacyArchiveOrigin archive;
+  std::vector<LegacyAlternative> alternatives;
+  DirectoryEntry* parent;
+  QDateTime fileTime;
+  uint64_t fileSize, compressedFileSize;
+  std::mutex originsMutex;
+};
+
+// rough cost of a heap allocation
+constexpr std::size_t AllocOverhead = 16;
+
+// QArrayData header
+constexpr std::size_t StringHeader = 16;
+
+// red-black tree node header: color and three pointers
+constexpr std::size_t TreeNodeHeader = 32;
+
+// reference counts and vtable of a boost::shared_ptr control block; the
+// legacy one also pointed to the separately allocated entry
+constexpr std::size_t SharedCount       = 16;
+constexpr std::size_t LegacySharedCount = SharedCount + sizeof(void*);
+
+std::size_t alloc(std::size_t n)
+{
+  return n + AllocOverhead;
+}
+
+std::size_t stringBytes(const QString& s)
+{
+  if (s.isEmpty()) {
+    return 0;
+  }
+
+  return alloc(StringHeader + sizeof(char16_t) * (s.size() + 1));
+}
+
+std::size_t hashNode(std::size_t value)
+{
+  // next pointer in the node, plus one bucket
+  return alloc(value + sizeof(void*)) + sizeof(void*);
+}
+
+std::size_t treeNode(std::size_t value)
+{
+  return alloc(value + TreeNodeHeader);
+}
+
+void measureFile(const FileEntry& f, RegisterMemoryReport& r)
+{
+  ++r.files;
+
+  const QString& name  = f.getName();
+  const QString lcname = name.toLower();
+
+  const auto& alts     = f.getAlternatives();
+  const std::size_t n  = alts.size();
+  std::size_t archives = f.isFromArchive() ? 1 : 0;
+
+  for (const auto& a : alts) {
+    if (a.isFromArchive()) {
+      ++archives;
+    }
+  }
+
+  r.alternatives += n;
+  r.archiveRefs += archives;
+
+  // the lookup key has its own copy of the name, except when the name is
+  // already in lowercase and the key shares the pool's data; the register slot
+  // and the origins' sets are the same for both layouts
+  const std::size_t common =
+      sizeof(FileEntryPtr) + (n + 1) * treeNode(sizeof(FileIndex)) +
+      hashNode(sizeof(std::pair<const DirectoryEntryFileKey, FileIndex>));
+
+  // the entry and its control block are a single allocation, alternatives are
+  // inline until there's more than one; the file and archive names are in the
+  // pools
+  r.current += common + (lcname == name ? 0 : stringBytes(lcname)) +
+               alloc(sizeof(FileEntry) + SharedCount) + sizeof(FileIndex);
+
+  if (alts.capacity() > 1) {
+    r.current += alloc(alts.capacity() * sizeof(FileAlternative));
+  }
+
+  // separate allocations for the entry and its control block, the name, a
+  // lowercase copy for the key, a second map sorted by name, a vector for any
+  // alternative and a copy of the archive name for every file and alternative
+  // from an archive
+  r.legacy += common + stringBytes(name) +
+              (lcname == name ? 0 : stringBytes(lcname)) +
+              alloc(sizeof(LegacyFileEntry)) + alloc(LegacySharedCount) +
+              treeNode(sizeof(std::pair<const QString, FileIndex>));
+
+  if (n > 0) {
+    r.legacy += alloc(n * sizeof(LegacyAlternative));
+  }
+
+  if (archives > 0) {
+    const QString& archive =
+        f.isFromArchive() ? f.getArchive().name() : alts.front().archive().name();
+
+    r.legacy += archives * stringBytes(archive);
+  }
+}
+
+void measureDirectory(const DirectoryEntry& d, RegisterMemoryReport& r)
+{
+  ++r.directories;
+
+  // the entry, plus the nodes in the parent's set and lookup map
+  const std::size_t entry =
+      alloc(sizeof(DirectoryEntry)) + treeNode(sizeof(DirectoryEntry*)) +
+      hashNode(sizeof(std::pair<const QString, DirectoryEntry*>)) +
+      stringBytes(d.getName());
+
+  // the sorted vector is shared with its readers, so it and its control block
+  // are allocated separately, only for directories that have files; the legacy
+  // entry had a std::map of files instead
+  r.current += entry;
+  r.legacy += entry + sizeof(std::map<QString, FileIndex>) -
+              sizeof(std::shared_ptr<const std::vector<FileIndex>>);
+
+  if (d.hasFiles()) {
+    r.current += alloc(sizeof(std::vector<FileIndex>) + SharedCount);
+  }
+
+  d.forEachFile([&](const FileEntry& f) {
+    measureFile(f, r);
+    return true;
+  });
+
+  for (const auto* sd : d.getSubDirectories()) {
+    measureDirectory(*sd, r);
+  }
+}
+
+}  // namespace
+
+RegisterMemoryReport RegisterMemoryReport::measure(const DirectoryEntry& root)
+{
+  RegisterMemoryReport r;
+  measureDirectory(root, r);
+
+  r.current += StringPool::instance().memoryUsage();
+  r.current += StringPool::names().memoryUsage();
+
+  return r;
+}
+
+RegisterMemoryReport RegisterMemoryReport::synthetic(std::size_t fileCount)
+{
+  constexpr std::size_t ModCount     = 500;
+  constexpr std::size_t FilesPerDir  = 100;
+  constexpr std::size_t SharedEvery  = 5;
+  constexpr std::size_t ArchiveEvery = 10;
+
+  const std::size_t perMod = std::max<std::size_t>(fileCount / ModCount, 1);
+  const QDateTime time     = QDateTime::currentDateTime();
+
+  // every mod has its own textures, and every fifth file is a mesh that's also
+  // provided by the neighbouring mod
+  std::vector<env::Directory> listings(ModCount);
+
+  for (std::size_t m = 0; m < ModCount; ++m) {
+    // references to the top-level directories are kept below
+    listings[m].dirs.reserve(2);
+
+    env::Directory& textures = listings[m].dirs.emplace_back(u"textures"_s);
+    env::Directory& own      = textures.dirs.emplace_back(u"Mod%1"_s.arg(m));
+
+    env::Directory& meshes = listings[m].dirs.emplace_back(u"meshes"_s);
+    env::Directory& shared = meshes.dirs.emplace_back(u"Common%1"_s.arg(m / 2));
+
+    for (std::size_t i = 0; i < perMod; ++i) {
+      env::Directory& parent = (i % SharedEvery == 0) ? shared : own;
+
+      if (parent.dirs.empty() || parent.dirs.back().files.size() >= FilesPerDir) {
+        parent.dirs.emplace_back(u"Folder%1"_s.arg(parent.dirs.size()));
+      }
+
+      const QString name = (i % SharedEvery == 0) ? u"Mesh%1.nif"_s.arg(i)
+                                                  : u"Texture%1_n.dds"_s.arg(i);
+
+      parent.dirs.back().files.emplace_back(name, time, 1024);
+    }
+  }
+
+  DirectoryEntry root(u"data"_s, nullptr, 0);
+  DirectoryStats stats;
+
+  {
+    DirectoryMerge merge(root);
+
+    for (std::size_t m = 0; m < ModCount; ++m) {
+      FilesOrigin& origin = root.createOrigin(u"Mod%1"_s.arg(m), u"mods/Mod%1"_s.arg(m),
+                                              static_cast<int>(m + 1), stats);
+
+      merge.add(origin, listings[m]);
+    }
+
+    merge.run();
+  }
+
+  listings.clear();
+
+  // some files are also in archives
+  FilesOrigin& archives = root.createOrigin(u"Archives"_s, u"mods/Archives"_s,
+                                            static_cast<int>(ModCount + 1), stats);
+
+  const DataArchiveOrigin textures(u"Synthetic - Textures.bsa"_s, 0);
+  const DataArchiveOrigin meshes(u"Synthetic - Meshes.bsa"_s, 1);
+
+  auto fr = root.getFileRegister();
+
+  for (std::size_t i = 0; i < fr->highestCount(); i += ArchiveEvery) {
+    const auto index = static_cast<FileIndex>(i);
+
+    if (auto f = fr->getFile(index)) {
+      f->addOrigin(archives.getID(), time, (i % 2 == 0) ? textures : meshes);
+      archives.addFile(index);
+    }
+  }
+
+  fr->sortOrigins();
+
+  return measure(root);
+}
+
+QString RegisterMemoryReport::toString() const
+{
+  auto mb = [](std::size_t bytes) {
+    return QString::number(bytes / 1024.0 / 1024.0, 'f', 1);
+  };
+
+  auto perFile = [&](std::size_t bytes) {
+    return QString::number(files > 0 ? bytes / files : 0);
+  };
+
+  const double saved = legacy > 0 ? 100.0 * (1.0 - double(current) / legacy) : 0;
+
+  return QString("%1 directories, %2 files, %3 alternatives, %4 files from archives\n"
+                 "current layout:  %5 MB, %6 bytes per file\n"
+                 "previous layout: %7 MB, %8 bytes per file\n"
+                 "saved: %9%")
+      .arg(directories)
+      .arg(files)
+      .arg(alternatives)
+      .arg(archiveRefs)
+      .arg(mb(current))
+      .arg(perFile(current))
+      .arg(mb(legacy))
+      .arg(perFile(legacy))
+      .arg(saved, 0, 'f', 1);
+}
+
+}  // namespace MOShared
@@ -0,0 +1,44 @@
+#ifndef MO_REGISTER_REGISTERMEMORY_INCLUDED
+#define MO_REGISTER_REGISTERMEMORY_INCLUDED
+
+#include "fileregisterfwd.h"
+#include <QString>
+#include <cstddef>
+
+namespace MOShared
+{
+
+// estimate of the memory used by a directory structure, along with what the
+// layout used before file and archive names were interned and files lost their
+// own mutex would have used for the same files
+//
+// allocations are counted with a fixed overhead for the allocator, so the
+// numbers are only meaningful relative to each other
+//
+struct RegisterMemoryReport
+{
+  std::size_t directories  = 0;
+  std::size_t files        = 0;
+  std::size_t alternatives = 0;
+  std::size_t archiveRefs  = 0;
+
+  // bytes
+  std::size_t current = 0;
+  std::size_t legacy  = 0;
+
+  // walks the given structure
+  //
+  static RegisterMemoryReport measure(const DirectoryEntry& root);
+
+  // builds a structure with the given number of files spread over a few
+  // hundred mods, some of them overwriting each other and some files also
+  // provided by archives, and measures it
+  //
+  static RegisterMemoryReport synthetic(std::size_t fileCount);
+
+  QString toString() const;
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_REGISTERMEMORY_INCLUDED
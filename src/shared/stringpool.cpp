@@ -0,0 +1,113 @@
+#include "stringpool.h"
+#include <log.h>
+
+namespace MOShared
+{
+
+using namespace MOBase;
+
+StringPool& StringPool::instance()
+{
+  static StringPool pool;
+  return pool;
+}
+
+StringPool& StringPool::names()
+{
+  static StringPool pool;
+  return pool;
+}
+
+StringPool::StringPool() : m_Count(1), m_StringBytes(0)
+{
+  for (auto& c : m_Chunks) {
+    c.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+StringPool::~StringPool()
+{
+  for (auto& c : m_Chunks) {
+    delete[] c.load(std::memory_order_relaxed);
+  }
+}
+
+StringId StringPool::intern(QStringView s)
+{
+  if (s.isEmpty()) {
+    return Empty;
+  }
+
+  QString str = s.toString();
+
+  {
+    // most strings are already in the pool
+    std::shared_lock lock(m_Mutex);
+
+    auto itor = m_Ids.find(str);
+    if (itor != m_Ids.end()) {
+      return itor->second;
+    }
+  }
+
+  std::unique_lock lock(m_Mutex);
+
+  // another thread may have added it in the meantime
+  auto itor = m_Ids.find(str);
+  if (itor != m_Ids.end()) {
+    return itor->second;
+  }
+
+  const std::size_t id    = m_Count.load(std::memory_order_relaxed);
+  const std::size_t chunk = id / ChunkSize;
+
+  if (chunk >= MaxChunks) {
+    log::error("string pool is full, cannot add '{}'", str);
+    return Empty;
+  }
+
+  QString* strings = m_Chunks[chunk].load(std::memory_order_relaxed);
+  if (!strings) {
+    strings = new QString[ChunkSize];
+    m_Chunks[chunk].store(strings, std::memory_order_release);
+  }
+
+  // the string is shared between the chunk and the lookup map
+  strings[id % ChunkSize] = str;
+  m_StringBytes += sizeof(char16_t) * (str.size() + 1);
+  m_Ids.emplace(std::move(str), static_cast<StringId>(id));
+
+  // publishes the string
+  m_Count.store(id + 1, std::memory_order_release);
+
+  return static_cast<StringId>(id);
+}
+
+const QString& StringPool::get(StringId id) const
+{
+  static const QString empty;
+
+  if (id == Empty || id >= size()) {
+    return empty;
+  }
+
+  const QString* strings = m_Chunks[id / ChunkSize].load(std::memory_order_acquire);
+  return strings[id % ChunkSize];
+}
+
+std::size_t StringPool::memoryUsage() const
+{
+  std::shared_lock lock(m_Mutex);
+
+  const std::size_t chunks = (m_Count.load() + ChunkSize - 1) / ChunkSize;
+
+  // hash nodes hold the key, the id and a pointer to the next node, plus one
+  // bucket pointer each
+  const std::size_t nodes =
+      m_Ids.size() * (sizeof(QString) + sizeof(StringId) + 2 * sizeof(void*));
+
+  return sizeof(*this) + chunks * ChunkSize * sizeof(QString) + nodes +
+         m_StringBytes;
+}
+
+}  // namespace MOShared
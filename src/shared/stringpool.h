@@ -0,0 +1,78 @@
+#ifndef MO_REGISTER_STRINGPOOL_INCLUDED
+#define MO_REGISTER_STRINGPOOL_INCLUDED
+
+#include <QString>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace MOShared
+{
+
+using StringId = std::uint32_t;
+
+// stores each distinct string once and hands out ids for them; strings are
+// never removed
+//
+// interning takes a lock, shared unless the string is new, but looking up a
+// string by id doesn't: strings are stored in fixed-size chunks that never move
+// once allocated
+//
+class StringPool
+{
+public:
+  // the empty string always has this id and is never stored
+  static constexpr StringId Empty = 0;
+
+  // pool used by the directory structure, for archive names
+  //
+  static StringPool& instance();
+
+  // pool used by the directory structure for the names of files, most of which
+  // are shared by many directories, like "meta.ini" or "_n.dds" variants
+  //
+  static StringPool& names();
+
+  StringPool();
+  ~StringPool();
+
+  // noncopyable
+  StringPool(const StringPool&)            = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // returns the id of the given string, adding it if needed
+  //
+  StringId intern(QStringView s);
+
+  // returns the string for the given id, which must have been returned by
+  // intern()
+  //
+  const QString& get(StringId id) const;
+
+  // number of strings, including the empty string
+  //
+  std::size_t size() const { return m_Count.load(std::memory_order_acquire); }
+
+  // bytes used by the pool, including the string data
+  //
+  std::size_t memoryUsage() const;
+
+private:
+  static constexpr std::size_t ChunkSize = 1024;
+  static constexpr std::size_t MaxChunks = 16384;
+
+  std::array<std::atomic<QString*>, MaxChunks> m_Chunks;
+  std::atomic<std::size_t> m_Count;
+
+  mutable std::shared_mutex m_Mutex;
+  std::unordered_map<QString, StringId> m_Ids;
+  std::size_t m_StringBytes;
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_STRINGPOOL_INCLUDED
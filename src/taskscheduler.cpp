@@ -0,0 +1,311 @@
+#include "taskscheduler.h"
+#include "shared/util.h"
+#include <log.h>
+
+using namespace MOBase;
+
+namespace MOShared
+{
+
+namespace
+{
+
+std::atomic<std::size_t> g_globalThreadCount = 0;
+
+// set for worker threads only
+thread_local const TaskScheduler* t_scheduler = nullptr;
+thread_local std::size_t t_worker             = static_cast<std::size_t>(-1);
+
+double seconds(std::chrono::nanoseconds ns)
+{
+  return std::chrono::duration<double>(ns).count();
+}
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(std::size_t threadCount)
+    : m_Queued(0), m_NextQueue(0), m_Stop(false)
+{
+  threadCount = std::max<std::size_t>(threadCount, 1);
+
+  // all the workers must exist before any of them starts stealing
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    m_Workers.push_back(std::make_unique<Worker>());
+  }
+
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    m_Workers[i]->thread = startSafeThread([this, i] {
+      workerLoop(i);
+    });
+  }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    std::scoped_lock lock(m_SleepMutex);
+    m_Stop = true;
+  }
+
+  m_SleepCondition.notify_all();
+
+  for (auto& w : m_Workers) {
+    if (w->thread.joinable()) {
+      w->thread.join();
+    }
+  }
+}
+
+TaskScheduler& TaskScheduler::global()
+{
+  static TaskScheduler s([] {
+    const std::size_t n = g_globalThreadCount;
+    return n > 0 ? n : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  }());
+
+  return s;
+}
+
+void TaskScheduler::setGlobalThreadCount(std::size_t n)
+{
+  g_globalThreadCount = n;
+}
+
+std::size_t TaskScheduler::currentWorker() const
+{
+  if (t_scheduler == this) {
+    return t_worker;
+  }
+
+  return static_cast<std::size_t>(-1);
+}
+
+void TaskScheduler::submit(Task t)
+{
+  const auto self = currentWorker();
+
+  // tasks submitted by a worker stay on that worker unless they're stolen,
+  // they're likely to work on data that's already in its cache
+  const auto q = (self < m_Workers.size()) ? self : (m_NextQueue++ % m_Workers.size());
+
+  // counted before it's pushed, workers decrement the counter as soon as they
+  // pop a task, which would otherwise underflow if they got to it first
+  {
+    std::scoped_lock lock(m_SleepMutex);
+    ++m_Queued;
+  }
+
+  {
+    std::scoped_lock lock(m_Workers[q]->mutex);
+    m_Workers[q]->tasks.push_back(std::move(t));
+  }
+
+  m_SleepCondition.notify_one();
+}
+
+bool TaskScheduler::pop(std::size_t self, Task& t)
+{
+  const auto count = m_Workers.size();
+
+  if (self < count) {
+    auto& w = *m_Workers[self];
+    std::scoped_lock lock(w.mutex);
+
+    if (!w.tasks.empty()) {
+      t = std::move(w.tasks.back());
+      w.tasks.pop_back();
+      --m_Queued;
+      return true;
+    }
+  }
+
+  // steal the oldest task of another worker, those are usually the biggest
+  const auto start = (self < count) ? self + 1 : 0;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto victim = (start + i) % count;
+    if (victim == self) {
+      continue;
+    }
+
+    auto& w = *m_Workers[victim];
+    std::scoped_lock lock(w.mutex);
+
+    if (!w.tasks.empty()) {
+      t = std::move(w.tasks.front());
+      w.tasks.pop_front();
+      --m_Queued;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void TaskScheduler::run(std::size_t self, Task& t)
+{
+  std::exception_ptr e;
+  const auto start = std::chrono::steady_clock::now();
+
+  try {
+    t.f();
+  } catch (...) {
+    e = std::current_exception();
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+
+  // the group may be destroyed as soon as this returns
+  t.group->taskDone({std::move(t.name), self, end - start}, e);
+}
+
+void TaskScheduler::workerLoop(std::size_t self)
+{
+  t_scheduler = this;
+  t_worker    = self;
+
+  SetThisThreadName(QString("task worker %1").arg(self));
+
+  for (;;) {
+    Task t;
+
+    if (pop(self, t)) {
+      run(self, t);
+      continue;
+    }
+
+    std::unique_lock lock(m_SleepMutex);
+    m_SleepCondition.wait(lock, [&] {
+      return m_Stop || m_Queued > 0;
+    });
+
+    if (m_Stop && m_Queued == 0) {
+      break;
+    }
+  }
+}
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler) : m_Scheduler(scheduler), m_Pending(0)
+{}
+
+TaskGroup::~TaskGroup()
+{
+  waitImpl();
+
+  if (!m_Exception) {
+    return;
+  }
+
+  try {
+    std::rethrow_exception(m_Exception);
+  } catch (const std::exception& e) {
+    log::error("unhandled exception in a task: {}", e.what());
+  } catch (...) {
+    log::error("unhandled exception in a task");
+  }
+}
+
+void TaskGroup::wait()
+{
+  waitImpl();
+
+  std::scoped_lock lock(m_TimingsMutex);
+  if (m_Exception) {
+    auto e      = m_Exception;
+    m_Exception = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+void TaskGroup::waitImpl()
+{
+  const auto self = m_Scheduler.currentWorker();
+
+  if (self < m_Scheduler.threadCount()) {
+    // blocking a worker while its own queue may contain tasks of this group
+    // would deadlock, so run tasks until there's nothing left to run; this may
+    // run tasks of other groups
+    while (m_Pending > 0) {
+      TaskScheduler::Task t;
+
+      if (!m_Scheduler.pop(self, t)) {
+        // the remaining tasks are running on other workers
+        break;
+      }
+
+      m_Scheduler.run(self, t);
+    }
+  }
+
+  // always checked with the mutex held, taskDone() may still be using this
+  // object otherwise
+  std::unique_lock lock(m_DoneMutex);
+  m_DoneCondition.wait(lock, [&] {
+    return m_Pending == 0;
+  });
+}
+
+void TaskGroup::taskDone(TaskTiming timing, std::exception_ptr e)
+{
+  {
+    std::scoped_lock lock(m_TimingsMutex);
+    m_Timings.push_back(std::move(timing));
+
+    if (e && !m_Exception) {
+      m_Exception = e;
+    }
+  }
+
+  std::scoped_lock lock(m_DoneMutex);
+  if (--m_Pending == 0) {
+    m_DoneCondition.notify_all();
+  }
+}
+
+std::vector<TaskTiming> TaskGroup::timings() const
+{
+  std::scoped_lock lock(m_TimingsMutex);
+  return m_Timings;
+}
+
+void TaskGroup::logTimings(const QString& what) const
+{
+  auto ts = timings();
+  if (ts.empty()) {
+    return;
+  }
+
+  std::chrono::nanoseconds total(0);
+  std::vector<std::chrono::nanoseconds> perWorker(m_Scheduler.threadCount(),
+                                                  std::chrono::nanoseconds(0));
+
+  for (const auto& t : ts) {
+    total += t.duration;
+
+    // tasks run by a thread that was waiting on the group are not counted per
+    // worker
+    if (t.worker < perWorker.size()) {
+      perWorker[t.worker] += t.duration;
+    }
+  }
+
+  const auto [least, most] = std::ranges::minmax_element(perWorker);
+
+  log::debug("{}: {} tasks, {:.3f}s of work on {} workers, busiest worker {:.3f}s, "
+             "least busy worker {:.3f}s",
+             what, ts.size(), seconds(total), perWorker.size(), seconds(*most),
+             seconds(*least));
+
+  const std::size_t slowest = std::min<std::size_t>(ts.size(), 5);
+
+  std::ranges::partial_sort(ts, ts.begin() + slowest, [](auto&& a, auto&& b) {
+    return a.duration > b.duration;
+  });
+
+  for (std::size_t i = 0; i < slowest; ++i) {
+    log::debug(" . {}: {:.3f}s on worker {}", ts[i].name, seconds(ts[i].duration),
+               ts[i].worker);
+  }
+}
+
+}  // namespace MOShared
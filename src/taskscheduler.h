@@ -0,0 +1,237 @@
+#ifndef MO2_TASKSCHEDULER_H
+#define MO2_TASKSCHEDULER_H
+
+#include "thread_utils.h"
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MOShared
+{
+
+class TaskGroup;
+
+// time spent by a single task, as recorded by its group
+//
+struct TaskTiming
+{
+  QString name;
+  std::size_t worker;
+  std::chrono::nanoseconds duration;
+};
+
+/**
+ * @brief a fixed set of worker threads that execute tasks
+ *
+ * each worker has its own queue; tasks submitted from a worker go to the back of
+ * its own queue and tasks submitted from other threads are distributed over all
+ * the queues. a worker runs tasks from the back of its own queue and steals from
+ * the front of the other queues when its own is empty. idle workers sleep until
+ * a task is submitted
+ *
+ * tasks are always submitted through a TaskGroup, which is used to wait for
+ * them
+ **/
+class TaskScheduler
+{
+public:
+  TaskScheduler(std::size_t threadCount);
+  ~TaskScheduler();
+
+  // noncopyable
+  TaskScheduler(const TaskScheduler&)            = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  /**
+   * @brief scheduler shared by the directory refresher and parallelMap()
+   *
+   * the scheduler is created on first use, with the number of threads given to
+   * setGlobalThreadCount() or the number of cores if it was never called
+   **/
+  static TaskScheduler& global();
+
+  /**
+   * @brief sets the number of threads of the global scheduler, has no effect
+   * once global() has been called
+   **/
+  static void setGlobalThreadCount(std::size_t n);
+
+  std::size_t threadCount() const { return m_Workers.size(); }
+
+private:
+  friend class TaskGroup;
+
+  struct Task
+  {
+    TaskGroup* group;
+    QString name;
+    std::function<void()> f;
+  };
+
+  struct Worker
+  {
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> m_Workers;
+
+  // number of tasks in all the queues, used by sleeping workers
+  std::atomic<std::size_t> m_Queued;
+  std::mutex m_SleepMutex;
+  std::condition_variable m_SleepCondition;
+
+  std::atomic<std::size_t> m_NextQueue;
+  bool m_Stop;
+
+  void submit(Task t);
+
+  // pops a task from the back of the given worker's queue or steals one from
+  // the front of another queue; the index can be out of range for threads that
+  // are not workers, in which case this only steals
+  bool pop(std::size_t self, Task& t);
+
+  void run(std::size_t self, Task& t);
+  void workerLoop(std::size_t self);
+
+  // index of the worker for the current thread, or -1 if this thread is not a
+  // worker of this scheduler
+  std::size_t currentWorker() const;
+};
+
+/**
+ * @brief a set of tasks that can be waited for
+ *
+ * tasks are timed individually, timings() can be used after wait() to see how
+ * the work was spread over the workers
+ *
+ * the destructor waits for all the tasks, exceptions that were never rethrown
+ * by wait() are logged
+ **/
+class TaskGroup
+{
+public:
+  TaskGroup(TaskScheduler& scheduler = TaskScheduler::global());
+  ~TaskGroup();
+
+  // noncopyable
+  TaskGroup(const TaskGroup&)            = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  /**
+   * @brief submits a task, can be called from within another task of this group
+   *
+   * @param name name of the task, only used for timings
+   **/
+  template <class F>
+  void run(QString name, F&& f)
+  {
+    m_Pending.fetch_add(1);
+    m_Scheduler.submit(
+        {this, std::move(name), std::function<void()>(std::forward<F>(f))});
+  }
+
+  /**
+   * @brief blocks until all the tasks of this group are done, including tasks
+   * submitted by tasks
+   *
+   * when called from a worker, this runs queued tasks until the group is done
+   * instead of blocking the worker
+   *
+   * if a task threw an exception, the first one is rethrown here
+   **/
+  void wait();
+
+  // timings of all the tasks that finished since the group was created
+  //
+  std::vector<TaskTiming> timings() const;
+
+  // logs how long the tasks took overall and on each worker, along with the
+  // slowest tasks
+  //
+  void logTimings(const QString& what) const;
+
+private:
+  friend class TaskScheduler;
+
+  TaskScheduler& m_Scheduler;
+  std::atomic<std::size_t> m_Pending;
+  std::mutex m_DoneMutex;
+  std::condition_variable m_DoneCondition;
+
+  mutable std::mutex m_TimingsMutex;
+  std::vector<TaskTiming> m_Timings;
+  std::exception_ptr m_Exception;
+
+  void waitImpl();
+  void taskDone(TaskTiming timing, std::exception_ptr e);
+};
+
+/**
+ * @brief Apply the given callable to each element between the two given iterators
+ *     in a parallel way.
+ *
+ * The callable should be independent, or properly synchronized, and the source of
+ * the range should not change during this call.
+ *
+ * @param start Beginning of the range.
+ * @param end End of the range.
+ * @param callable Callable to apply to every element of the range. See std::invoke
+ *     requirements. Must be copiable.
+ * @param nThreads Maximum number of elements processed at the same time, the
+ *     elements are processed by the global scheduler and by the calling thread,
+ *     so the range is processed even if the workers are busy with other tasks.
+ *
+ */
+template <class It, class Callable>
+void parallelMap(It begin, It end, Callable callable, std::size_t nThreads)
+{
+  std::mutex m;
+  TaskGroup group;
+
+  const auto n = std::max<std::size_t>(
+      1, std::min(nThreads, TaskScheduler::global().threadCount()));
+
+  // every task processes elements until the range is exhausted:
+  //  - The mutex is only used to fetch/increment the iterator.
+  //  - The callable is copied in each task to avoid conflicts.
+  const auto work = [&m, &begin, end, callable]() {
+    while (true) {
+      decltype(begin) it;
+      {
+        std::scoped_lock lock(m);
+        if (begin == end) {
+          break;
+        }
+        it = begin++;
+      }
+      if (it != end) {
+        std::invoke(callable, *it);
+      }
+    }
+  };
+
+  for (std::size_t i = 1; i < n; ++i) {
+    group.run(QStringLiteral("parallelMap"), work);
+  }
+
+  // the calling thread takes its share, so a caller on the UI thread doesn't
+  // have to wait for workers that are busy with a refresh
+  work();
+
+  group.wait();
+}
+
+}  // namespace MOShared
+
+#endif  // MO2_TASKSCHEDULER_H
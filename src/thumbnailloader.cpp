@@ -0,0 +1,308 @@
+#include "thumbnailloader.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <log.h>
+
+using namespace MOBase;
+using namespace MOShared;
+
+namespace
+{
+
+// text key of the cached thumbnails with the size of the full image
+const QString OriginalSizeKey = QStringLiteral("OriginalSize");
+
+// thumbnails are cached at this size and scaled down in memory to the size they
+// are shown at, so resizing the dialog doesn't decode the images again
+const QSize CachedSize(512, 512);
+
+// the oldest thumbnails are removed once the cache directory is larger than
+// this, see trimCache()
+constexpr qint64 MaxCacheSize = 64 * 1024 * 1024;
+
+// name of the cached thumbnail, anything that changes the thumbnail changes
+// the name, so stale thumbnails are never used
+//
+QString cacheName(const QFileInfo& fi)
+{
+  const QString key = QStringLiteral("%1|%2|%3|%4x%5")
+                          .arg(fi.absoluteFilePath())
+                          .arg(fi.size())
+                          .arg(fi.lastModified().toMSecsSinceEpoch())
+                          .arg(CachedSize.width())
+                          .arg(CachedSize.height());
+
+  return QString::fromLatin1(
+             QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex()) +
+         ".png";
+}
+
+QSize parseSize(const QString& s)
+{
+  const auto parts = s.split('x');
+  if (parts.size() != 2) {
+    return {};
+  }
+
+  return QSize(parts[0].toInt(), parts[1].toInt());
+}
+
+bool readCached(const QString& file, ThumbnailLoader::Thumbnail& t)
+{
+  if (!QFileInfo::exists(file)) {
+    return false;
+  }
+
+  QImageReader reader(file, "png");
+  QImage image;
+
+  if (!reader.read(&image)) {
+    log::warn("bad cached thumbnail '{}', {}", file, reader.errorString());
+    return false;
+  }
+
+  const QSize original = parseSize(image.text(OriginalSizeKey));
+  if (!original.isValid()) {
+    return false;
+  }
+
+  t.image        = std::move(image);
+  t.originalSize = original;
+
+  return true;
+}
+
+void writeCached(const QString& file, const ThumbnailLoader::Thumbnail& t)
+{
+  QImage image = t.image;
+  image.setText(OriginalSizeKey, QStringLiteral("%1x%2")
+                                     .arg(t.originalSize.width())
+                                     .arg(t.originalSize.height()));
+
+  // written to a temporary file first, another loader might be reading it
+  QSaveFile f(file);
+  if (!f.open(QIODevice::WriteOnly)) {
+    log::warn("can't cache thumbnail in '{}', {}", file, f.errorString());
+    return;
+  }
+
+  QImageWriter writer(&f, "png");
+  if (!writer.write(image) || !f.commit()) {
+    log::warn("can't cache thumbnail in '{}', {}", file, writer.errorString());
+  }
+}
+
+// decodes the image at the largest size that fits in `available`
+//
+bool decode(const QString& path, const QSize& available, ThumbnailLoader::Thumbnail& t)
+{
+  QImageReader reader(path);
+  QSize original = reader.size();
+  QImage image;
+
+  if (original.isValid()) {
+    // most handlers decode at this size directly, the image is scaled after
+    // decoding by the others
+    reader.setScaledSize(resizeWithAspectRatio(original, available));
+
+    if (!reader.read(&image)) {
+      image = {};
+    }
+  } else {
+    // the size is not in the header, the whole image must be decoded
+    if (reader.read(&image)) {
+      original = image.size();
+      image    = image.scaled(resizeWithAspectRatio(original, available),
+                              Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    } else {
+      image = {};
+    }
+  }
+
+  if (image.isNull()) {
+    log::error("failed to load '{}'\n{} (error {})", path, reader.errorString(),
+               static_cast<int>(reader.error()));
+
+    return false;
+  }
+
+  t.image        = std::move(image);
+  t.originalSize = original;
+
+  return true;
+}
+
+}  // namespace
+
+QSize resizeWithAspectRatio(const QSize& original, const QSize& available)
+{
+  const auto ratio =
+      std::min({1.0, static_cast<double>(available.width()) / original.width(),
+                static_cast<double>(available.height()) / original.height()});
+
+  const QSize scaledSize(static_cast<int>(std::round(original.width() * ratio)),
+                         static_cast<int>(std::round(original.height() * ratio)));
+
+  return scaledSize;
+}
+
+ThumbnailLoader::ThumbnailLoader(QString cacheDirectory, QObject* parent)
+    : QObject(parent), m_CacheDirectory(std::move(cacheDirectory)),
+      m_MaxRunning(TaskScheduler::global().threadCount()), m_Running(0)
+{
+  if (m_CacheDirectory.isEmpty()) {
+    return;
+  }
+
+  if (!QDir().mkpath(m_CacheDirectory)) {
+    log::warn("can't create thumbnail cache directory '{}'", m_CacheDirectory);
+    return;
+  }
+
+  m_Group.run(QStringLiteral("thumbnail cache"), [this] {
+    trimCache(m_CacheDirectory, MaxCacheSize);
+  });
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+  clear();
+  m_Group.wait();
+}
+
+void ThumbnailLoader::load(const std::vector<QString>& paths, const QSize& available)
+{
+  std::size_t start = 0;
+
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    m_Queue.clear();
+
+    for (const auto& path : paths) {
+      if (!m_Loading.contains(path)) {
+        m_Queue.push_back({path, available});
+      }
+    }
+
+    while (m_Running < m_MaxRunning && m_Running < m_Queue.size()) {
+      ++m_Running;
+      ++start;
+    }
+  }
+
+  for (std::size_t i = 0; i < start; ++i) {
+    m_Group.run(QStringLiteral("thumbnails"), [this] {
+      pump();
+    });
+  }
+}
+
+void ThumbnailLoader::clear()
+{
+  std::scoped_lock lock(m_Mutex);
+  m_Queue.clear();
+}
+
+void ThumbnailLoader::pump()
+{
+  for (;;) {
+    Request r;
+
+    {
+      std::scoped_lock lock(m_Mutex);
+
+      if (m_Queue.empty()) {
+        --m_Running;
+        return;
+      }
+
+      r = std::move(m_Queue.front());
+      m_Queue.pop_front();
+      m_Loading.insert(r.path);
+    }
+
+    auto t = loadThumbnail(m_CacheDirectory, r.path, r.available);
+
+    {
+      std::scoped_lock lock(m_Mutex);
+      m_Loading.erase(r.path);
+    }
+
+    // delivered on the thread of the loader, dropped if it's destroyed first
+    QMetaObject::invokeMethod(
+        this,
+        [this, t = std::move(t)] {
+          emit loaded(t);
+        },
+        Qt::QueuedConnection);
+  }
+}
+
+ThumbnailLoader::Thumbnail ThumbnailLoader::loadThumbnail(const QString& cacheDirectory,
+                                                         const QString& path,
+                                                         const QSize& available)
+{
+  Thumbnail t;
+  t.path      = path;
+  t.available = available;
+
+  // thumbnails larger than the cached ones are rare and are decoded every time
+  const bool cacheable = (available.width() <= CachedSize.width() &&
+                          available.height() <= CachedSize.height());
+
+  if (cacheDirectory.isEmpty() || !cacheable) {
+    decode(path, available, t);
+    return t;
+  }
+
+  const QString cached = cacheDirectory + "/" + cacheName(QFileInfo(path));
+
+  if (!readCached(cached, t)) {
+    if (!decode(path, CachedSize, t)) {
+      return t;
+    }
+
+    writeCached(cached, t);
+  }
+
+  const QSize scaledSize = resizeWithAspectRatio(t.originalSize, available);
+
+  if (t.image.size() != scaledSize) {
+    t.image =
+        t.image.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  }
+
+  return t;
+}
+
+void ThumbnailLoader::trimCache(const QString& cacheDirectory, qint64 maxSize)
+{
+  // newest first, everything after the size limit is removed
+  const QDir dir(cacheDirectory);
+  const auto files =
+      dir.entryInfoList({QStringLiteral("*.png")}, QDir::Files, QDir::Time);
+
+  qint64 total        = 0;
+  std::size_t removed = 0;
+
+  for (const auto& fi : files) {
+    total += fi.size();
+
+    if (total > maxSize && QFile::remove(fi.absoluteFilePath())) {
+      ++removed;
+    }
+  }
+
+  if (removed > 0) {
+    log::debug("removed {} old thumbnails from the cache", removed);
+  }
+}
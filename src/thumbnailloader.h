@@ -0,0 +1,117 @@
+#ifndef MODORGANIZER_THUMBNAILLOADER_INCLUDED
+#define MODORGANIZER_THUMBNAILLOADER_INCLUDED
+
+#include "taskscheduler.h"
+#include <QImage>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <vector>
+
+// returns the largest size that fits in `available` while keeping the aspect
+// ratio of `original`, images are never scaled up
+//
+QSize resizeWithAspectRatio(const QSize& original, const QSize& available);
+
+/**
+ * @brief loads thumbnails of images on the worker threads
+ *
+ * images are decoded directly at the size of the thumbnail, which avoids
+ * decoding the full image for most formats; thumbnails are also saved at one
+ * fixed size in a cache directory, keyed by the path, size and modification
+ * time of the image, and scaled down in memory to the size they're shown at,
+ * so they're only decoded once no matter how the dialog is resized
+ *
+ * the oldest thumbnails are removed when the cache directory gets too large
+ *
+ * the loader keeps a queue of the thumbnails that are wanted, which is replaced
+ * every time load() is called, so only the thumbnails that are still wanted get
+ * loaded; thumbnails that are being loaded are not interrupted
+ **/
+class ThumbnailLoader : public QObject
+{
+  Q_OBJECT;
+
+public:
+  struct Thumbnail
+  {
+    // path of the image
+    QString path;
+
+    // size the thumbnail had to fit in
+    QSize available;
+
+    // the thumbnail, null if the image couldn't be loaded
+    QImage image;
+
+    // size of the full image
+    QSize originalSize;
+  };
+
+  // thumbnails are saved in the given directory, which is created if needed
+  // and trimmed in the background; nothing is saved if it's empty
+  //
+  ThumbnailLoader(QString cacheDirectory, QObject* parent = nullptr);
+
+  // forgets the queued thumbnails and waits for the ones that are being loaded
+  //
+  ~ThumbnailLoader();
+
+  // noncopyable
+  ThumbnailLoader(const ThumbnailLoader&)            = delete;
+  ThumbnailLoader& operator=(const ThumbnailLoader&) = delete;
+
+  // replaces the queue by the given images, which are loaded in order; images
+  // that are already being loaded are skipped
+  //
+  void load(const std::vector<QString>& paths, const QSize& available);
+
+  // forgets the queued thumbnails
+  //
+  void clear();
+
+  // loads the thumbnail of the given image from the cache directory, or
+  // decodes it and saves it in the cache directory; can be called from any
+  // thread
+  //
+  static Thumbnail loadThumbnail(const QString& cacheDirectory, const QString& path,
+                                 const QSize& available);
+
+  // removes the oldest thumbnails from the cache directory until it's no
+  // larger than the given number of bytes; can be called from any thread
+  //
+  static void trimCache(const QString& cacheDirectory, qint64 maxSize);
+
+signals:
+  // emitted on the thread of the loader once a thumbnail has been loaded
+  //
+  void loaded(const ThumbnailLoader::Thumbnail& t);
+
+private:
+  struct Request
+  {
+    QString path;
+    QSize available;
+  };
+
+  const QString m_CacheDirectory;
+  const std::size_t m_MaxRunning;
+
+  // guards the queue, the images being loaded and the number of tasks
+  std::mutex m_Mutex;
+  std::deque<Request> m_Queue;
+  std::set<QString> m_Loading;
+  std::size_t m_Running;
+
+  // declared last so it's destroyed first, which waits for the tasks
+  MOShared::TaskGroup m_Group;
+
+  // loads thumbnails from the queue until it's empty, runs on a worker
+  //
+  void pump();
+};
+
+#endif  // MODORGANIZER_THUMBNAILLOADER_INCLUDED
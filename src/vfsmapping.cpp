@@ -0,0 +1,147 @@
+#include "vfsmapping.h"
+#include <QDir>
+#include <QHash>
+#include <QString>
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+
+bool sameLink(const Mapping& a, const Mapping& b)
+{
+  return a.source == b.source && a.destination == b.destination;
+}
+
+bool sameFlags(const Mapping& a, const Mapping& b)
+{
+  return a.isDirectory == b.isDirectory && a.createTarget == b.createTarget;
+}
+
+QString linkKey(const Mapping& m)
+{
+  return m.source + QChar(0) + m.destination;
+}
+
+}  // namespace
+
+MappingChanges MappingChanges::compute(const MappingType& applied,
+                                       const MappingType& next)
+{
+  MappingChanges c;
+
+  const std::size_t n = std::min(applied.size(), next.size());
+
+  while (c.common < n && sameLink(applied[c.common], next[c.common]) &&
+         sameFlags(applied[c.common], next[c.common])) {
+    ++c.common;
+  }
+
+  c.identical  = (c.common == applied.size() && c.common == next.size());
+  c.appendOnly = (c.common == applied.size());
+
+  if (c.identical) {
+    return c;
+  }
+
+  // links of the applied mapping past the common part, by source and destination
+  std::unordered_map<QString, const Mapping*> old;
+  old.reserve(applied.size() - c.common);
+
+  for (std::size_t i = c.common; i < applied.size(); ++i) {
+    old.emplace(linkKey(applied[i]), &applied[i]);
+  }
+
+  for (std::size_t i = c.common; i < next.size(); ++i) {
+    auto itor = old.find(linkKey(next[i]));
+
+    if (itor == old.end()) {
+      ++c.added;
+    } else {
+      if (!sameFlags(*itor->second, next[i])) {
+        ++c.changed;
+      }
+
+      old.erase(itor);
+    }
+  }
+
+  c.removed = old.size();
+
+  return c;
+}
+
+std::size_t ModMappingInputs::token() const
+{
+  std::size_t h = qHashMulti(0, profile, overwritePath, contentToken);
+
+  for (const auto& m : mods) {
+    h = qHashMulti(h, m.name, m.path, m.regular);
+  }
+
+  for (const auto& [from, to] : dataMaps) {
+    h = qHashMulti(h, from, to);
+  }
+
+  return h;
+}
+
+ModMapping ModMapping::build(const ModMappingInputs& in)
+{
+  ModMapping mm;
+  mm.token = in.token();
+
+  for (const auto& mod : in.mods) {
+    mm.activeMods.push_back(mod.name);
+
+    if (!mod.regular) {
+      continue;
+    }
+
+    const QDir modDir(mod.path);
+
+    for (const auto& [from, to] : in.dataMaps) {
+      const QDir mapDir(modDir.absoluteFilePath(from));
+
+      if (!mapDir.exists()) {
+        continue;
+      }
+
+      for (const auto& dir : to) {
+        mm.modLinks.push_back({mapDir.absolutePath(), dir, true, false});
+        mm.modNames.push_back(mod.name);
+      }
+    }
+  }
+
+  const QDir overwriteDir(in.overwritePath);
+
+  for (const auto& [from, to] : in.dataMaps) {
+    const QString overwriteSubpath = overwriteDir.absoluteFilePath(from);
+
+    if (!QDir(overwriteSubpath).exists()) {
+      continue;
+    }
+
+    for (const auto& dir : to) {
+      mm.overwriteLinks.push_back({overwriteSubpath, dir, true, true});
+    }
+  }
+
+  return mm;
+}
+
+bool ModMapping::setWriteTarget(const QString& customOverwrite)
+{
+  for (std::size_t i = 0; i < modLinks.size(); ++i) {
+    modLinks[i].createTarget = (modNames[i] == customOverwrite);
+  }
+
+  for (auto& m : overwriteLinks) {
+    m.createTarget = customOverwrite.isEmpty();
+  }
+
+  return customOverwrite.isEmpty() ||
+         std::find(activeMods.begin(), activeMods.end(), customOverwrite) !=
+             activeMods.end();
+}
@@ -0,0 +1,98 @@
+#ifndef MODORGANIZER_VFSMAPPING_INCLUDED
+#define MODORGANIZER_VFSMAPPING_INCLUDED
+
+#include <QString>
+#include <QStringList>
+#include <cstddef>
+#include <cstdint>
+#include <filemapping.h>
+#include <utility>
+#include <vector>
+
+// differences between the mapping that was last applied to the vfs and a new
+// one
+//
+// the vfs can only add links or drop all of them, and links that come later
+// take precedence; a new mapping can therefore only be applied incrementally
+// if it starts with the whole mapping that was applied, anything else needs
+// the vfs to be cleared and every link to be added again
+//
+struct MappingChanges
+{
+  // number of links at the start of both mappings that are the same
+  std::size_t common = 0;
+
+  // for logging only: links that are only in the new mapping, only in the old
+  // one, or in both but with different flags
+  std::size_t added   = 0;
+  std::size_t removed = 0;
+  std::size_t changed = 0;
+
+  // whether the new mapping is the same as the applied one
+  bool identical = false;
+
+  // whether the new mapping only has links added at the end of the applied
+  // one, in which case only the links starting at `common` need to be added
+  bool appendOnly = false;
+
+  static MappingChanges compute(const MappingType& applied, const MappingType& next);
+};
+
+// everything the links of the mods and overwrite depend on, captured on the ui
+// thread so the links can be built on another one
+//
+struct ModMappingInputs
+{
+  struct Mod
+  {
+    QString name;
+    QString path;
+    bool regular;
+  };
+
+  QString profile;
+
+  // active mods by ascending priority, without overwrite
+  std::vector<Mod> mods;
+
+  // directories of a mod and where they're mapped, from the game plugin
+  std::vector<std::pair<QString, QStringList>> dataMaps;
+
+  QString overwritePath;
+
+  // changes whenever mod directories may have been added or removed, see
+  // OrganizerCore::vfsContentToken()
+  std::size_t contentToken = 0;
+
+  // identifies these inputs
+  //
+  std::size_t token() const;
+};
+
+// links of the mods and overwrite, the part of the mapping that checks
+// directories on disk; this can be built in the background and used later if
+// the token of the inputs hasn't changed
+//
+struct ModMapping
+{
+  std::size_t token = 0;
+
+  // links of the mods, with the mod they belong to
+  MappingType modLinks;
+  std::vector<QString> modNames;
+
+  // links of overwrite, which come after the local saves
+  MappingType overwriteLinks;
+
+  // every active mod, including the ones without links
+  std::vector<QString> activeMods;
+
+  static ModMapping build(const ModMappingInputs& in);
+
+  // sets the target for writes to the given mod, or to overwrite if it's
+  // empty; returns false if the mod is not active
+  //
+  bool setWriteTarget(const QString& customOverwrite);
+};
+
+#endif  // MODORGANIZER_VFSMAPPING_INCLUDED
@@ -0,0 +1,65 @@
+#include "envfs.h"
+#include <QDir>
+#include <utility.h>
+#include <windows.h>
+
+namespace env
+{
+
+// the walker has no state on Windows
+struct DirectoryWalker::Native
+{};
+
+namespace
+{
+
+QString makeNtPath(const QString& path)
+{
+  static const QString nt_prefix     = QStringLiteral("\\??\\");
+  static const QString nt_unc_prefix = QStringLiteral("\\??\\UNC\\");
+  static const QString share_prefix  = QStringLiteral("\\\\");
+
+  if (path.startsWith(nt_prefix)) {
+    // already an nt path
+    return path;
+  } else if (path.startsWith(share_prefix)) {
+    // network shared need \??\UNC\ as a prefix
+    return nt_unc_prefix + path.sliced(2);
+  } else {
+    // prepend the \??\ prefix
+    return nt_prefix + path;
+  }
+}
+
+}  // namespace
+
+DirectoryWalker::DirectoryWalker() = default;
+
+DirectoryWalker::~DirectoryWalker() = default;
+
+void DirectoryWalker::forEachEntry(const QString& path, void* cx, DirStartF* dirStartF,
+                                   DirEndF* dirEndF, FileF* fileF)
+{
+  forEachEntryGeneric(makeNtPath(path), cx, dirStartF, dirEndF, fileF);
+}
+
+std::optional<CloneMethod> cloneFile(const QString& from, const QString& to,
+                                     QString& error)
+{
+  // CopyFileEx() keeps the attributes and modification time, and clones blocks
+  // by itself on ReFS volumes with recent versions of Windows
+  const auto fromPath = QDir::toNativeSeparators(from).toStdWString();
+  const auto toPath   = QDir::toNativeSeparators(to).toStdWString();
+
+  if (!::CopyFileExW(fromPath.c_str(), toPath.c_str(), nullptr, nullptr, nullptr,
+                     COPY_FILE_FAIL_IF_EXISTS)) {
+    // the partial copy is removed by CopyFileEx()
+    const auto e = GetLastError();
+    error        = MOBase::formatSystemMessage(e);
+    return {};
+  }
+
+  return CloneMethod::SystemCopy;
+}
+
+}  // namespace env
@@ -22,8 +22,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "../organizercore.h"
 #include "../settings.h"
 #include "../shared/util.h"
+#include "../vfsmapping.h"
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QProgressDialog>
 #include <QTemporaryFile>
 #include <iomanip>
@@ -193,31 +195,79 @@ UsvfsConnector::~UsvfsConnector()
   m_WorkerThread.wait();
 }
 
-void UsvfsConnector::updateMapping(const MappingType& mapping)
+void UsvfsConnector::updateMapping(const MappingType& mapping,
+                                   std::size_t contentToken)
 {
-  const auto start = std::chrono::high_resolution_clock::now();
+  const auto start   = std::chrono::high_resolution_clock::now();
+  const auto changes = MappingChanges::compute(m_Applied, mapping);
 
+  // the content of linked directories is only read when they're linked
+  const bool sameContent = (contentToken == m_AppliedToken);
+
+  if (sameContent && changes.identical) {
+    log::debug("VFS mappings unchanged, {} links", mapping.size());
+    return;
+  }
+
+  log::debug("Updating VFS mappings, {} added, {} removed, {} changed, {} kept, "
+             "files {}...",
+             changes.added, changes.removed, changes.changed, changes.common,
+             sameContent ? "unchanged" : "changed");
+
+  std::size_t first = 0;
+
+  if (sameContent && changes.appendOnly) {
+    // links can be added on top of the ones that are already there
+    first = changes.common;
+  } else {
+    // there's no way to remove a single link
+    clearMapping();
+  }
+
+  const auto [dirs, files] = link(mapping, first);
+  m_Applied                = mapping;
+  m_AppliedToken           = contentToken;
+
+  const auto end  = std::chrono::high_resolution_clock::now();
+  const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  log::debug("VFS mappings updated, linked {} dirs and {} files in {}ms", dirs, files,
+             time.count());
+}
+
+void UsvfsConnector::clearMapping()
+{
+  usvfsClearVirtualMappings();
+  m_Applied.clear();
+}
+
+std::pair<int, int> UsvfsConnector::link(const MappingType& mapping, std::size_t first)
+{
+  // the progress dialog is only shown if this takes a while, and events are
+  // processed a few times per second instead of after every few links
   QProgressDialog progress(qApp->activeWindow());
   progress.setLabelText(tr("Preparing vfs"));
-  progress.setMaximum(static_cast<int>(mapping.size()));
-  progress.show();
+  progress.setMaximum(static_cast<int>(mapping.size() - first));
+  progress.setMinimumDuration(500);
 
-  int value = 0;
-  int files = 0;
-  int dirs  = 0;
+  QElapsedTimer sinceEvents;
+  sinceEvents.start();
 
-  log::debug("Updating VFS mappings...");
+  int dirs  = 0;
+  int files = 0;
 
-  usvfsClearVirtualMappings();
+  for (std::size_t i = first; i < mapping.size(); ++i) {
+    const auto& map = mapping[i];
 
-  for (auto map : mapping) {
-    if (progress.wasCanceled()) {
-      usvfsClearVirtualMappings();
-      throw UsvfsConnectorException("VFS mapping canceled by user");
-    }
-    progress.setValue(value++);
-    if (value % 10 == 0) {
+    if (sinceEvents.elapsed() >= 50) {
+      progress.setValue(static_cast<int>(i - first));
       QCoreApplication::processEvents();
+      sinceEvents.restart();
+
+      if (progress.wasCanceled()) {
+        clearMapping();
+        throw UsvfsConnectorException("VFS mapping canceled by user");
+      }
     }
 
     if (map.isDirectory) {
@@ -232,11 +282,7 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
     }
   }
 
-  const auto end  = std::chrono::high_resolution_clock::now();
-  const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-  log::debug("VFS mappings updated, linked {} dirs and {} files in {}ms", dirs, files,
-             time.count());
+  return {dirs, files};
 }
 
 void UsvfsConnector::updateParams(MOBase::log::Levels logLevel,
@@ -80,7 +80,12 @@ public:
   UsvfsConnector();
   ~UsvfsConnector();
 
-  void updateMapping(const MappingType& mapping);
+  // only adds the links that changed since the last call, or nothing at all
+  // if the mapping is the same; directories are linked statically, so
+  // everything is linked again if the content token has changed since the
+  // last call
+  //
+  void updateMapping(const MappingType& mapping, std::size_t contentToken = 0);
 
   void updateParams(MOBase::log::Levels logLevel, env::CoreDumpTypes coreDumpType,
                     const QString& crashDumpsPath, std::chrono::seconds spawnDelay,
@@ -93,10 +98,23 @@ public:
 private:
   LogWorker m_LogWorker;
   QThread m_WorkerThread;
+
+  // mapping as it was last applied to the vfs
+  MappingType m_Applied;
+  std::size_t m_AppliedToken = 0;
+
+  void clearMapping();
+
+  // links the given range of the mapping, returns the number of directories
+  // and files
+  std::pair<int, int> link(const MappingType& mapping, std::size_t first);
 };
 
 CrashDumpsType crashDumpsType(int type);
 
+// opens every process running in the vfs except this one, the caller owns the
+// returned handles and must close them
+//
 std::vector<HANDLE> getRunningUSVFSProcesses();
 
 #endif  // USVFSCONNECTOR_H